@@ -18,10 +18,17 @@
  * Please contact info@openmfg.com with any questions on this license.
  */
 
+#include <QCache>
+#include <QCryptographicHash>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
 #include <QString>
 #include <QVariant>
+#include <QVector>
 
 #include <parameter.h>
+#include <xsqlquerycache.h>
 
 #include <QSqlDatabase>
 
@@ -34,18 +41,35 @@
 
 class MetaSQLInfoQt : public MetaSQLInfo {
     public:
-        MetaSQLInfoQt(const ParameterList & params) : MetaSQLInfo() {
+        MetaSQLInfoQt(const ParameterList & params, bool arrays = false) : MetaSQLInfo() {
             _params = &params;
             _paramCount = 0;
+            _arrays = arrays;
+
+            // indexed once per toQuery(), lists made random access; the first
+            // parameter of a name wins, as with ParameterList::value()
+            for(int n = 0; n < params.count(); n++) {
+                QByteArray key = params.name(n).toUtf8();
+                if(_index.contains(key))
+                    continue;
+                MetaSQLParam & p = _index[key];
+                p.value = params.value(n);
+                p.isList = (p.value.type() == QVariant::List || p.value.type() == QVariant::StringList);
+                if(p.isList)
+                    p.list = p.value.toList().toVector();
+            }
         }
 
         virtual std::list<std::string> enumerateNames() {
             std::list<std::string> names;
-            for(int n = 0; n < _params->count(); n++) {                                                                
-                names.push_back(_params->name(n).toStdString());                                               
+            for(int n = 0; n < _params->count(); n++) {
+                names.push_back(_params->name(n).toStdString());
             }
             return names;
         }
+        virtual bool hasName(const std::string & name) {
+            return find(name) != 0;
+        }
         virtual bool isValueFirst(const std::string & name) {
             return getValuePos(name) == 0;
         }
@@ -53,39 +77,107 @@ class MetaSQLInfoQt : public MetaSQLInfo {
             return getValuePos(name) == (getValueListCount(name) - 1);
         }
         virtual int getValueListCount(const std::string & name) {
-            bool found = false;
-            QVariant v = _params->value(QString::fromStdString(name), &found);
-            int lc = 0;
-            if(found && (v.type() == QVariant::List || v.type() == QVariant::StringList)) {
-                lc = v.toList().count();
-            }
-            return lc;
+            const MetaSQLParam * p = find(name);
+            return (p && p->isList ? p->list.size() : 0);
         }
 	virtual std::string getValue(const std::string & name, bool param = false, int pos = -1) {
-            bool found = false;
-            QVariant v = _params->value(QString::fromStdString(name), &found);
-            if(found && (v.type() == QVariant::List || v.type() == QVariant::StringList)) {
-                v = v.toList().at((pos == -1 ? getValuePos(name) : pos));
+            const MetaSQLParam * p = find(name);
+            QVariant v;
+            if(p && p->isList) {
+                v = p->list.value((pos == -1 ? getValuePos(name) : pos));
+            } else if(p) {
+                v = p->value;
             }
             if(param) {
-                _paramCount++;
-                std::stringstream sstr;
-                sstr << ":_" << _paramCount << "_";
-                std::string n = sstr.str();
-                _pList[n] = v;
-                return n + " ";
+                return bind(v) + " ";
             } else {
                 return v.toString().toStdString();
             }
         }
 
+        // a list is bound whole as one PostgreSQL array, which keeps the
+        // statement text the same for any number of elements
+        virtual std::string getValueIn(const std::string & name) {
+            if(!_arrays)
+                return MetaSQLInfo::getValueIn(name);
+
+            const MetaSQLParam * p = find(name);
+            QVariant v;
+            if(p && p->isList) {
+                v = arrayLiteral(p->list);
+            } else if(p) {
+                v = arrayLiteral(QVector<QVariant>(1, p->value));
+            }
+            return "= ANY(" + bind(v) + ") ";
+        }
+
         std::map<std::string,QVariant> _pList;
         int _paramCount;
         const ParameterList * _params;
+
+    protected:
+        // names the value :_1_, :_2_, ... in the order it is bound
+        std::string bind(const QVariant & v) {
+            _paramCount++;
+            char buf[16];
+            char * c = buf + sizeof(buf);
+            *--c = '_';
+            for(int i = _paramCount; i > 0; i /= 10)
+                *--c = (char)('0' + i % 10);
+            *--c = '_';
+            *--c = ':';
+            std::string n(c, buf + sizeof(buf) - c);
+            _pList[n] = v;
+            return n;
+        }
+
+        // the text form of an array, the server takes it as the array type
+        // the column compared needs
+        static QString arrayLiteral(const QVector<QVariant> & list) {
+            QString a("{");
+            for(int i = 0; i < list.size(); i++) {
+                if(i > 0)
+                    a += ',';
+                if(list.at(i).isNull()) {
+                    a += "NULL";
+                    continue;
+                }
+                QString e = list.at(i).toString();
+                e.replace('\\', "\\\\").replace('"', "\\\"");
+                a += '"' + e + '"';
+            }
+            a += '}';
+            return a;
+        }
+
+        class MetaSQLParam {
+            public:
+                QVariant value;
+                bool isList;
+                QVector<QVariant> list;
+        };
+
+        // looked up without copying the name
+        const MetaSQLParam * find(const std::string & name) const {
+            QHash<QByteArray, MetaSQLParam>::const_iterator it =
+                _index.constFind(QByteArray::fromRawData(name.data(), (int)name.size()));
+            return (it == _index.constEnd() ? 0 : &it.value());
+        }
+
+        QHash<QByteArray, MetaSQLParam> _index;
+        bool _arrays;
 };
 
+// the valid parsed statements by the SHA-1 of their source; populate() only
+// reads the tree, so one parser serves any number of queries at once
+typedef QSharedPointer<MetaSQLQueryParser> MetaSQLParserPtr;
+typedef QCache<QByteArray, MetaSQLParserPtr> MetaSQLParserCache;
+
+Q_GLOBAL_STATIC_WITH_ARGS(MetaSQLParserCache, parserCache, (500))
+Q_GLOBAL_STATIC(QMutex, parserCacheLock)
+
 MetaSQLQuery::MetaSQLQuery(const QString & query) {
-    _data = new MetaSQLQueryParser();
+    _data = MetaSQLParserPtr(new MetaSQLQueryParser());
     _source = QString::null;
 
     if(!query.isEmpty()) {
@@ -94,17 +186,34 @@ MetaSQLQuery::MetaSQLQuery(const QString & query) {
 }
 
 MetaSQLQuery::~MetaSQLQuery() {
-    if(_data) {
-        delete _data;
-        _data = 0;
-    }
+}
+
+void MetaSQLQuery::clearCache() {
+    QMutexLocker locker(parserCacheLock());
+    parserCache()->clear();
 }
 
 bool MetaSQLQuery::setQuery(const QString & query) {
-    bool valid = false;
-    if(_data) {
-        _source = query;
-        valid = _data->parse_query(query.toStdString());
+    _source = query;
+
+    QByteArray key = QCryptographicHash::hash(query.toUtf8(), QCryptographicHash::Sha1);
+    {
+        QMutexLocker locker(parserCacheLock());
+        MetaSQLParserPtr * cached = parserCache()->object(key);
+        if(cached) {
+            _data = *cached;
+            return true;
+        }
+    }
+
+    // statements that do not parse are not kept, their log has to be
+    // written again anyway
+    MetaSQLParserPtr parser(new MetaSQLQueryParser());
+    bool valid = parser->parse_query(query.toStdString());
+    _data = parser;
+    if(valid) {
+        QMutexLocker locker(parserCacheLock());
+        parserCache()->insert(key, new MetaSQLParserPtr(parser));
     }
     return valid;
 }
@@ -115,8 +224,12 @@ bool MetaSQLQuery::isValid() { return (_data && _data->isValid()); }
 XSqlQuery MetaSQLQuery::toQuery(const ParameterList & params, QSqlDatabase pDb, bool pExec) {
     XSqlQuery qry(pDb);
     if(isValid()) {
-        MetaSQLInfoQt mif(params);
-        if(qry.prepare(QString::fromStdString(_data->populate(&mif)))) {
+        // inlist() binds arrays only where the driver knows them
+        QSqlDatabase db = (pDb.isValid() ? pDb : QSqlDatabase::database(QSqlDatabase::defaultConnection, false));
+        MetaSQLInfoQt mif(params, db.driverName().startsWith("QPSQL"));
+        bool prepared = false;
+        qry = XSqlQueryCache::prepare(QString::fromStdString(_data->populate(&mif)), pDb, &prepared);
+        if(prepared) {
             for ( std::map<std::string, QVariant>::iterator it=mif._pList.begin() ; it != mif._pList.end(); it++ ) {
                 qry.bindValue(QString::fromStdString((*it).first) ,(*it).second);
             }
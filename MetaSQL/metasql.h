@@ -21,6 +21,7 @@
 #ifndef __METASQL_H__
 #define __METASQL_H__
 
+#include <QSharedPointer>
 #include <QString>
 
 class QSqlDatabase;
@@ -29,11 +30,17 @@ class QSqlDatabase;
 #include <parameter.h>
 
 class MetaSQLQueryParser;
+
+// The parsed form of a statement is shared by every MetaSQLQuery made from
+// the same source text, in any thread; only toQuery() runs per query.
 class MetaSQLQuery {
     public:
         MetaSQLQuery(const QString & = QString::null);
         virtual ~MetaSQLQuery();
 
+        // forgets the parsed statements kept for reuse
+        static void clearCache();
+
         bool setQuery(const QString &);
         bool isValid();
         QString getSource();
@@ -43,7 +50,7 @@ class MetaSQLQuery {
         QString parseLog();
 
     private:
-        MetaSQLQueryParser * _data;
+        QSharedPointer<MetaSQLQueryParser> _data;
 
         QString _source;
 };
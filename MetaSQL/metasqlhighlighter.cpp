@@ -693,6 +693,7 @@ void MetaSQLHighlighter::init()
                 << "exists"
                 << "foreach"
                 << "if"
+                << "inList"
                 << "isFirst"
                 << "isLast"
                 << "literal"
@@ -69,7 +69,9 @@ class MetaSQLOutput {
         MetaSQLOutput(MetaSQLQueryParser * parent) { _parent = parent; }
         virtual ~MetaSQLOutput() { _parent = 0; }
 
-        virtual std::string toString(MetaSQLInfo *, int * = 0, bool * = 0) = 0;
+        // appends the text to sql, the one buffer the whole statement is
+        // written into
+        virtual void toString(std::string & sql, MetaSQLInfo *, int * = 0, bool * = 0) = 0;
 
     protected:
         MetaSQLQueryParser * _parent;
@@ -79,7 +81,7 @@ class MetaSQLString : public MetaSQLOutput {
     public:
         MetaSQLString(MetaSQLQueryParser * parent, const std::string & str) : MetaSQLOutput(parent), _string(str) {}
 
-        virtual std::string toString(MetaSQLInfo *, int * = 0, bool * = 0) { return _string; }
+        virtual void toString(std::string & sql, MetaSQLInfo *, int * = 0, bool * = 0) { sql += _string; }
 
     protected:
         std::string _string;
@@ -91,7 +93,7 @@ class MetaSQLComment : public MetaSQLOutput {
 
         // If we want to show comments we need to escape single quotes as they cause problems when passed to database server
         // But we don't have to include comments at all since they are not required by the database to work.
-        virtual std::string toString(MetaSQLInfo *, int * = 0, bool * = 0) { return " "; }
+        virtual void toString(std::string & sql, MetaSQLInfo *, int * = 0, bool * = 0) { sql += ' '; }
 
     protected:
         std::string _string;
@@ -104,6 +106,7 @@ class MetaSQLFunction : public MetaSQLOutput {
             _valid = 0;
             _nBreaks = 0;
             _noOutput = 0;
+            _reCompiled = false;
 
             _params = params;
 
@@ -112,12 +115,18 @@ class MetaSQLFunction : public MetaSQLOutput {
                 switch(_func) {
                     case FunctionValue:
                     case FunctionLiteral:
+                    case FunctionInList:
                     case FunctionExists:
-                    case FunctionReExists:
                     case FunctionIsFirst:
                     case FunctionIsLast:
                         _valid = (_params.size() >= 1);
                         break;
+                    case FunctionReExists:
+                        // compiled once here, the tree may be evaluated many times
+                        _valid = (_params.size() >= 1);
+                        if(_valid)
+                            _reCompiled = (regcomp(&_re, _params[0].c_str(), REG_EXTENDED|REG_NOSUB) == 0);
+                        break;
                     case FunctionContinue:
                     case FunctionBreak:
                         _valid = 1;
@@ -132,10 +141,16 @@ class MetaSQLFunction : public MetaSQLOutput {
             }
         }
 
+        virtual ~MetaSQLFunction() {
+            if(_reCompiled)
+                regfree(&_re);
+        }
+
         enum Function {
             FunctionUnknown = 0,
             FunctionValue,
             FunctionLiteral,
+            FunctionInList,
             FunctionExists,
             FunctionReExists,
             FunctionIsFirst,
@@ -147,40 +162,36 @@ class MetaSQLFunction : public MetaSQLOutput {
         bool isValid() { return _valid; }
         Function type() { return _func; }
 
-        virtual std::string toString(MetaSQLInfo * mif, int * nBreaks = 0, bool * isContinue = 0) {
+        virtual void toString(std::string & sql, MetaSQLInfo * mif, int * nBreaks = 0, bool * isContinue = 0) {
             if(_noOutput)
-                return "";
-            std::string v = toVariant(mif, nBreaks, isContinue);
-            return v;
+                return;
+            sql += toVariant(mif, nBreaks, isContinue);
         }
         virtual std::string toVariant(MetaSQLInfo * mif, int * nBreaks = 0, bool * isContinue = 0) {
             std::string val;
             if(_valid) {
                 std::string str;
-                std::list<std::string> list;
-                std::list<std::string>::iterator strlit;
-                regex_t re;
                 switch(_func) {
                     case FunctionValue:
                     case FunctionLiteral:
                         str = _params[0];
                         val = mif->getValue(str, (_func==FunctionValue));
                         break;
+                    case FunctionInList:
+                        val = mif->getValueIn(_params[0]);
+                        break;
                     case FunctionExists:
-                        list = mif->enumerateNames();
-                        strlit = find(list.begin(), list.end(), _params[0]);
-                        val = ( strlit != list.end() ? mif->trueValue() : mif->falseValue() );
+                        val = ( mif->hasName(_params[0]) ? mif->trueValue() : mif->falseValue() );
                         break;
                     case FunctionReExists:
-                        if(regcomp(&re, _params[0].c_str(), REG_EXTENDED|REG_NOSUB) == 0) {
-                            list = mif->enumerateNames();
-                            for(strlit = list.begin(); strlit != list.end(); strlit++) {
-                                if(regexec(&re, (*strlit).c_str(), (std::size_t)0, NULL, 0) == 0) {
+                        if(_reCompiled) {
+                            const std::vector<std::string> & names = mif->names();
+                            for(std::size_t n = 0; n < names.size(); n++) {
+                                if(regexec(&_re, names[n].c_str(), (std::size_t)0, NULL, 0) == 0) {
                                     val = mif->trueValue();
                                     break;
                                 }
                             }
-                            regfree(&re);
                         }
                         break;
                     case FunctionIsFirst:
@@ -211,6 +222,8 @@ class MetaSQLFunction : public MetaSQLOutput {
                 return FunctionValue;
             else if(f == "literal")
                 return FunctionLiteral;
+            else if(f == "inlist")
+                return FunctionInList;
             else if(f == "exists")
                 return FunctionExists;
             else if(f == "reexists")
@@ -235,6 +248,8 @@ class MetaSQLFunction : public MetaSQLOutput {
         Function _func;
         std::vector<std::string> _params;
         int _nBreaks;
+        bool _reCompiled;
+        regex_t _re;
 };
 
 class MetaSQLBlock : public MetaSQLOutput {
@@ -399,9 +414,7 @@ class MetaSQLBlock : public MetaSQLOutput {
             _alt = alt;
         }
 
-        virtual std::string toString(MetaSQLInfo * mif, int * nBreaks = 0, bool * isContinue = 0) {
-            std::string results;
-
+        virtual void toString(std::string & sql, MetaSQLInfo * mif, int * nBreaks = 0, bool * isContinue = 0) {
             MetaSQLOutput * output = 0;
             bool b = false, myContinue = false;
             int myBreaks = 0;
@@ -417,11 +430,11 @@ class MetaSQLBlock : public MetaSQLOutput {
                         for(ui = 0; ui < _items.size(); ui++)
                         {
                             output = _items.at(ui);
-                            results += output->toString(mif, nBreaks, isContinue);
+                            output->toString(sql, mif, nBreaks, isContinue);
                             if(nBreaks && *nBreaks) break;
                         }
                     } else if(_alt) {
-                        results = _alt->toString(mif, nBreaks, isContinue);
+                        _alt->toString(sql, mif, nBreaks, isContinue);
                     }
                     break;
 
@@ -439,7 +452,7 @@ class MetaSQLBlock : public MetaSQLOutput {
                             for(uii = 0; uii < _items.size(); uii++)
                             {
                                 output = _items.at(uii);
-                                results += output->toString(mif, &myBreaks, &myContinue);
+                                output->toString(sql, mif, &myBreaks, &myContinue);
                                 if(myBreaks) break;
                             }
 
@@ -461,7 +474,7 @@ class MetaSQLBlock : public MetaSQLOutput {
                     for(ui = 0; ui < _items.size(); ui++)
                     {
                         output = _items.at(ui);
-                        results += output->toString(mif, nBreaks, isContinue);
+                        output->toString(sql, mif, nBreaks, isContinue);
                         if(nBreaks && *nBreaks) break;
                     }
                     break;
@@ -469,8 +482,6 @@ class MetaSQLBlock : public MetaSQLOutput {
                 default:
                     _parent->_logger << "Encountered unknown Block type " << (int)_block << "." << std::endl;
             };
-
-            return results;
         }
 
     protected:
@@ -514,7 +525,17 @@ MetaSQLQueryParser::~MetaSQLQueryParser() {
 std::string MetaSQLQueryParser::populate(MetaSQLInfo * mif) {
     std::string sql;
     if(_top) {
-        sql = trim(_top->toString(mif));
+        // the statement is seldom much longer than its source
+        sql.reserve(_sourceSize + _sourceSize / 4);
+        _top->toString(sql, mif);
+
+        std::size_t end = sql.find_last_not_of(" \t\n\v\f\r");
+        if(end == std::string::npos) {
+            sql.clear();
+        } else {
+            sql.erase(end + 1);
+            sql.erase(0, sql.find_first_not_of(" \t\n\v\f\r"));
+        }
     }
     return sql;
 }
@@ -526,6 +547,7 @@ bool MetaSQLQueryParser::parse_query(const std::string & query) {
         _valid = false;
     }
     _top = new MetaSQLBlock(this, "generic", "");
+    _sourceSize = query.size();
     std::vector<MetaSQLBlock*> _blocks;
     _blocks.push_back(_top);
     MetaSQLBlock * _current = _top;
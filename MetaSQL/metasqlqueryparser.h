@@ -32,7 +32,7 @@ class MetaSQLBlock;
 
 class MetaSQLInfo {
     public:
-        MetaSQLInfo() {}
+        MetaSQLInfo() : _namesValid(false) {}
         virtual ~MetaSQLInfo() {}
 
         virtual std::string trueValue() { return "true"; }
@@ -49,6 +49,42 @@ class MetaSQLInfo {
             return pos;
         }
 
+        // the names, enumerated once and kept while the values are not
+        // changed; populate() reads them for every exists and reexists
+        const std::vector<std::string> & names() {
+            if(!_namesValid) {
+                std::list<std::string> list = enumerateNames();
+                _names.assign(list.begin(), list.end());
+                _namesValid = true;
+            }
+            return _names;
+        }
+        virtual bool hasName(const std::string & name) {
+            const std::vector<std::string> & list = names();
+            return find(list.begin(), list.end(), name) != list.end();
+        }
+
+        // the test of "expr <? inlist("name") ?>", every element of the list
+        // bound on its own; a value that is no list is one element and a
+        // name that is not there none, which matches no row
+        virtual std::string getValueIn(const std::string & name) {
+            std::string in = "IN (";
+            int count = getValueListCount(name);
+            if(count > 0) {
+                for(int i = 0; i < count; i++) {
+                    if(i > 0)
+                        in += ", ";
+                    in += getValue(name, true, i);
+                }
+            } else if(hasName(name)) {
+                in += getValue(name, true);
+            } else {
+                in += "NULL";
+            }
+            in += ") ";
+            return in;
+        }
+
         virtual std::list<std::string> enumerateNames() = 0;
         virtual bool isValueFirst(const std::string &) = 0;
         virtual bool isValueLast(const std::string &) = 0;
@@ -56,7 +92,13 @@ class MetaSQLInfo {
         virtual std::string getValue(const std::string &, bool = false, int = -1) = 0;
 
     protected:
+        void namesChanged() { _namesValid = false; }
+
         std::map<std::string, int> _posList;
+
+    private:
+        bool _namesValid;
+        std::vector<std::string> _names;
 };
 
 class MetaSQLInfoDefault : public MetaSQLInfo {
@@ -80,22 +122,22 @@ class MetaSQLInfoDefault : public MetaSQLInfo {
             return getValuePos(name) == (getValueListCount(name) - 1);
         }
 
+        virtual bool hasName(const std::string & name) {
+            return _values.count(name) > 0;
+        }
+
         virtual int getValueListCount(const std::string & name) {
-            std::list<std::string> list = enumerateNames();
-            std::list<std::string>::iterator strlit = find(list.begin(), list.end(), name);
-            int lc = 0;
-            if(strlit != list.end()) {
-                lc = _values[name].size();
-            }
-            return lc;
+            std::map<std::string, std::vector<std::string> >::const_iterator it = _values.find(name);
+            return (it != _values.end() ? (int)(*it).second.size() : 0);
         }
 
         virtual std::string getValue(const std::string & name, bool param = false, int pos = -1) {
-            std::list<std::string> list = enumerateNames();
-            std::list<std::string>::iterator strlit = find(list.begin(), list.end(), name);
+            std::map<std::string, std::vector<std::string> >::const_iterator it = _values.find(name);
             std::string v;
-            if(strlit != list.end()) {
-                v = _values[name].at((pos != -1 ? getValuePos(name) : pos));
+            if(it != _values.end()) {
+                std::size_t at = (pos == -1 ? getValuePos(name) : pos);
+                if(at < (*it).second.size())
+                    v = (*it).second[at];
             }
             if(param) {
                 std::string n = "'";
@@ -120,6 +162,8 @@ class MetaSQLInfoDefault : public MetaSQLInfo {
 
         void setList(const std::string &name, const std::vector<std::string> & list) {
             setValuePos(name, 0);
+            if(_values.count(name) == 0)
+                namesChanged();
             _values[name] = list;
         }
 
@@ -132,6 +176,7 @@ class MetaSQLQueryParser {
         MetaSQLQueryParser() {
             _valid = false;
             _top = 0;
+            _sourceSize = 0;
         }
         virtual ~MetaSQLQueryParser();
 
@@ -147,6 +192,7 @@ class MetaSQLQueryParser {
     private:
         bool _valid;
         MetaSQLBlock * _top;
+        std::size_t _sourceSize;
 
 };
 
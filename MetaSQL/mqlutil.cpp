@@ -26,7 +26,7 @@
 #include <QTextStream>
 #include <QVariant>
 
-#include "xsqlquery.h"
+#include "mqlcache.h"
 
 static QRegExp groupRE    = QRegExp("(^\\s*--\\s*GROUP:\\s*)(.*)",Qt::CaseInsensitive);
 static QRegExp nameRE     = QRegExp("(^\\s*--\\s*NAME:\\s*)(.*)", Qt::CaseInsensitive);
@@ -153,18 +153,10 @@ QString MQLUtil::mqlLoad(const QString &group, const QString &name, QString &err
   QString fsrc = QString::null;
   errmsg = QString::null;
 
-  XSqlQuery qry;
-  QString sql;
-  sql = QString("SELECT metasql_query "
-                "  FROM metasql "
-                 "WHERE ((metasql_group='%1') "
-                "    AND (metasql_name='%2'))"
-                " ORDER BY metasql_grade DESC"
-                " LIMIT 1;").arg(group).arg(name);
-  qry.exec(sql);
-  if (qry.first())
+  bool found = false;
+  fsrc = MQLCache::query(group, name, QSqlDatabase(), &found);
+  if (found)
   {
-    fsrc = qry.value("metasql_query").toString();
     if (valid)
       *valid = true;
   }
@@ -147,6 +147,12 @@ static const char* __SqlTable[][__fieldCount] = {
   {"fmt19",      "QODBC",          "SELECT 'default' AS nspname;" },
   {"fmt19",      "QMYSQL",         "SELECT 'default' AS nspname;" },
 
+// fmt20 : whether the report fmt04 would load changed, see ORReportCache
+  {"fmt20",      "QPSQL",          "SELECT report_grade, md5(report_source) AS report_checksum "
+                                        "  FROM report "
+                                        " WHERE (report_name=:report_name)"
+                                        " ORDER BY report_grade DESC LIMIT 1"},
+
 
 
 // crt00
@@ -24,8 +24,6 @@
 #include <xsqlquery.h>
 #include <parameter.h>
 
-static LabelSizeInfo __label;
-
 static LabelSizeInfo __labels[] = {
 //"LABEL_NAME","Paper Size","COLUMNS","ROWS","WIDTH","HEIGHT","STARTXOFFSET","STARTYOFFSET","HORIZONTALGAP","VERTICALGAP"
   LabelSizeInfo("Avery 5263", "Letter", 2, 5, 400, 200, 25, 50, 0, 0),
@@ -51,33 +49,34 @@ QStringList LabelSizeInfo::getLabelNamesNoDatabase()
   return l;
 }
 
-const LabelSizeInfo & LabelSizeInfo::getByName(const QString & name)
+LabelSizeInfo LabelSizeInfo::getByName(const QString & name, QSqlDatabase db)
 {
-  XSqlQuery xqry;
+  LabelSizeInfo label;
+  XSqlQuery xqry(db);
   xqry.prepare("SELECT * FROM labeldef WHERE labeldef_name=:labelName");
   xqry.bindValue(":labelName", name);
   xqry.exec();
 
   if (xqry.first())
   {
-    __label._null = false;
-    __label._name    = xqry.value("labeldef_name").toString();
-    __label._paper   = xqry.value("labeldef_papersize").toString();
-    __label._columns = xqry.value("labeldef_columns").toInt();
-    __label._rows    = xqry.value("labeldef_rows").toInt();
-    __label._width   = xqry.value("labeldef_width").toInt();
-    __label._height  = xqry.value("labeldef_height").toInt();
-    __label._startx  = xqry.value("labeldef_start_offset_x").toInt();
-    __label._starty  = xqry.value("labeldef_start_offset_y").toInt();
-    __label._xgap    = xqry.value("labeldef_horizontal_gap").toInt();
-    __label._ygap    = xqry.value("labeldef_vertical_gap").toInt();
+    label._null = false;
+    label._name    = xqry.value("labeldef_name").toString();
+    label._paper   = xqry.value("labeldef_papersize").toString();
+    label._columns = xqry.value("labeldef_columns").toInt();
+    label._rows    = xqry.value("labeldef_rows").toInt();
+    label._width   = xqry.value("labeldef_width").toInt();
+    label._height  = xqry.value("labeldef_height").toInt();
+    label._startx  = xqry.value("labeldef_start_offset_x").toInt();
+    label._starty  = xqry.value("labeldef_start_offset_y").toInt();
+    label._xgap    = xqry.value("labeldef_horizontal_gap").toInt();
+    label._ygap    = xqry.value("labeldef_vertical_gap").toInt();
   }
   else
   {
-    __label = LabelSizeInfo::getByNameNoDatabase(name);
+    label = LabelSizeInfo::getByNameNoDatabase(name);
   }
 
-  return __label;
+  return label;
 }
 
 QStringList LabelSizeInfo::getLabelNames()
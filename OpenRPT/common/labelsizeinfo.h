@@ -23,6 +23,7 @@
 
 #include <qstring.h>
 #include <qstringlist.h>
+#include <QSqlDatabase>
 
 class LabelSizeInfo
 {
@@ -48,7 +49,8 @@ class LabelSizeInfo
 
     bool isNull() const;
 
-    static const LabelSizeInfo & getByName(const QString &);
+    // an invalid database means the default connection
+    static LabelSizeInfo getByName(const QString &, QSqlDatabase = QSqlDatabase());
     static QStringList getLabelNames();
     static bool areLabelsEditable();
 
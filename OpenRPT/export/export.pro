@@ -30,19 +30,20 @@ OBJECTS_DIR = tmp
 UI_DIR = tmp
 
 # Input
-HEADERS = ../common/builtinSqlFunctions.h		# MANU
+SOURCES += main.cpp
 
-SOURCES += main.cpp \
-           ../common/builtinSqlFunctions.cpp	# MANU
-
-INCLUDEPATH += ../../common ../common
+INCLUDEPATH += ../../common ../common ../renderer
 QMAKE_LIBDIR = ../../lib $$QMAKE_LIBDIR
-LIBS += -lopenrptcommon
+# the renderer compiles reports and provides getSqlFromTag()
+LIBS += -lrenderer -lopenrptcommon -ldmtx -lMetaSQL
 
 win32-msvc* {
-  PRE_TARGETDEPS += ../../lib/openrptcommon.$${LIBEXT}
+  PRE_TARGETDEPS += ../../lib/renderer.$${LIBEXT} \
+                    ../../lib/openrptcommon.$${LIBEXT}
 } else {
-  PRE_TARGETDEPS += ../../lib/libopenrptcommon.$${LIBEXT}
+  PRE_TARGETDEPS += ../../lib/librenderer.$${LIBEXT} \
+                    ../../lib/libopenrptcommon.$${LIBEXT}
 }
 
-QT += xml sql
+QT += xml sql gui printsupport
+win32|macx:QT += widgets
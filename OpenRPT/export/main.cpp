@@ -20,7 +20,7 @@
 
 #include <stdlib.h>
 
-#include <QCoreApplication>
+#include <QGuiApplication>
 #include <QString>
 #include <QSqlDatabase>
 #include <QFile>
@@ -30,12 +30,17 @@
 #include <QVariant>
 #include <QByteArray>
 #include <dbtools.h>
+#include <orcompiledreport.h>
 
 #include "builtinSqlFunctions.h"
 
 int main(int argc, char *argv[])
 {
-  QCoreApplication application(argc, argv);
+  // compiling needs fonts, hence a QGuiApplication, but no display
+  if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QGuiApplication application(argc, argv);
   application.addLibraryPath(".");
 
   if (argc > 1)
@@ -44,6 +49,7 @@ int main(int argc, char *argv[])
     QString username;
     QString passwd;
     QString arguments;
+    bool    compile = false;
 
     for (int counter = 1; counter < argc; counter++)
     {
@@ -55,6 +61,8 @@ int main(int argc, char *argv[])
         username = arguments.right(arguments.length() - 10);
       else if (arguments.startsWith("-passwd=", Qt::CaseInsensitive))
         passwd = arguments.right(arguments.length() - 8);
+      else if (arguments.toLower() == "-compile")
+        compile = true;
     }
 
     if (  (databaseURL != "") && (username != "") ) {
@@ -116,6 +124,14 @@ int main(int argc, char *argv[])
         }
         else
           printf("Error: Could not open file %s: %s\n", fname.toLatin1().data(), file.errorString().toLatin1().data());
+
+        if(compile)
+        {
+          QString error;
+          QString cname = fname.left(fname.length() - 4) + ".orc";
+          if(!ORCompiledReport::compile(qry.value(2).toString(), cname, db, &error))
+            printf("Error: Could not compile %s: %s\n", cname.toLatin1().data(), error.toLatin1().data());
+        }
       }
     }
     else if (databaseURL == "")
@@ -124,6 +140,7 @@ int main(int argc, char *argv[])
       printf("You must specify a Database Username by using the -username= parameter.\n");
   }
   else
-    printf( "Usage: exportrpt -databaseURL='$' -username='$' -passwd='$'\n");
+    printf( "Usage: exportrpt -databaseURL='$' -username='$' -passwd='$' [-compile]\n"
+            "       -compile also writes each report compiled, to a .orc file\n");
   return 0;
 }
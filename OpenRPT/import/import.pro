@@ -30,17 +30,20 @@ OBJECTS_DIR = tmp
 UI_DIR = tmp
 
 # Input
-HEADERS += ../common/builtinSqlFunctions.h				# MANU
-SOURCES += main.cpp ../common/builtinSqlFunctions.cpp				# MANU
+SOURCES += main.cpp
 
-INCLUDEPATH += ../../common ../common
+INCLUDEPATH += ../../common ../common ../renderer
 QMAKE_LIBDIR = ../../lib $$QMAKE_LIBDIR
-LIBS += -lopenrptcommon
+# the renderer reads compiled reports and provides getSqlFromTag()
+LIBS += -lrenderer -lopenrptcommon -ldmtx -lMetaSQL
 
 win32-msvc* {
-  PRE_TARGETDEPS += ../../lib/openrptcommon.$${LIBEXT}
+  PRE_TARGETDEPS += ../../lib/renderer.$${LIBEXT} \
+                    ../../lib/openrptcommon.$${LIBEXT}
 } else {
-  PRE_TARGETDEPS += ../../lib/libopenrptcommon.$${LIBEXT}
+  PRE_TARGETDEPS += ../../lib/librenderer.$${LIBEXT} \
+                    ../../lib/libopenrptcommon.$${LIBEXT}
 }
 
-QT += xml sql
+QT += xml sql gui printsupport
+win32|macx:QT += widgets
@@ -29,9 +29,12 @@
 #include <QtXml>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QTextCodec>
 #include <QTextStream>
+#include <QXmlStreamReader>
 
 #include <dbtools.h>
+#include <orcompiledreport.h>
 
 #include "builtinSqlFunctions.h"
 
@@ -77,22 +80,55 @@ int main(int argc, char *argv[])
     if(xml_file != "") {
         QFile file(xml_file);
         if(file.open( QIODevice::ReadOnly )) {
-            QDomDocument doc;
+            // a compiled report carries the source it was compiled from
+            bool compiled = ORCompiledReport::isCompiled(xml_file);
+            QString compiledSrc;
             QString errMsg;
-            int errLine, errCol;
-            if(doc.setContent(&file, &errMsg, &errLine, &errCol)) {
-                QDomElement root = doc.documentElement();
-                if(root.tagName() == "report") {
-                    for(QDomNode n = root.firstChild();
-                            !n.isNull(); n = n.nextSibling() ) {
-                        if(n.nodeName() == "name") {
-                            report_name = n.firstChild().nodeValue();
-                        } else if(n.nodeName() == "description") {
-                            report_desc = n.firstChild().nodeValue();
+            QByteArray data;
+            if(!compiled) {
+                data = file.readAll();
+            } else if(!ORCompiledReport::source(xml_file, compiledSrc, &errMsg)) {
+                out << "Error reading compiled report " << xml_file << ": " << errMsg << endl;
+                exit(-1);
+            }
+
+            // only the name and description are needed, there is no use
+            // building a document for them
+            QXmlStreamReader xml;
+            if(compiled)
+                xml.addData(compiledSrc);
+            else
+                xml.addData(data);
+            bool isReport = false;
+            if(xml.readNextStartElement()) {
+                isReport = (xml.name() == "report");
+                if(isReport) {
+                    while(xml.readNextStartElement()) {
+                        if(xml.name() == "name") {
+                            report_name = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                        } else if(xml.name() == "description") {
+                            report_desc = xml.readElementText(QXmlStreamReader::IncludeChildElements);
+                        } else {
+                            xml.skipCurrentElement();
                         }
                     }
-                    report_src  = doc.toString();
-
+                }
+                while(!xml.atEnd())
+                    xml.readNext();
+            }
+            if(!xml.hasError()) {
+                if(isReport && compiled) {
+                    report_src = compiledSrc;
+                } else if(isReport) {
+                    // the source is stored as it is in the file
+                    QTextCodec * codec = 0;
+                    if(!xml.documentEncoding().isEmpty())
+                        codec = QTextCodec::codecForName(xml.documentEncoding().toString().toLatin1());
+                    if(!codec)
+                        codec = QTextCodec::codecForName("UTF-8");
+                    report_src = codec->toUnicode(data);
+                }
+                if(isReport) {
                     if(report_name == "") {
                         out << "The document " << xml_file << " does not have a report name defined." << endl;
                     }
@@ -100,7 +136,7 @@ int main(int argc, char *argv[])
                     out << "XML Document " << xml_file << " does not have root node of report." << endl;
                 }
             } else {
-                out << "Error parsing file " << xml_file << ": " << errMsg << " on line " << errLine << " column " << errCol << endl;
+                out << "Error parsing file " << xml_file << ": " << xml.errorString() << " on line " << xml.lineNumber() << " column " << xml.columnNumber() << endl;
             }
         } else {
             out << "Could not open the specified file: " << xml_file << endl;
@@ -180,6 +216,7 @@ int main(int argc, char *argv[])
       out << "You must specify a Database Password by using the -passwd= parameter." << endl;
   }
   else
-    out << "Usage: import -databaseURL='$' -username='$' -passwd='$' -grade=# -f='$'" << endl;
+    out << "Usage: import -databaseURL='$' -username='$' -passwd='$' -grade=# -f='$'" << endl
+        << "       the file may be a report definition or a compiled report (.orc)" << endl;
   return 0;
 }
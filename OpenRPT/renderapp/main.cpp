@@ -68,6 +68,12 @@ QStringList usage()
     << QObject::tr("-printerName=P  send output to the system printer P")
     << QObject::tr("-pdf            generate PDF output")
     << QObject::tr("-outpdf=FILE    send PDF output to FILE")
+    << QObject::tr("-pdfthreads=#   encode PDF pages on # threads (0 = one per core)")
+    << QObject::tr("-outimage=FILE  write one image per page to FILE, %1 in FILE is")
+    << QObject::tr("                replaced by the page number")
+    << QObject::tr("-imageformat=F  write images in format F (PNG, TIFF, ...)")
+    << QObject::tr("-imagedpi=#     render images at # dots per inch")
+    << QObject::tr("-imagemono      write 1 bit per pixel images")
     << ""
     << QObject::tr("-loadfromdb=RPT load the named RPT from the database")
     << ""
@@ -107,7 +113,12 @@ int main(int argc, char *argv[])
   bool    autoPrint       = false;                      //AUTOPRINT
   int     numCopies       = 1;
   bool    pdfOutput = false;
+  int     pdfThreads = -1;
   QString pdfFileName;
+  QString imageFileName;
+  QString imageFormat("PNG");
+  int     imageDpi = 200;
+  bool    imageMono = false;
 
   QString databaseURL = "";
   QString loadFromDB = "";
@@ -241,12 +252,23 @@ int main(int argc, char *argv[])
           var = XVariant::decode(type, value);
         paramList[name] = ParamPair(active, var);
       }
+      else if (argument.startsWith("-pdfthreads=", Qt::CaseInsensitive)) {
+        pdfThreads = argument.right(argument.length() - 12).toInt();
+      }
       else if (argument.startsWith("-pdf", Qt::CaseInsensitive)) {
         pdfOutput = true ;
       }
       else if (argument.startsWith("-outpdf=", Qt::CaseInsensitive)) {
         pdfFileName = argument.right(argument.length() - 8 ) ;
       }
+      else if (argument.startsWith("-outimage=", Qt::CaseInsensitive))
+        imageFileName = argument.right(argument.length() - 10);
+      else if (argument.startsWith("-imageformat=", Qt::CaseInsensitive))
+        imageFormat = argument.right(argument.length() - 13);
+      else if (argument.startsWith("-imagedpi=", Qt::CaseInsensitive))
+        imageDpi = argument.right(argument.length() - 10).toInt();
+      else if (argument.toLower() == "-imagemono")
+        imageMono = true;
       else if (argument.startsWith("-loadfromdb=", Qt::CaseInsensitive))
         loadFromDB = argument.right(argument.length() - 12);
       else if (argument.toLower() == "-e")
@@ -394,6 +416,7 @@ int main(int argc, char *argv[])
 
   mainwin._printerName = printerName;
   mainwin._autoPrint = autoPrint;
+  mainwin._pdfThreads = pdfThreads;
 
   if(!filename.isEmpty())
     mainwin.fileOpen(filename);
@@ -407,7 +430,7 @@ int main(int argc, char *argv[])
 
   // BVI::Sednacom
   // do not display window for PDF output
-  if (!pdfOutput && !autoPrint)
+  if (!pdfOutput && !autoPrint && imageFileName.isEmpty())
     mainwin.show();
   // BVI::Sednacom
 
@@ -423,6 +446,9 @@ int main(int argc, char *argv[])
     mainwin.filePrintToPDF(pdfFileName);
   // BVI::Sednacom
 
+  if (!imageFileName.isEmpty())
+    mainwin.fileExportToImages(imageFileName, imageFormat, imageDpi, imageMono);
+
   if(close)
   {
     mainwin.fileExit();
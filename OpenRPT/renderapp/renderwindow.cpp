@@ -40,6 +40,7 @@
 #include <renderobjects.h>
 #include <orprerender.h>
 #include <orprintrender.h>
+#include <orimageexport.h>
 
 #include <parameterproperties.h>
 
@@ -71,6 +72,7 @@ RenderWindow::RenderWindow(QWidget* parent, Qt::WindowFlags fl)
   connect(_table, SIGNAL(itemSelectionChanged()), this, SLOT(sSelectionChanged()));
   connect(_list, SIGNAL(clicked()), this, SLOT(sList()));
   _autoPrint = false;                    //AUTOPRINT
+  _pdfThreads = -1;                     // no -pdfthreads=, print to PDF
 }
 
 RenderWindow::~RenderWindow()
@@ -291,6 +293,7 @@ void RenderWindow::print(bool showPreview, int numCopies )
   ORPreRender pre;
   pre.setDom(_doc);
   pre.setParamList(getParameterList());
+  pre.setSpatialIndex(showPreview); // the preview paints pages by tiles
   ORODocument * doc = pre.generate();
 
   if(doc)
@@ -372,12 +375,35 @@ void RenderWindow::filePrintToPDF( QString & pdfFileName)
   pre.setParamList(getParameterList());
   ORODocument *doc = pre.generate();
   if (doc) {
-      ORPrintRender::exportToPDF(doc, pdfFileName);
+      if(_pdfThreads < 0)
+        ORPrintRender::exportToPDF(doc, pdfFileName);
+      else
+        ORPrintRender::exportToPDF(doc, pdfFileName, _pdfThreads);
       delete doc;
   }
 }
 // BVI::Sednacom
 
+void RenderWindow::fileExportToImages( const QString & fileName, const QString & format, int dpi, bool mono )
+{
+  if(fileName.isEmpty())
+    return;
+
+  ORPreRender pre;
+  pre.setDom(_doc);
+  pre.setParamList(getParameterList());
+  ORODocument *doc = pre.generate();
+  if (doc) {
+      ORImageExport exporter(doc);
+      if (dpi > 0)
+        exporter.setResolution(dpi);
+      if (mono)
+        exporter.setColorMode(ORImageExport::Monochrome);
+      exporter.exportToFiles(fileName, format.toLatin1());
+      delete doc;
+  }
+}
+
 void RenderWindow::fileExit()
 {
   qApp->closeAllWindows();
@@ -36,6 +36,7 @@ public:
 
     QString _printerName;
     bool _autoPrint;                //AUTOPRINT
+    int _pdfThreads;
 
     virtual ParameterList getParameterList();
     static QString name();
@@ -53,6 +54,7 @@ public slots:
     // declare the new member
     virtual void filePrintToPDF( QString & pdfFileName );
     // BVI::Sednacom
+    virtual void fileExportToImages( const QString & fileName, const QString & format, int dpi, bool mono );
     virtual void fileExit();
     virtual void updateParam( const QString & name, const QVariant & value, bool active );
     virtual void setDocument( const QDomDocument & doc);
@@ -0,0 +1,287 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     rptbatch renders a report straight from its command line arguments to
+ * a PDF file, a set of images or a printer. Unlike rptrender it creates no
+ * widget, never asks anything, loads no translation and runs no query but
+ * the ones of the report itself, which keeps the startup of small jobs run
+ * from cron or a service short.
+ *     With -serve it stays up and reads its jobs from the standard input
+ * instead, see RenderService.
+ *     The process runs on the offscreen platform unless QT_QPA_PLATFORM says
+ * otherwise, so it needs no display.
+ */
+
+#include <QGuiApplication>
+#include <QFile>
+#include <QSqlDatabase>
+#include <QSqlError>
+#include <QStringList>
+#include <QTextStream>
+
+#include <dbtools.h>
+#include <xsqlquery.h>
+#include <xsqlquerycache.h>
+#include <orcompiledreport.h>
+#include <orutils.h>
+
+#include "renderjob.h"
+#include "renderservice.h"
+
+static QStringList usage()
+{
+  QStringList m;
+  m << QObject::tr("rptbatch [options] [report.xml|report.orc]")
+    << ""
+    << QObject::tr("-help           display usage information")
+    << ""
+    << QObject::tr("-databaseURL=drv://host:port/dbname")
+    << QObject::tr("                log in to database dbname on the given host and port")
+    << QObject::tr("                using the Qt database driver drv")
+    << QObject::tr("-d dbname       log in to database dbname")
+    << QObject::tr("-h addr         look for the database server on host addr")
+    << QObject::tr("-p #            look for the database server on port #")
+    << QObject::tr("-P drv          use the Qt database driver drv")
+    << QObject::tr("-U x            log in as user x")
+    << QObject::tr("-username=x     log in as user x")
+    << QObject::tr("-passwd=w       log in with password w")
+    << ""
+    << QObject::tr("-loadfromdb=RPT load the named RPT from the database")
+    << ""
+    << QObject::tr("-outpdf=FILE    send PDF output to FILE")
+    << QObject::tr("-pdfthreads=#   encode PDF pages on # threads (0 = one per core)")
+    << QObject::tr("-outimage=FILE  write one image per page to FILE, %1 in FILE is")
+    << QObject::tr("                replaced by the page number")
+    << QObject::tr("-imageformat=F  write images in format F (PNG, TIFF, ...)")
+    << QObject::tr("-imagedpi=#     render images at # dots per inch")
+    << QObject::tr("-imagemono      write 1 bit per pixel images")
+    << QObject::tr("-printerName=P  send output to the system printer P")
+    << QObject::tr("-numCopies=#    produce # copies of the report on the printer")
+    << ""
+    << QObject::tr("-param='[+-]name[:type][=value]'")
+    << QObject::tr("         define/set a MetaSQL parameter with optional value and type")
+    << QObject::tr("         '-' means the parameter is defined but inactive")
+    << QObject::tr("         '+' means the parameter is active (default)")
+    << QObject::tr("-e       use the value 'Missing' for undefined parameters")
+    << QObject::tr("-bindvalues     bind the values of %n and $\"name\" in the queries")
+    << QObject::tr("                of the report instead of writing them into the text")
+    << QObject::tr("-cachequeries   keep the queries prepared on the server and run them")
+    << QObject::tr("                again for every burst part and job, not for use")
+    << QObject::tr("                on connections that run in a transaction")
+    << ""
+    << QObject::tr("-burst          write one output per value of the outermost group")
+    << QObject::tr("                of the report, {key} in the output names is replaced")
+    << QObject::tr("                by the value, otherwise it is added before the extension")
+    << ""
+    << QObject::tr("-compile=FILE   write the report compiled to FILE (.orc) instead")
+    << QObject::tr("                of rendering it")
+    << ""
+    << QObject::tr("-serve          read jobs from the standard input, one JSON object")
+    << QObject::tr("                per line, and write one JSON reply per job")
+    << QObject::tr("-workers=#      with -serve, run # jobs at once, with -burst lay out #")
+    << QObject::tr("                parts at once (default 0 = one per core)")
+    << ""
+    << QObject::tr("The exit status is 0 on success, 1 for bad arguments, 2 when the")
+    << QObject::tr("database can not be opened, 3 when the report can not be loaded")
+    << QObject::tr("and 4 when the report can not be rendered or written.")
+    << ""
+    ;
+  return m;
+}
+
+int main(int argc, char *argv[])
+{
+  RenderJob job;
+  QString username;
+  QString passwd;
+  QString hostName;
+  QString dbName;
+  QString port;
+  QString protocol("QPSQL");
+  QString databaseURL;
+  bool    serve = false;
+  QString compileFileName;
+  int     workers = 0;
+
+  if(qgetenv("QT_QPA_PLATFORM").isEmpty())
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+
+  QGuiApplication app(argc, argv);
+
+  QStringList arguments = app.arguments();
+  arguments.removeFirst();
+  for(QStringList::Iterator it = arguments.begin(); it != arguments.end(); ++it)
+  {
+    QString argument(*it);
+
+    if(argument.startsWith("-help") || argument.startsWith("--help"))
+    {
+      QTextStream(stdout) << usage().join("\n");
+      return ExitOk;
+    }
+    else if(argument.startsWith("-databaseURL=", Qt::CaseInsensitive))
+      databaseURL = argument.right(argument.length() - 13);
+    else if(argument == "-d" || argument == "-h" || argument == "-p" ||
+            argument == "-P" || argument == "-U")
+    {
+      if(++it == arguments.end())
+      {
+        QTextStream(stderr) << QObject::tr("%1 needs a value\n").arg(argument);
+        return ExitUsage;
+      }
+      if(argument == "-d")
+        dbName = *it;
+      else if(argument == "-h")
+        hostName = *it;
+      else if(argument == "-p")
+        port = *it;
+      else if(argument == "-P")
+        protocol = normalizeProtocol(*it);
+      else
+        username = *it;
+    }
+    else if(argument.startsWith("-username=", Qt::CaseInsensitive))
+      username = argument.right(argument.length() - 10);
+    else if(argument.startsWith("-passwd=", Qt::CaseInsensitive))
+      passwd = argument.right(argument.length() - 8);
+    else if(argument.startsWith("-loadfromdb=", Qt::CaseInsensitive))
+      job.reportName = argument.right(argument.length() - 12);
+    else if(argument.startsWith("-outpdf=", Qt::CaseInsensitive))
+      job.pdfFileName = argument.right(argument.length() - 8);
+    else if(argument.startsWith("-pdfthreads=", Qt::CaseInsensitive))
+      job.pdfThreads = argument.right(argument.length() - 12).toInt();
+    else if(argument.startsWith("-outimage=", Qt::CaseInsensitive))
+      job.imageFileName = argument.right(argument.length() - 10);
+    else if(argument.startsWith("-imageformat=", Qt::CaseInsensitive))
+      job.imageFormat = argument.right(argument.length() - 13);
+    else if(argument.startsWith("-imagedpi=", Qt::CaseInsensitive))
+      job.imageDpi = argument.right(argument.length() - 10).toInt();
+    else if(argument.toLower() == "-imagemono")
+      job.imageMono = true;
+    else if(argument.startsWith("-printerName=", Qt::CaseInsensitive))
+      job.printerName = argument.right(argument.length() - 13);
+    else if(argument.startsWith("-numCopies=", Qt::CaseInsensitive))
+      job.numCopies = argument.right(argument.length() - 11).toInt();
+    else if(argument.startsWith("-param=", Qt::CaseInsensitive))
+      job.addParam(argument.right(argument.length() - 7));
+    else if(argument.toLower() == "-e")
+      XSqlQuery::setNameErrorValue("Missing");
+    else if(argument.toLower() == "-bindvalues")
+      orQuery::setBindValues(true);
+    else if(argument.toLower() == "-cachequeries")
+      XSqlQueryCache::setEnabled(true);
+    else if(argument.toLower() == "-serve")
+      serve = true;
+    else if(argument.startsWith("-compile=", Qt::CaseInsensitive))
+      compileFileName = argument.right(argument.length() - 9);
+    else if(argument.toLower() == "-burst")
+      job.burst = true;
+    else if(argument.startsWith("-workers=", Qt::CaseInsensitive))
+      workers = argument.right(argument.length() - 9).toInt();
+    else if(argument.startsWith("-"))
+    {
+      QTextStream(stderr) << QObject::tr("Unknown argument %1\n").arg(argument);
+      return ExitUsage;
+    }
+    else
+      job.fileName = argument;
+  }
+
+  if(!serve)
+  {
+    if(job.fileName.isEmpty() == job.reportName.isEmpty())
+    {
+      QTextStream(stderr) << QObject::tr("Give either a report file or -loadfromdb\n");
+      return ExitUsage;
+    }
+    if(!job.hasOutput() && compileFileName.isEmpty())
+    {
+      QTextStream(stderr) << QObject::tr("Give at least one of -outpdf, -outimage, -printerName or -compile\n");
+      return ExitUsage;
+    }
+  }
+
+  // a report read from a file with no database given runs without one
+  QSqlDatabase db;
+  if(!databaseURL.isEmpty() || !dbName.isEmpty() || !job.reportName.isEmpty())
+  {
+    if(!databaseURL.isEmpty())
+      db = databaseFromURL(databaseURL);
+    else
+    {
+      db = QSqlDatabase::addDatabase(protocol);
+      db.setHostName(hostName);
+      if(!port.isEmpty())
+        db.setPort(port.toInt());
+      if(!dbName.isEmpty())
+        db.setDatabaseName(dbName);
+    }
+    db.setUserName(username);
+    if(!passwd.isNull())
+      db.setPassword(passwd);
+
+    if(!db.open())
+    {
+      QTextStream(stderr) << db.lastError().databaseText() << "\n";
+      return ExitDatabase;
+    }
+  }
+
+  if(serve)
+  {
+    // the workers open their own connections from the settings of this one
+    RenderService service(db, workers);
+    db.close();
+
+    QFile in;
+    QFile out;
+    in.open(stdin, QIODevice::ReadOnly);
+    out.open(stdout, QIODevice::WriteOnly);
+    return service.exec(&in, &out);
+  }
+
+  QString error;
+  if(!compileFileName.isEmpty())
+  {
+    // the text as it was written, it is kept in the compiled file
+    QString source;
+    if(!readDefinitionSource(job, db, source, error) ||
+       !ORCompiledReport::compile(source, compileFileName, db, &error))
+    {
+      QTextStream(stderr) << error << "\n";
+      return ExitDefinition;
+    }
+    return ExitOk;
+  }
+
+  ORReportDefinitionPtr definition;
+  if(!loadDefinition(job, db, definition, error))
+  {
+    QTextStream(stderr) << error << "\n";
+    return ExitDefinition;
+  }
+
+  job.workers = workers;
+  int result = runRenderJob(job, definition, db, error);
+  if(!error.isEmpty())
+    QTextStream(stderr) << error << "\n";
+  return result;
+}
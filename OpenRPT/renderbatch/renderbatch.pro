@@ -0,0 +1,56 @@
+#
+# OpenRPT report writer and rendering engine
+# Copyright (C) 2001-2014 by OpenMFG, LLC
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+# Please contact info@openmfg.com with any questions on this license.
+#
+
+include( ../../global.pri )
+
+TEMPLATE = app
+CONFIG += qt warn_on console
+CONFIG -= app_bundle
+INCLUDEPATH += ../common ../../common ../../../openrpt-build-desktop/common ../renderer
+
+TARGET = RPTbatch
+unix:TARGET = rptbatch
+
+OBJECTS_DIR = tmp
+MOC_DIR     = tmp
+
+QMAKE_LIBDIR = ../../lib $$QMAKE_LIBDIR
+LIBS += -lrenderer -lopenrptcommon -ldmtx -lMetaSQL
+
+win32-msvc* {
+  PRE_TARGETDEPS += ../../lib/renderer.$${LIBEXT} \
+                    ../../lib/openrptcommon.$${LIBEXT}
+} else {
+  PRE_TARGETDEPS += ../../lib/librenderer.$${LIBEXT} \
+                    ../../lib/libopenrptcommon.$${LIBEXT}
+}
+
+DESTDIR = ../../bin
+
+HEADERS += renderjob.h \
+           renderservice.h
+
+SOURCES += renderjob.cpp \
+           renderservice.cpp \
+           main.cpp
+
+# no widgets of its own, only the static builds of the libraries need them
+QT += xml sql printsupport
+win32|macx:QT += widgets
@@ -0,0 +1,479 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "renderjob.h"
+
+#include <QAtomicInt>
+#include <QDomDocument>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QObject>
+#include <QRegExp>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+
+#include <parameter.h>
+#include <parsexmlutils.h>
+#include <xsqlquery.h>
+#include <xsqlquerycache.h>
+#include <xvariant.h>
+
+#include <renderobjects.h>
+#include <orcompiledreport.h>
+#include <orprerender.h>
+#include <orprintrender.h>
+#include <orimageexport.h>
+#include <reportprinter.h>
+
+#include "builtinSqlFunctions.h"
+
+RenderJob::RenderJob()
+  : pdfThreads(-1), imageFormat("PNG"), imageDpi(200), imageMono(false), numCopies(1),
+    burst(false), workers(0)
+{
+}
+
+void RenderJob::addParam(const QString & argument)
+{
+  QString str = argument;
+  bool active = true;
+  QString name;
+  QString type;
+  QString value;
+  QVariant var;
+  int sep = str.indexOf('=');
+  if(sep == -1)
+    name = str;
+  else
+  {
+    name = str.left(sep);
+    value = str.right(str.length() - (sep + 1));
+  }
+  str = name;
+  sep = str.indexOf(':');
+  if(sep != -1)
+  {
+    name = str.left(sep);
+    type = str.right(str.length() - (sep + 1));
+  }
+  if(name.startsWith("-"))
+  {
+    name = name.right(name.length() - 1);
+    active = false;
+  }
+  else if(name.startsWith("+"))
+    name = name.right(name.length() - 1);
+  if(!value.isEmpty())
+    var = XVariant::decode(type, value);
+  params[name] = ParamPair(active, var);
+}
+
+bool RenderJob::hasOutput() const
+{
+  return !pdfFileName.isEmpty() || !imageFileName.isEmpty() || !printerName.isEmpty();
+}
+
+RenderConnection::RenderConnection(const QSqlDatabase & db)
+  : _valid(db.isValid()), _port(-1)
+{
+  if(_valid)
+  {
+    _driver = db.driverName();
+    _hostName = db.hostName();
+    _port = db.port();
+    _databaseName = db.databaseName();
+    _userName = db.userName();
+    _password = db.password();
+    _connectOptions = db.connectOptions();
+  }
+}
+
+QSqlDatabase RenderConnection::open(const QString & name) const
+{
+  if(!_valid)
+    return QSqlDatabase();
+
+  QSqlDatabase db;
+  if(QSqlDatabase::contains(name))
+    db = QSqlDatabase::database(name, false);
+  else
+  {
+    db = QSqlDatabase::addDatabase(_driver, name);
+    db.setHostName(_hostName);
+    if(_port != -1)
+      db.setPort(_port);
+    db.setDatabaseName(_databaseName);
+    db.setUserName(_userName);
+    db.setPassword(_password);
+    db.setConnectOptions(_connectOptions);
+  }
+
+  if(!db.isOpen())
+    db.open();
+  return db;
+}
+
+bool readDefinitionSource(const RenderJob & job, QSqlDatabase db, QString & source, QString & error)
+{
+  if(!job.fileName.isEmpty())
+  {
+    if(ORCompiledReport::isCompiled(job.fileName))
+      return ORCompiledReport::source(job.fileName, source, &error);
+
+    QFile file(job.fileName);
+    if(!file.open(QIODevice::ReadOnly))
+    {
+      error = QObject::tr("Could not open %1: %2").arg(job.fileName).arg(file.errorString());
+      return false;
+    }
+    source = QString::fromUtf8(file.readAll());
+    return true;
+  }
+
+  XSqlQuery rq(db);
+  rq.prepare(getSqlFromTag("fmt04", db.driverName()));
+  rq.bindValue(":report_name", job.reportName);
+  rq.exec();
+  if(!rq.first())
+  {
+    error = QObject::tr("There was an error loading the report %1 from the database.").arg(job.reportName);
+    return false;
+  }
+  source = rq.value("report_source").toString();
+  return true;
+}
+
+// the source is only read into a QDomDocument to say what is wrong with it
+static QString definitionError(const QString & source, const QString & label)
+{
+  QDomDocument doc;
+  QString errMsg;
+  int errLine, errColm;
+  if(!doc.setContent(source, &errMsg, &errLine, &errColm))
+    return QObject::tr("There was an error opening the report %1: %2 on line %3 column %4.")
+             .arg(label).arg(errMsg).arg(errLine).arg(errColm);
+  if(doc.documentElement().tagName() != "report")
+    return QObject::tr("The report %1 does not appear to be a valid report, "
+                       "the root node is not 'report'.").arg(label);
+  return QObject::tr("The report definition %1 is not valid.").arg(label);
+}
+
+bool loadDefinition(const RenderJob & job, QSqlDatabase db, ORReportDefinitionPtr & definition, QString & error)
+{
+  definition.clear();
+
+  if(job.fileName.isEmpty())
+  {
+    bool exists = false;
+    definition = ORReportCache::definition(job.reportName, db, &exists);
+    if(!definition)
+    {
+      if(exists)
+        error = QObject::tr("The report %1 in the database is not a valid report.").arg(job.reportName);
+      else
+        error = QObject::tr("There was an error loading the report %1 from the database.").arg(job.reportName);
+      return false;
+    }
+    return true;
+  }
+
+  // a compiled report is mapped and read back as it is, with no parsing
+  if(ORCompiledReport::isCompiled(job.fileName))
+  {
+    definition = ORCompiledReport::load(job.fileName, db, &error);
+    return !definition.isNull();
+  }
+
+  QString source;
+  if(!readDefinitionSource(job, db, source, error))
+    return false;
+
+  definition = ORReportDefinition::parse(source, db);
+  if(!definition->isValid())
+  {
+    error = definitionError(source, job.fileName);
+    definition.clear();
+    return false;
+  }
+  return true;
+}
+
+static ParameterList jobParams(const RenderJob & job, const ORReportData & data)
+{
+  QMap<QString,ParamPair> paramList = job.params;
+
+  // the defaults the report definition gives its parameters, the same way
+  // rptrender fills its parameter list
+  for(QMap<QString,ORParameter>::const_iterator it = data.definedParams.constBegin(); it != data.definedParams.constEnd(); ++it)
+  {
+    const ORParameter & param = it.value();
+    if(param.name.isEmpty() || paramList.contains(param.name))
+      continue;
+
+    QVariant defaultVar;
+    if(!param.defaultValue.isEmpty())
+      defaultVar = QVariant(param.defaultValue);
+    if("integer" == param.type)
+      defaultVar = defaultVar.toInt();
+    else if("double" == param.type)
+      defaultVar = defaultVar.toDouble();
+    else if("bool" == param.type)
+      defaultVar = QVariant(defaultVar.toBool());
+    else
+      defaultVar = defaultVar.toString();
+
+    paramList[param.name] = ParamPair(param.active, defaultVar);
+  }
+
+  ParameterList params;
+  for(QMap<QString,ParamPair>::const_iterator it = paramList.constBegin(); it != paramList.constEnd(); ++it)
+  {
+    if(it.value().first)
+      params.append(it.key(), it.value().second);
+  }
+  return params;
+}
+
+// writes every output the job asks for, with the names of the given part
+// of a burst if there is one
+static bool writeOutputs(const RenderJob & job, ORODocument * doc, QStringList & errors, const QString & part = QString::null)
+{
+  bool ok = true;
+
+  if(!job.pdfFileName.isEmpty())
+  {
+    QString pdfFileName = job.pdfFileName;
+    if(QFileInfo(pdfFileName).suffix().isEmpty())
+      pdfFileName.append(".pdf");
+    if(!part.isNull())
+      pdfFileName = fileNameForPart(pdfFileName, part);
+    bool exported = job.pdfThreads < 0 ? ORPrintRender::exportToPDF(doc, pdfFileName)
+                                       : ORPrintRender::exportToPDF(doc, pdfFileName, job.pdfThreads);
+    if(!exported)
+    {
+      errors << QObject::tr("Could not write %1").arg(pdfFileName);
+      ok = false;
+    }
+  }
+
+  if(!job.imageFileName.isEmpty())
+  {
+    QString imageFileName = (part.isNull() ? job.imageFileName : fileNameForPart(job.imageFileName, part));
+    ORImageExport exporter(doc);
+    if(job.imageDpi > 0)
+      exporter.setResolution(job.imageDpi);
+    if(job.imageMono)
+      exporter.setColorMode(ORImageExport::Monochrome);
+    if(!exporter.exportToFiles(imageFileName, job.imageFormat.toLatin1()))
+    {
+      errors << QObject::tr("Could not write the images to %1").arg(imageFileName);
+      ok = false;
+    }
+  }
+
+  if(!job.printerName.isEmpty())
+  {
+    ReportPrinter printer(QPrinter::HighResolution);
+    printer.setCopyCount(job.numCopies);
+    printer.setPrinterName(job.printerName);
+
+    ORPrintRender render;
+    render.setupPrinter(doc, &printer);
+    if(!render.render(doc, &printer))
+    {
+      errors << QObject::tr("Could not print to %1").arg(job.printerName);
+      ok = false;
+    }
+  }
+
+  return ok;
+}
+
+QString fileNameForPart(const QString & fileName, const QString & key)
+{
+  if(fileName.contains("{key}"))
+    return QString(fileName).replace("{key}", key);
+
+  QFileInfo fi(fileName);
+  QString suffix = fi.suffix();
+  QString base = (suffix.isEmpty() ? fileName : fileName.left(fileName.length() - suffix.length() - 1));
+  return base + "-" + key + (suffix.isEmpty() ? QString() : "." + suffix);
+}
+
+//
+// BurstState
+// What the threads laying out the parts of a burst share.
+//
+class BurstState
+{
+  public:
+    const RenderJob * job;
+    const ORPreRender * source;
+    ORReportDefinitionPtr definition; // shared by the threads, it never changes
+    RenderConnection connection;
+    ParameterList params;
+    QStringList partNames;
+
+    QAtomicInt next;
+    QMutex errorsLock;
+    QStringList errors;
+    int result;
+};
+
+// lays out and writes the parts no other thread has taken yet
+static void renderParts(BurstState * state, ORPreRender & pre)
+{
+  QStringList errors;
+  bool ok = true;
+  int part;
+  while((part = state->next.fetchAndAddOrdered(1)) < state->partNames.size())
+  {
+    ORODocument * doc = pre.generate(part);
+    if(doc == 0)
+    {
+      errors << QObject::tr("Part %1 could not be rendered.").arg(state->partNames.at(part));
+      ok = false;
+      continue;
+    }
+    if(!writeOutputs(*state->job, doc, errors, state->partNames.at(part)))
+      ok = false;
+    delete doc;
+  }
+
+  QMutexLocker locker(&state->errorsLock);
+  state->errors << errors;
+  if(!ok)
+    state->result = ExitRender;
+}
+
+class BurstTask : public QRunnable
+{
+  public:
+    BurstTask(BurstState * state, int index)
+      : _state(state), _index(index) {}
+
+    virtual void run()
+    {
+      // unique to the burst, the service may run several at once
+      QString name = QString("rptbatch-burst-%1-%2").arg((quintptr)_state, 0, 16).arg(_index);
+      {
+        QSqlDatabase db = _state->connection.open(name);
+
+        ORPreRender pre(db);
+        pre.setDefinition(_state->definition);
+        pre.setParamList(_state->params);
+        pre.shareBurst(*_state->source);
+
+        renderParts(_state, pre);
+        XSqlQueryCache::clear(db);
+      }
+      if(_state->connection.isValid())
+        QSqlDatabase::removeDatabase(name);
+    }
+
+  private:
+    BurstState * _state;
+    int _index;
+};
+
+static int runBurstJob(const RenderJob & job, ORPreRender & pre, ORReportDefinitionPtr definition, QSqlDatabase db, QString & error, int * parts)
+{
+  if(!pre.burst())
+  {
+    error = QObject::tr("The report has no group to burst on.");
+    return ExitDefinition;
+  }
+  if(parts)
+    *parts = pre.burstCount();
+
+  BurstState state;
+  state.job = &job;
+  state.source = &pre;
+  state.definition = definition;
+  state.connection = RenderConnection(db);
+  state.params = pre.paramList();
+  state.result = ExitOk;
+
+  // keys are cleaned up to be used in file names, and made unique
+  QSet<QString> used;
+  for(int i = 0; i < pre.burstCount(); i++)
+  {
+    QString name = pre.burstKey(i).replace(QRegExp("[^A-Za-z0-9._-]"), "_");
+    if(name.isEmpty())
+      name = "_";
+    if(used.contains(name))
+      name += QString("-%1").arg(i + 1);
+    used.insert(name);
+    state.partNames << name;
+  }
+
+  // the data a definition loads with <database> is only there on this
+  // connection, so its parts are all laid out here
+  if(!definition->isCacheable())
+    renderParts(&state, pre);
+  else
+  {
+    int workers = (job.workers > 0 ? job.workers : qMax(1, QThread::idealThreadCount()));
+    workers = qMin(workers, qMax(1, pre.burstCount()));
+
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
+    for(int i = 0; i < workers; i++)
+      pool.start(new BurstTask(&state, i));
+    pool.waitForDone();
+  }
+
+  error = state.errors.join("\n");
+  return state.result;
+}
+
+int runRenderJob(const RenderJob & job, ORReportDefinitionPtr definition, QSqlDatabase db, QString & error, int * pages)
+{
+  ORPreRender pre(db);
+  if(!definition || !pre.setDefinition(definition))
+  {
+    error = QObject::tr("The report definition is not valid.");
+    return ExitDefinition;
+  }
+  pre.setParamList(jobParams(job, *definition->data()));
+
+  if(job.burst)
+    return runBurstJob(job, pre, definition, db, error, pages);
+
+  ORODocument * doc = pre.generate();
+  if(!doc)
+  {
+    error = QObject::tr("The report could not be rendered.");
+    return ExitRender;
+  }
+  if(pages)
+    *pages = doc->pages();
+
+  QStringList errors;
+  int result = (writeOutputs(job, doc, errors) ? ExitOk : ExitRender);
+
+  delete doc;
+  error = errors.join("\n");
+  return result;
+}
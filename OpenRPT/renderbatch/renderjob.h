@@ -0,0 +1,116 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+#ifndef __RENDERJOB_H__
+#define __RENDERJOB_H__
+
+#include <QMap>
+#include <QPair>
+#include <QSqlDatabase>
+#include <QString>
+#include <QVariant>
+
+#include <orreportcache.h>
+
+typedef QPair<bool, QVariant> ParamPair;
+
+enum ExitCode {
+  ExitOk = 0,
+  ExitUsage = 1,
+  ExitDatabase = 2,
+  ExitDefinition = 3,
+  ExitRender = 4
+};
+
+//
+// RenderJob
+// One report to render and where to send it, as given on the command line
+// of rptbatch or in one request of its service mode.
+//
+class RenderJob
+{
+  public:
+    RenderJob();
+
+    // '[+-]name[:type][=value]', the syntax of -param
+    void addParam(const QString &);
+    bool hasOutput() const;
+
+    QString fileName;
+    QString reportName;
+    QMap<QString,ParamPair> params;
+
+    QString pdfFileName;
+    int     pdfThreads; // -1 : through the printer, else ORPdfExport threads
+    QString imageFileName;
+    QString imageFormat;
+    int     imageDpi;
+    bool    imageMono;
+    QString printerName;
+    int     numCopies;
+
+    bool    burst;   // one output per value of the outermost group
+    int     workers; // threads laying out the parts, 0 : one per core
+};
+
+//
+// RenderConnection
+// The settings of a database connection, to open the same connection again
+// on other threads.
+//
+class RenderConnection
+{
+  public:
+    RenderConnection(const QSqlDatabase & = QSqlDatabase());
+
+    bool isValid() const { return _valid; }
+
+    // the named connection of the calling thread, added and opened if need be
+    QSqlDatabase open(const QString & name) const;
+
+  protected:
+    bool _valid;
+    QString _driver;
+    QString _hostName;
+    int _port;
+    QString _databaseName;
+    QString _userName;
+    QString _password;
+    QString _connectOptions;
+};
+
+// the XML source of the report of the job, read from its file, the one a
+// compiled file (.orc) was made from, or from the report table
+bool readDefinitionSource(const RenderJob &, QSqlDatabase, QString & source, QString & error);
+// the parsed definition of the report of the job; a compiled file is loaded
+// with ORCompiledReport::load(), the reports in the database come from
+// ORReportCache, parsed once for each grade and source
+bool loadDefinition(const RenderJob &, QSqlDatabase, ORReportDefinitionPtr &, QString & error);
+
+// renders the job with the given definition on the given connection and
+// writes all its outputs; returns one of ExitCode
+// with job.burst set the parts are laid out on job.workers threads, each
+// with its own connection, all sharing the definition, and pages counts the parts
+int runRenderJob(const RenderJob &, ORReportDefinitionPtr, QSqlDatabase, QString & error, int * pages = 0);
+
+// the name of the output of one part of a burst: {key} in the name is
+// replaced by the key, otherwise the key is added before the extension
+QString fileNameForPart(const QString &, const QString & key);
+
+#endif // __RENDERJOB_H__
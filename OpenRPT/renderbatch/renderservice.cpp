@@ -0,0 +1,241 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "renderservice.h"
+#include "renderjob.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QFontDatabase>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QMutexLocker>
+#include <QRunnable>
+#include <QSqlError>
+#include <QSqlQuery>
+#include <QThread>
+
+#include <xsqlquerycache.h>
+
+//
+// RenderServiceTask
+// Runs one request on a worker thread.
+//
+class RenderServiceTask : public QRunnable
+{
+  public:
+    RenderServiceTask(RenderService * service, const QJsonObject & request)
+      : _service(service), _request(request) {}
+
+    virtual void run()
+    {
+      _service->runJob(_request);
+    }
+
+  private:
+    RenderService * _service;
+    QJsonObject _request;
+};
+
+RenderService::RenderService(const QSqlDatabase & prototype, int workers)
+  : _connection(prototype), _output(0)
+{
+  _pool.setMaxThreadCount(workers > 0 ? workers : qMax(1, QThread::idealThreadCount()));
+  // the threads hold the warm connections, keep them
+  _pool.setExpiryTimeout(-1);
+}
+
+RenderService::~RenderService()
+{
+  _pool.waitForDone();
+}
+
+int RenderService::exec(QIODevice * in, QIODevice * out)
+{
+  _output = out;
+
+  // load the font database now rather than in the first job
+  (void)QFontDatabase().families();
+
+  while(true)
+  {
+    QByteArray line = in->readLine();
+    if(line.isEmpty()) // a blank line still has its newline
+      break;
+
+    line = line.trimmed();
+    if(line.isEmpty())
+      continue;
+
+    QJsonParseError parseError;
+    QJsonDocument request = QJsonDocument::fromJson(line, &parseError);
+    if(!request.isObject())
+    {
+      QJsonObject result;
+      result.insert("ok", false);
+      result.insert("error", QObject::tr("Not a JSON object: %1").arg(parseError.errorString()));
+      reply(result);
+      continue;
+    }
+
+    QJsonObject obj = request.object();
+    if(obj.value("command").toString() == "reload")
+    {
+      clearDefinitions();
+      QJsonObject result;
+      if(obj.contains("id"))
+        result.insert("id", obj.value("id"));
+      result.insert("ok", true);
+      reply(result);
+      continue;
+    }
+
+    _pool.start(new RenderServiceTask(this, obj));
+  }
+
+  _pool.waitForDone();
+  return ExitOk;
+}
+
+void RenderService::runJob(const QJsonObject & request)
+{
+  QElapsedTimer timer;
+  timer.start();
+
+  RenderJob job;
+  job.fileName = request.value("file").toString();
+  job.reportName = request.value("report").toString();
+  QJsonArray params = request.value("params").toArray();
+  for(int i = 0; i < params.size(); i++)
+    job.addParam(params.at(i).toString());
+  job.pdfFileName = request.value("pdf").toString();
+  job.pdfThreads = request.value("pdfthreads").toInt(job.pdfThreads);
+  job.imageFileName = request.value("image").toString();
+  job.imageFormat = request.value("imageformat").toString(job.imageFormat);
+  job.imageDpi = request.value("imagedpi").toInt(job.imageDpi);
+  job.imageMono = request.value("imagemono").toBool(job.imageMono);
+  job.printerName = request.value("printer").toString();
+  job.numCopies = request.value("copies").toInt(job.numCopies);
+  job.burst = request.value("burst").toBool(job.burst);
+  job.workers = request.value("workers").toInt(job.workers);
+
+  QJsonObject result;
+  if(request.contains("id"))
+    result.insert("id", request.value("id"));
+
+  QString error;
+  int pages = 0;
+  int status = ExitUsage;
+  QSqlDatabase db = connection();
+
+  if(job.fileName.isEmpty() == job.reportName.isEmpty())
+    error = QObject::tr("Give either a file or a report");
+  else if(!job.hasOutput())
+    error = QObject::tr("Give at least one of pdf, image or printer");
+  else if(_connection.isValid() && !db.isOpen())
+  {
+    error = db.lastError().databaseText();
+    status = ExitDatabase;
+  }
+  else
+  {
+    ORReportDefinitionPtr def;
+    status = ExitDefinition;
+    if(definition(job, db, def, error))
+      status = runRenderJob(job, def, db, error, &pages);
+  }
+
+  // a failed job may be the sign of a lost connection, let the next job
+  // of this thread open a new one if so
+  if(status != ExitOk && db.isOpen())
+  {
+    QSqlQuery probe(db);
+    if(!probe.exec("SELECT 1;"))
+    {
+      XSqlQueryCache::close(db);
+    }
+  }
+
+  result.insert("ok", status == ExitOk);
+  result.insert("pages", pages);
+  result.insert("ms", (double)timer.elapsed());
+  if(!error.isEmpty())
+    result.insert("error", error);
+  reply(result);
+}
+
+// one connection per worker thread, opened by its first job and kept open
+QSqlDatabase RenderService::connection()
+{
+  return _connection.open(QString("rptbatch-%1").arg((quintptr)QThread::currentThreadId(), 0, 16));
+}
+
+bool RenderService::definition(const RenderJob & job, QSqlDatabase db, ORReportDefinitionPtr & def, QString & error)
+{
+  // ORReportCache checks the grade and source of the report on every call
+  if(job.fileName.isEmpty())
+    return loadDefinition(job, db, def, error);
+
+  QFileInfo fi(job.fileName);
+  QString key = fi.absoluteFilePath();
+  QDateTime modified = fi.lastModified();
+  {
+    QMutexLocker locker(&_definitionsLock);
+    QHash<QString, CachedDefinition>::const_iterator it = _definitions.constFind(key);
+    if(it != _definitions.constEnd() && it.value().modified == modified)
+    {
+      def = it.value().definition;
+      return true;
+    }
+  }
+
+  if(!loadDefinition(job, db, def, error))
+    return false;
+
+  // one that loads data with <database> has to be parsed on every run
+  if(def->isCacheable())
+  {
+    CachedDefinition cached;
+    cached.definition = def;
+    cached.modified = modified;
+
+    QMutexLocker locker(&_definitionsLock);
+    _definitions.insert(key, cached);
+  }
+  return true;
+}
+
+void RenderService::clearDefinitions()
+{
+  {
+    QMutexLocker locker(&_definitionsLock);
+    _definitions.clear();
+  }
+  ORReportCache::clear();
+}
+
+void RenderService::reply(const QJsonObject & result)
+{
+  QMutexLocker locker(&_outputLock);
+  _output->write(QJsonDocument(result).toJson(QJsonDocument::Compact) + "\n");
+  if(QFile * file = qobject_cast<QFile*>(_output))
+    file->flush();
+}
@@ -0,0 +1,87 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+#ifndef __RENDERSERVICE_H__
+#define __RENDERSERVICE_H__
+
+#include <QDateTime>
+#include <QHash>
+#include <QIODevice>
+#include <QJsonObject>
+#include <QMutex>
+#include <QSqlDatabase>
+#include <QString>
+#include <QThreadPool>
+
+#include "renderjob.h"
+
+//
+// RenderService
+// The service mode of rptbatch. Requests are read from a device one JSON
+// object per line and run on a pool of worker threads; one JSON object per
+// line is written back for each of them, in the order they finish.
+//
+// A request names a report file ("file") or a report in the database
+// ("report"), its parameters ("params", a list in the syntax of -param) and
+// its outputs ("pdf", "pdfthreads", "image", "imageformat", "imagedpi",
+// "imagemono", "printer", "copies"); "burst" set to true writes one output
+// per value of the outermost group, laid out on "workers" threads. Its "id", if any, is sent back in the
+// reply along with "ok", "pages", "ms" and "error".
+// {"command":"reload"} forgets the cached report definitions.
+//
+// Every worker thread keeps its own database connection open from one job
+// to the next. The definitions are parsed once and shared by all the jobs
+// and burst threads that use them: those of files until the file changes on
+// disk, those of the database in ORReportCache until their grade or source
+// changes.
+//
+class RenderService
+{
+  public:
+    RenderService(const QSqlDatabase & prototype, int workers);
+    virtual ~RenderService();
+
+    // returns when the input ends, after the last job is done
+    int exec(QIODevice * in, QIODevice * out);
+
+    void runJob(const QJsonObject &);
+
+  protected:
+    QSqlDatabase connection();
+    bool definition(const RenderJob &, QSqlDatabase, ORReportDefinitionPtr &, QString & error);
+    void clearDefinitions();
+    void reply(const QJsonObject &);
+
+    struct CachedDefinition {
+      ORReportDefinitionPtr definition;
+      QDateTime modified;
+    };
+
+    RenderConnection _connection;
+
+    QThreadPool _pool;
+
+    QMutex _definitionsLock;
+    QHash<QString, CachedDefinition> _definitions;
+
+    QMutex _outputLock;
+    QIODevice * _output;
+};
+
+#endif // __RENDERSERVICE_H__
@@ -0,0 +1,112 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     This file contains the cache of encoded 1D barcodes and the code that
+ * draws them. The symbologies only encode a value into a list of bars and
+ * spaces once; every later render of the same value reuses that list and
+ * fills all the bars of the symbol as a single path.
+ */
+
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainter>
+#include <QPainterPath>
+#include <QPen>
+#include <QBrush>
+
+#include "renderobjects.h"
+#include "barcodes.h"
+
+typedef QCache<QString, ORBarcodeRuns> ORBarcodeRunsCache;
+
+// the renderers may run on several threads at once (preview, exports)
+Q_GLOBAL_STATIC_WITH_ARGS(ORBarcodeRunsCache, barcodeRunsCache, (20000))
+Q_GLOBAL_STATIC(QMutex, barcodeRunsLock)
+
+static QString barcodeRunsKey(const QString &format, const QString &data)
+{
+  return format + QChar(0) + data;
+}
+
+bool cachedBarcodeRuns(const QString &format, const QString &data, ORBarcodeRuns &runs)
+{
+  QMutexLocker locker(barcodeRunsLock());
+  ORBarcodeRuns * cached = barcodeRunsCache()->object(barcodeRunsKey(format, data));
+  if(cached == 0)
+    return false;
+  runs = *cached;
+  return true;
+}
+
+void cacheBarcodeRuns(const QString &format, const QString &data, const ORBarcodeRuns &runs)
+{
+  QMutexLocker locker(barcodeRunsLock());
+  barcodeRunsCache()->insert(barcodeRunsKey(format, data), new ORBarcodeRuns(runs));
+}
+
+void drawBarcodeRuns(QPainter *painter, int dpi, const QRectF &r, const ORBarcodeRuns &runs, OROBarcode *bc)
+{
+  qreal narrow_bar = bc->narrowBarWidth() * dpi;
+
+  // this is our mandatory minimum quiet zone
+  qreal quiet_zone = narrow_bar * 10;
+  if(quiet_zone < 0.1 * dpi)
+    quiet_zone = 0.1 * dpi;
+
+  // what kind of area do we have to work with
+  qreal draw_width = r.width();
+  qreal draw_height = r.height();
+
+  qreal L = runs.length * narrow_bar;
+
+  // calculate the starting position based on the alignment option
+  // for left align we don't need to do anything as the values are already setup for it
+  if(bc->align() == 1) // center
+  {
+    qreal nqz = (draw_width - L) / 2.0;
+    if(nqz > quiet_zone)
+      quiet_zone = nqz;
+  }
+  else if(bc->align() > 1) // right
+    quiet_zone = draw_width - (L + quiet_zone);
+  //else if(align < 1) {} // left : do nothing
+
+  qreal pos = r.left() + quiet_zone;
+  qreal top = r.top();
+
+  QPainterPath bars;
+  bars.setFillRule(Qt::WindingFill);
+  for(int i = 0; i < runs.elements.size(); i++)
+  {
+    qreal element = runs.elements.at(i);
+    qreal w = qAbs(element) * narrow_bar;
+    if(element > 0)
+      bars.addRect(QRectF(pos, top, w, draw_height));
+    pos += w;
+  }
+
+  painter->save();
+  painter->setPen(QPen(Qt::NoPen));
+  painter->setBrush(QBrush(QColor("black")));
+  painter->drawPath(bars);
+  painter->restore();
+}
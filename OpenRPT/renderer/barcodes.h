@@ -23,10 +23,26 @@
 
 #include <QRect>
 #include <QString>
+#include <QVector>
 
 class ORBarcodeData;
 class OROBarcode;
 class OROPage;
+class QPainter;
+
+//
+// Encoded 1D barcode
+// The widths of the bars and spaces of a symbol, in narrow bar widths,
+// bars positive and spaces negative, with the length used for alignment.
+//
+struct ORBarcodeRuns {
+  QVector<qreal> elements;
+  qreal length;
+};
+
+bool cachedBarcodeRuns(const QString &format, const QString &data, ORBarcodeRuns &);
+void cacheBarcodeRuns(const QString &format, const QString &data, const ORBarcodeRuns &);
+void drawBarcodeRuns(QPainter *, int, const QRectF &, const ORBarcodeRuns &, OROBarcode * bc);
 
 //
 // 3of9
@@ -213,186 +213,138 @@ int digitsSpan(const QString &str, int i)
 
 void renderCode128(QPainter *painter, int dpi, const QRectF &r, const QString &_str, OROBarcode *bc)
 {
-  QVector<int> str;
-  int i = 0;
-
-  // create the list.. if the list is empty then just set a start code and move on
-  if(_str.isEmpty())
-    str.push_back(104);
-  else
+  ORBarcodeRuns runs;
+  if(!cachedBarcodeRuns("128", _str, runs))
   {
-    int rank_a = 0;
-    int rank_b = 0;
+    QVector<int> str;
+    int i = 0;
 
-    QChar c;
-    for(i = 0; i < _str.length(); i++)
+    // create the list.. if the list is empty then just set a start code and move on
+    if(_str.isEmpty())
+      str.push_back(104);
+    else
     {
-      c = _str.at(i);
-      rank_a += (code128Index(c, SETA) != -1 ? 1 : 0);
-      rank_b += (code128Index(c, SETB) != -1 ? 1 : 0);
-    }
+      int rank_a = 0;
+      int rank_b = 0;
 
-    // start in the mode that had the higher number of hits...
-    int currentMode = rank_a > rank_b ? SETA : SETB;
-    int defaultMode = currentMode;
-    //... or in C mode
-    if (digitsSpan(_str, 0) >= 4)
-    {
-      currentMode = SETC;
-    }
+      QChar c;
+      for(i = 0; i < _str.length(); i++)
+      {
+        c = _str.at(i);
+        rank_a += (code128Index(c, SETA) != -1 ? 1 : 0);
+        rank_b += (code128Index(c, SETB) != -1 ? 1 : 0);
+      }
 
-    // write start character
-    switch (currentMode)
-    {
-      case SETA : str.push_back(103); break;
-      case SETB : str.push_back(104); break;
-      case SETC : str.push_back(105); break;
-      default: return;
-    }
+      // start in the mode that had the higher number of hits...
+      int currentMode = rank_a > rank_b ? SETA : SETB;
+      int defaultMode = currentMode;
+      //... or in C mode
+      if (digitsSpan(_str, 0) >= 4)
+      {
+        currentMode = SETC;
+      }
 
-    for(i = 0; i < _str.length(); )
-    {
-      int nbOfDigits = digitsSpan(_str, i);
-      if(nbOfDigits >=4)
+      // write start character
+      switch (currentMode)
       {
-        switchTo(&str, &currentMode, SETC);
-        for( int iterNb = nbOfDigits/2; iterNb > 0; i+=2, iterNb--)
-        {
-          char a, b;
-          c = _str.at(i);
-          a = c.toLatin1();
-          a -= 48;
-          c = _str.at(i+1);
-          b = c.toLatin1();
-          b -= 48;
-          str.push_back(int((a * 10) + b));
-        }
+        case SETA : str.push_back(103); break;
+        case SETB : str.push_back(104); break;
+        case SETC : str.push_back(105); break;
+        default: return;
       }
-      else
+
+      for(i = 0; i < _str.length(); )
       {
-        c = _str.at(i);
-        int testMode = defaultMode;
-        int v = code128Index(c, testMode);
-        if(v == -1)
+        int nbOfDigits = digitsSpan(_str, i);
+        if(nbOfDigits >=4)
         {
-          testMode = (testMode == SETA ? SETB : SETA);
-          v = code128Index(c, testMode);
-          if(v != -1)
+          switchTo(&str, &currentMode, SETC);
+          for( int iterNb = nbOfDigits/2; iterNb > 0; i+=2, iterNb--)
           {
-            switchTo(&str, &currentMode, testMode);
-            str.push_back(v);
+            char a, b;
+            c = _str.at(i);
+            a = c.toLatin1();
+            a -= 48;
+            c = _str.at(i+1);
+            b = c.toLatin1();
+            b -= 48;
+            str.push_back(int((a * 10) + b));
           }
         }
         else
         {
-          switchTo(&str, &currentMode, testMode);
-          str.push_back(v);
+          c = _str.at(i);
+          int testMode = defaultMode;
+          int v = code128Index(c, testMode);
+          if(v == -1)
+          {
+            testMode = (testMode == SETA ? SETB : SETA);
+            v = code128Index(c, testMode);
+            if(v != -1)
+            {
+              switchTo(&str, &currentMode, testMode);
+              str.push_back(v);
+            }
+          }
+          else
+          {
+            switchTo(&str, &currentMode, testMode);
+            str.push_back(v);
+          }
+          i++;
         }
-        i++;
       }
     }
-  }
-
-  // calculate and append the checksum value to the list
-  int checksum = str.at(0);
-  for(i = 1; i < str.size(); i++)
-    checksum += (str.at(i) * i);
-  checksum = checksum % 103;
-  str.push_back(checksum);
-
-  // lets determine some core attributes about this barcode
-  qreal bar_width = bc->narrowBarWidth() * dpi;
-
-  // this is are mandatory minimum quiet zone
-  qreal quiet_zone = bar_width * 10;
-  if(quiet_zone < 0.1 * dpi)
-    quiet_zone = 0.1 * dpi;
-
-  // what kind of area do we have to work with
-  qreal draw_width = r.width();
-  qreal draw_height = r.height();
-
-  // how long is the value we need to encode?
-  int val_length = str.size() - 2; // we include start and checksum in are list so
-                                   // subtract them out for our calculations
-
-  // L = (11C + 35)X 
-  // L length of barcode (excluding quite zone) in units same as X and I
-  // C the number of characters in the value excluding the start/stop and checksum characters
-  // X the width of a bar (pixels in our case)
-  qreal L;
-
-  qreal C = val_length;
-  qreal X = bar_width;
-
-  L = (((11.0 * C) + 35.0) * X);
-
-  // now we have the actual width the barcode will be so can determine the actual
-  // size of the quiet zone (we assume we center the barcode in the given area
-  // what should we do if the area is too small????
-  // At the moment the way the code is written is we will always start at the minimum
-  // required quiet zone if we don't have enough space.... I guess we'll just have over-run
-  // to the right
-  //
-  // calculate the starting position based on the alignment option
-  // for left align we don't need to do anything as the values are already setup for it
-  if(bc->align() == 1) // center
-  {
-    qreal nqz = (draw_width - L) / 2.0;
-    if(nqz > quiet_zone)
-      quiet_zone = nqz;
-  }
-  else if(bc->align() > 1) // right
-    quiet_zone = draw_width - (L + quiet_zone);
-  // else if(align < 1) {} // left : do nothing
-
-  qreal pos = r.left() + quiet_zone;
-  qreal top = r.top();
 
-  QPen pen(Qt::NoPen);
-  QBrush brush(QColor("black"));
-  painter->save();
-  painter->setPen(pen);
-  painter->setBrush(brush);
-
-  bool space = false;
-  int idx = 0, b = 0;
-  qreal w = 0.0;
-  for(i = 0; i < str.size(); i++)
-  {
-    // loop through each value and render the barcode
-    idx = str.at(i);
-    if(idx < 0 || idx > 105)
-    {
-      qDebug("Encountered a non-compliant element while rendering a 3of9 barcode -- skipping");
-      continue;
-    }
-    space = false;
-    for(b = 0; b < 6; b++, space = !space)
+    // calculate and append the checksum value to the list
+    int checksum = str.at(0);
+    for(i = 1; i < str.size(); i++)
+      checksum += (str.at(i) * i);
+    checksum = checksum % 103;
+    str.push_back(checksum);
+
+    // how long is the value we need to encode?
+    int val_length = str.size() - 2; // we include start and checksum in are list so
+                                     // subtract them out for our calculations
+
+    // L = (11C + 35)X
+    // L length of barcode (excluding quite zone) in units same as X and I
+    // C the number of characters in the value excluding the start/stop and checksum characters
+    // X the width of a bar (one unit here)
+    qreal C = val_length;
+    runs.length = (11.0 * C) + 35.0;
+
+    bool space = false;
+    int idx = 0, b = 0;
+    for(i = 0; i < str.size(); i++)
     {
-      w = _128codes[idx].values[b] * bar_width;
-      if(!space)
+      // loop through each value and encode the barcode
+      idx = str.at(i);
+      if(idx < 0 || idx > 105)
+      {
+        qDebug("Encountered a non-compliant element while rendering a 3of9 barcode -- skipping");
+        continue;
+      }
+      space = false;
+      for(b = 0; b < 6; b++, space = !space)
       {
-        painter->drawRect(QRectF(pos,top, w,draw_height));
+        qreal w = _128codes[idx].values[b];
+        runs.elements.append(space ? -w : w);
       }
-      pos += w;
     }
-  }
 
-  // we have to do the stop character seperatly like this because it has
-  // 7 elements in it's bar sequence rather than 6 like the others
-  int STOP_CHARACTER[]={ 2, 3, 3, 1, 1, 1, 2 };
-  space = false;
-  for(b = 0; b < 7; b++, space = !space)
-  {
-    w = STOP_CHARACTER[b] * bar_width;
-    if(!space)
+    // we have to do the stop character seperatly like this because it has
+    // 7 elements in it's bar sequence rather than 6 like the others
+    int STOP_CHARACTER[]={ 2, 3, 3, 1, 1, 1, 2 };
+    space = false;
+    for(b = 0; b < 7; b++, space = !space)
     {
-      painter->drawRect(QRectF(pos,top, w,draw_height));
+      qreal w = STOP_CHARACTER[b];
+      runs.elements.append(space ? -w : w);
     }
-    pos += w;
+
+    cacheBarcodeRuns("128", _str, runs);
   }
 
-  painter->restore();
-  return;
-} 
+  drawBarcodeRuns(painter, dpi, r, runs, bc);
+}
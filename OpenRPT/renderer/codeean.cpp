@@ -27,6 +27,7 @@
 #include <QString>
 #include <QRect>
 #include <QPainter>
+#include <QPainterPath>
 #include <QPen>
 #include <QBrush>
 
@@ -171,13 +172,17 @@ void renderCodeEAN13(QPainter *painter, int dpi, const QRectF & r, const QString
   painter->setPen(pen);
   painter->setBrush(brush);
 
+  // the bars are filled at once, as a single path
+  QPainterPath bars;
+  bars.setFillRule(Qt::WindingFill);
+
   int b = 0;
   int w = 0;
 
   // render open guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += bar_width;
 
   // render first set
@@ -188,7 +193,7 @@ void renderCodeEAN13(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][_parity[val[0]][i]][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-(0.07*dpi)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-(0.07*dpi)));
       }
       pos += bar_width;
     }
@@ -196,9 +201,9 @@ void renderCodeEAN13(QPainter *painter, int dpi, const QRectF & r, const QString
 
   // render center guard
   pos += bar_width;
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
 
   // render last set
@@ -209,16 +214,16 @@ void renderCodeEAN13(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][RIGHTHAND][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-(0.07*dpi)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-(0.07*dpi)));
       }
       pos += bar_width;
     }
   }
 
   // render close guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
 
   QString parstr = QString("%1").arg(val[0]);
   QString leftstr = QString().sprintf("%d%d%d%d%d%d",
@@ -226,6 +231,8 @@ void renderCodeEAN13(QPainter *painter, int dpi, const QRectF & r, const QString
   QString rightstr = QString().sprintf("%d%d%d%d%d%d",
                      val[7], val[8], val[9], val[10], val[11], val[12]);
 
+  painter->drawPath(bars);
+
   painter->setFont(QFont("Arial", 6));
   painter->setPen(QPen(Qt::SolidLine));
 
@@ -332,13 +339,17 @@ void renderCodeUPCA(QPainter *painter, int dpi, const QRectF & r, const QString
   painter->setPen(pen);
   painter->setBrush(brush);
 
+  // the bars are filled at once, as a single path
+  QPainterPath bars;
+  bars.setFillRule(Qt::WindingFill);
+
   int b = 0;
   int w = 0;
 
   // render open guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += bar_width;
 
   // render first set
@@ -349,7 +360,7 @@ void renderCodeUPCA(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][_parity[val[0]][i]][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-dpi*(i==0?0:0.07)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-dpi*(i==0?0:0.07)));
       }
       pos += bar_width;
     }
@@ -357,9 +368,9 @@ void renderCodeUPCA(QPainter *painter, int dpi, const QRectF & r, const QString
 
   // render center guard
   pos += bar_width;
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
 
   // render last set
@@ -370,16 +381,16 @@ void renderCodeUPCA(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][RIGHTHAND][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-dpi*(i==5?0:0.07)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-dpi*(i==5?0:0.07)));
       }
       pos += bar_width;
     }
   }
 
   // render close guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
 
   QString parstr = QString("%1").arg(val[1]);
   QString chkstr = QString("%1").arg(val[12]);
@@ -388,6 +399,8 @@ void renderCodeUPCA(QPainter *painter, int dpi, const QRectF & r, const QString
   QString rightstr = QString().sprintf("%d%d%d%d%d",
 		     val[7], val[8], val[9], val[10], val[11]);
 
+  painter->drawPath(bars);
+
   painter->setFont(QFont("Arial", 6));
   painter->setPen(QPen(Qt::SolidLine));
 
@@ -497,13 +510,17 @@ void renderCodeEAN8(QPainter *painter, int dpi, const QRectF & r, const QString
   painter->setPen(pen);
   painter->setBrush(brush);
 
+  // the bars are filled at once, as a single path
+  QPainterPath bars;
+  bars.setFillRule(Qt::WindingFill);
+
   int b = 0;
   int w = 0;
 
   // render open guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += bar_width;
 
   // render first set
@@ -514,7 +531,7 @@ void renderCodeEAN8(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][LEFTHAND_ODD][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-(0.06*dpi)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-(0.06*dpi)));
       }
       pos += bar_width;
     }
@@ -522,9 +539,9 @@ void renderCodeEAN8(QPainter *painter, int dpi, const QRectF & r, const QString
 
   // render center guard
   pos += bar_width;
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
 
   // render last set
@@ -535,22 +552,24 @@ void renderCodeEAN8(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][RIGHTHAND][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-(0.06*dpi)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-(0.06*dpi)));
       }
       pos += bar_width;
     }
   }
 
   // render close guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
 
   QString leftstr = QString().sprintf("%d%d%d%d",
 		     val[0], val[1], val[2], val[3]);
   QString rightstr = QString().sprintf("%d%d%d%d",
 		     val[4], val[5], val[6], val[7]);
 
+  painter->drawPath(bars);
+
   painter->setFont(QFont("Arial", 6));
   painter->setPen(QPen(Qt::SolidLine));
 
@@ -647,13 +666,17 @@ void renderCodeUPCE(QPainter *painter, int dpi, const QRectF & r, const QString
   painter->setPen(pen);
   painter->setBrush(brush);
 
+  // the bars are filled at once, as a single path
+  QPainterPath bars;
+  bars.setFillRule(Qt::WindingFill);
+
   int b = 0;
   int w = 0;
 
   // render open guard
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += bar_width;
 
   // render first set
@@ -664,7 +687,7 @@ void renderCodeUPCE(QPainter *painter, int dpi, const QRectF & r, const QString
     {
       if(_encodings[b][_upcparenc[val[7]][val[0]][i]][w])
       {
-        painter->drawRect(QRectF(pos,top, bar_width,draw_height-(0.07*dpi)));
+        bars.addRect(QRectF(pos,top, bar_width,draw_height-(0.07*dpi)));
       }
       pos += bar_width;
     }
@@ -672,20 +695,22 @@ void renderCodeUPCE(QPainter *painter, int dpi, const QRectF & r, const QString
 
   // render center guard
   pos += bar_width;
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
   pos += (bar_width * 2.0);
 
   // render close guard
 
-  painter->drawRect(QRectF(pos,top, bar_width,draw_height));
+  bars.addRect(QRectF(pos,top, bar_width,draw_height));
 
   QString parstr = QString("%1").arg(val[0]);
   QString chkstr = QString("%1").arg(val[7]);
   QString leftstr = QString().sprintf("%d%d%d%d%d%d",
 		     val[1], val[2], val[3], val[4], val[5], val[6]);
 
+  painter->drawPath(bars);
+
   painter->setFont(QFont("Arial", 6));
   painter->setPen(QPen(Qt::SolidLine));
 
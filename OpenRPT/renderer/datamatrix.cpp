@@ -5,6 +5,12 @@
 #include <QBrush>
 #include <qimage.h>
 #include <QRegExp>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QPainterPath>
+#include <QVector>
 
 #include "parsexmlutils.h"
 #include "renderobjects.h"
@@ -41,9 +47,9 @@ static void printRR(QPainter *painter, const QRectF &qrect)
   }
 }
 
-static void datamatrixGeometry(QString &inFormat, const QRectF &inQrect,DmtxImage *inImg, qreal *outXo, qreal *outYo, qreal *outPas)
+static void datamatrixGeometry(QString &inFormat, const QRectF &inQrect, int inWidth, int inHeight, qreal *outXo, qreal *outYo, qreal *outPas)
 {
-  *outPas =  std::min(inQrect.width()/inImg->width, inQrect.height()/inImg->height);
+  *outPas =  std::min(inQrect.width()/inWidth, inQrect.height()/inHeight);
   *outYo = inQrect.bottom();
 
   //alignement left
@@ -56,18 +62,91 @@ static void datamatrixGeometry(QString &inFormat, const QRectF &inQrect,DmtxImag
   if(inFormat == "C")
   {
 		qreal Xc = (inQrect.left() + inQrect.right()) / 2;
-    *outXo = Xc - (((qreal)inImg->width) * (*outPas));
+    *outXo = Xc - (((qreal)inWidth) * (*outPas));
   }
 
   //alignement Rigth
   if(inFormat == "R")
   {
-    *outXo = inQrect.right() - (*outPas * inImg->width);
+    *outXo = inQrect.right() - (*outPas * inWidth);
   }
 }
 
+//
+// The modules of an encoded symbol, one bit per module and a set bit for
+// a dark one. A symbol that could not be encoded has no modules at all.
+//
+struct DmtxModules {
+  DmtxModules() : width(0), height(0) {}
 
-DmtxInfos extractInfosDtmx(const QString &s)
+  bool isDark(int x, int y) const
+  {
+    int bit = y * width + x;
+    return (bits.at(bit >> 5) >> (bit & 31)) & 1;
+  }
+
+  void setDark(int x, int y)
+  {
+    int bit = y * width + x;
+    bits[bit >> 5] |= (quint32(1) << (bit & 31));
+  }
+
+  int width;
+  int height;
+  QVector<quint32> bits;
+};
+
+typedef QCache<QString, DmtxModules> DmtxModulesCache;
+
+// the renderers may run on several threads at once (preview, exports).
+// Counted in symbols like the cache of 1D barcodes; the largest one,
+// 144x144 modules, takes under 3 KB.
+Q_GLOBAL_STATIC_WITH_ARGS(DmtxModulesCache, dmtxModulesCache, (2000))
+Q_GLOBAL_STATIC(QMutex, dmtxModulesLock)
+
+static void encodeDatamatrix(int type, const QString &qstr, DmtxModules &modules)
+{
+  DmtxEncode *enc = dmtxEncodeCreate();
+  if(enc == NULL)
+    return;
+
+  //see DmtxSymbolSize in dmtx.h for more details
+  enc->sizeIdxRequest = type;
+  enc->marginSize = 0;
+  //number of pixel for one square
+  enc->moduleSize = 1;
+
+  QByteArray data = QByteArray(qstr.toStdString().c_str());
+  if(dmtxEncodeDataMatrix(enc, qstr.size(), (unsigned char*)data.data()) == DmtxPass && enc->image != NULL)
+  {
+    int width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    int height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+
+    if(width > 0 && height > 0)
+    {
+      modules.width = width;
+      modules.height = height;
+      modules.bits.fill(0, (width * height + 31) / 32);
+
+      // the encoder image has the same packing and orientation the copy
+      // we used to make of it had, so the modules are read in place
+      int valeur = 0;
+      for(int y = 0; y < height; y++)
+      {
+        for(int x = 0; x < width; x++)
+        {
+          dmtxImageGetPixelValue(enc->image, x, y, 0, &valeur);
+          if(valeur == 0)
+            modules.setDark(x, y);
+        }
+      }
+    }
+  }
+
+  dmtxEncodeDestroy(&enc);
+}
+
+static DmtxInfos parseInfosDtmx(const QString &s)
 {
   const int sizes[][2] = {
       {10,10},
@@ -122,28 +201,48 @@ DmtxInfos extractInfosDtmx(const QString &s)
 }
 
 
+DmtxInfos extractInfosDtmx(const QString &s)
+{
+  static QHash<QString, DmtxInfos> infos;
+
+  QMutexLocker locker(dmtxModulesLock());
+  QHash<QString, DmtxInfos>::const_iterator it = infos.constFind(s);
+  if(it != infos.constEnd())
+    return it.value();
+
+  DmtxInfos res = parseInfosDtmx(s);
+  infos.insert(s, res);
+  return res;
+}
+
+
 void renderCodeDatamatrix(QPainter *painter, const QRectF &qrect, const QString &qstr, OROBarcode * bc)
 {
 
   //lecture du type de datamatrix
   DmtxInfos dmtxInfos = extractInfosDtmx(bc->format());
 
-  size_t          width, height, bytesPerPixel;
-
-  //pointer declaration
-  unsigned char  *pxl = NULL;
-  DmtxEncode     *enc = NULL;
-  DmtxImage      *img = NULL;
-  int valeur = 0;
-
-  /* 1) ENCODE a new Data Matrix barcode image (in memory only) */
-  enc = dmtxEncodeCreate();
+  // the same value is encoded only once, the symbol is then kept as a
+  // bitset of its modules
+  QString key = bc->format() + QChar(0) + qstr;
+  DmtxModules modules;
+  bool cached = false;
+  {
+    QMutexLocker locker(dmtxModulesLock());
+    DmtxModules * m = dmtxModulesCache()->object(key);
+    if(m != 0)
+    {
+      modules = *m;
+      cached = true;
+    }
+  }
+  if(!cached)
+  {
+    encodeDatamatrix(dmtxInfos.type, qstr, modules);
 
-  //see DmtxSymbolSize in dmtx.h for more details
-  enc->sizeIdxRequest = dmtxInfos.type;
-  enc->marginSize = 0;
-  //number of pixel for one square
-  enc->moduleSize = 1;
+    QMutexLocker locker(dmtxModulesLock());
+    dmtxModulesCache()->insert(key, new DmtxModules(modules));
+  }
 
   QPen pen(Qt::NoPen);
   QBrush brush(QColor("black"));
@@ -151,82 +250,47 @@ void renderCodeDatamatrix(QPainter *painter, const QRectF &qrect, const QString
   painter->setPen(pen);
   painter->setBrush(brush);
 
-  try
+  if(modules.width == 0)
+  {
+    //there is a problem with the datamatrix
+    //RR is printed
+    printRR(painter, qrect);
+  }
+  else
   {
-    //assert(enc != NULL);
-    dmtxEncodeDataMatrix(enc, qstr.size(), (unsigned char*)qstr.toStdString().c_str());
-
-    /* 2) COPY the new image data before releasing encoding memory */
-
-    width = dmtxImageGetProp(enc->image, DmtxPropWidth);
-    height = dmtxImageGetProp(enc->image, DmtxPropHeight);
-    bytesPerPixel = dmtxImageGetProp(enc->image, DmtxPropBytesPerPixel);
-
-    if(width > 1000000000)
-    {
-			throw std::runtime_error("Code is to big for the Datamatrix");
-    }
-
-    pxl = (unsigned char *)malloc(width * height * bytesPerPixel);
-    //assert(pxl != NULL);
-    memcpy(pxl, enc->image->pxl, width * height * bytesPerPixel);
-
-    dmtxEncodeDestroy(&enc);
-
-    /* 3) DECODE the Data Matrix barcode from the copied image */
-    img = dmtxImageCreate(pxl, width, height, DmtxPack24bppRGB);
-
     qreal Xo = 0;
     qreal Yo = 0;
     //length of square
     qreal pas = 0;
 
-    datamatrixGeometry(dmtxInfos.align,qrect,img,&Xo,&Yo,&pas);
+    datamatrixGeometry(dmtxInfos.align,qrect,modules.width,modules.height,&Xo,&Yo,&pas);
 
-    //draw the datamatrix
-    for(int y = 0; y < img->height; y++)
+    //draw the datamatrix, each horizontal run of dark squares as one rectangle
+    QPainterPath squares;
+    squares.setFillRule(Qt::WindingFill);
+    for(int y = 0; y < modules.height; y++)
     {
-      for(int x = 0; x < img->width; x++)
+      int x = 0;
+      while(x < modules.width)
       {
-        dmtxImageGetPixelValue(img,x,y,0,&valeur);
-
-        if(valeur == 0)
+        if(!modules.isDark(x, y))
         {
-          painter->drawRect(QRectF(	Xo + x*pas,
-                                Yo - y*pas,
-                                pas,
-                                pas));
+          x++;
+          continue;
         }
-      }
-    }
 
-    //memory cleanning
-    free(pxl);
-    dmtxEncodeDestroy(&enc);
-    dmtxImageDestroy(&img);
-  }
-  catch(...)
-  {
-    //there is a problem with the datamatrix
-    //RR is printed
-    printRR(painter, qrect);
+        int start = x;
+        while(x < modules.width && modules.isDark(x, y))
+          x++;
 
-    //memory cleaning
-    if(enc != NULL)
-    {
-      dmtxEncodeDestroy(&enc);
-    }
-    if(img != NULL)
-    {
-      dmtxImageDestroy(&img);
-    }
-    if(pxl!=NULL)
-    {
-      free(pxl);
+        squares.addRect(QRectF(	Xo + start*pas,
+                              Yo - y*pas,
+                              (x - start)*pas,
+                              pas));
+      }
     }
+    painter->drawPath(squares);
   }
 
   painter->restore();
 }
-
-
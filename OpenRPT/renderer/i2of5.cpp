@@ -31,6 +31,7 @@
 
 #include "parsexmlutils.h"
 #include "renderobjects.h"
+#include "barcodes.h"
 
 const char* _i2of5charmap[] = {
   "NNWWN",
@@ -46,116 +47,56 @@ const char* _i2of5charmap[] = {
 };
 
 
-static QPointF addElement(QPainter *painter, const QRectF &r, QPointF startPos, qreal width, bool isSpace)
-{
-  if(!isSpace)
-  {
-    painter->drawRect(QRectF(startPos.x(),startPos.y(), width, r.height()));
-  }
-  return QPointF(startPos.x() + width, startPos.y());
-}
-
-static QPointF addBar(QPainter *painter, const QRectF &r, QPointF startPos, qreal width)
-{
-  return addElement(painter, r, startPos, width, false);
-}
-static QPointF addSpace(QPainter *painter, const QRectF &r, QPointF startPos, qreal width)
-{
-  return addElement(painter, r, startPos, width, true);
-}
-
-
 void renderI2of5(QPainter *painter, int dpi, const QRectF &r, const QString & _str, OROBarcode * bc)
 {
-  QString str = _str;
-  qreal narrow_bar = bc->narrowBarWidth() * dpi;
-  qreal bar_width_mult = 2.5; // the wide bar width multiple of the narrow bar
-  qreal wide_bar = narrow_bar * bar_width_mult;
-
-  if(str.length() % 2)
+  ORBarcodeRuns runs;
+  if(!cachedBarcodeRuns("i2of5", _str, runs))
   {
-    str = "0" + str; // padding zero if number of characters is not even
-  }
-
-  // this is our mandatory minimum quiet zone
-  qreal quiet_zone = narrow_bar * 10;
-  if(quiet_zone < 0.1*dpi)
-    quiet_zone = 0.1*dpi;
+    QString str = _str;
+    qreal bar_width_mult = 2.5; // the wide bar width multiple of the narrow bar
 
-  // what kind of area do we have to work with
-  qreal draw_width = r.width();
-
-  // how long is the value we need to encode?
-  int val_length = str.length();
-
-  // L = (C(2N+3)+6+N)X
-  // L length of barcode (excluding quite zone
-  // C the number of characters in the value excluding the start/stop
-  // N the bar width multiple for wide bars
-  // X the width of a bar (pixels in our case)
-  qreal L;
-  qreal C = val_length;
-  qreal N = bar_width_mult;
-  qreal X = narrow_bar;
-
-  L = (C * (2.0*N + 3.0) + 6.0 + N) * X;
-
-  // now we have the actual width the barcode will be so can determine the actual
-  // size of the quiet zone (we assume we center the barcode in the given area)
-  // At the moment the way the code is written is we will always start at the minimum
-  // required quiet zone if we don't have enough space.... I guess we'll just have over-run
-  // to the right
-  //
-  // calculate the starting position based on the alignment option
-  if(bc->align() == 1) // center
-  {
-    qreal nqz = (draw_width - L) / 2.0;
-    if(nqz > quiet_zone)
-      quiet_zone = nqz;
-  }
-  else if(bc->align() > 1) // right
-    quiet_zone = draw_width - (L + quiet_zone);
-  //else if(align < 1) {} // left : do nothing
+    if(str.length() % 2)
+    {
+      str = "0" + str; // padding zero if number of characters is not even
+    }
 
-  QPointF pos(r.left() + quiet_zone, r.top());
+    // how long is the value we need to encode?
+    int val_length = str.length();
 
-  QPen pen(Qt::NoPen);
-  QBrush brush(QColor("black"));
-  painter->save();
-  painter->setPen(pen);
-  painter->setBrush(brush);
+    // L = (C(2N+3)+6+N)X
+    // L length of barcode (excluding quite zone
+    // C the number of characters in the value excluding the start/stop
+    // N the bar width multiple for wide bars
+    // X the width of a bar (one unit here)
+    qreal C = val_length;
+    qreal N = bar_width_mult;
+    runs.length = C * (2.0*N + 3.0) + 6.0 + N;
 
-  // start character
-  pos = addBar(painter, r, pos, narrow_bar);
-  pos = addSpace(painter, r, pos, narrow_bar);
-  pos = addBar(painter, r, pos, narrow_bar);
-  pos = addSpace(painter, r, pos, narrow_bar);
+    // start character
+    runs.elements << 1 << -1 << 1 << -1;
 
-  for(int i = 0; i < str.length()-1; i+=2)
-  {
-    for(int iElt = 0; _i2of5charmap [0][iElt] != '\0'; iElt++)
+    for(int i = 0; i < str.length()-1; i+=2)
     {
-      for(int offset=0; offset<=1; offset++)
+      for(int iElt = 0; _i2of5charmap [0][iElt] != '\0'; iElt++)
       {
-        QChar c = str.at(i+offset);
-        if(!c.isDigit()) {
-          break; // invalid character
+        for(int offset=0; offset<=1; offset++)
+        {
+          QChar c = str.at(i+offset);
+          if(!c.isDigit()) {
+            break; // invalid character
+          }
+          int iChar = c.digitValue();
+          qreal width = _i2of5charmap[iChar][iElt] == 'W' ? bar_width_mult : 1;
+          runs.elements.append(offset==1 ? -width : width);
         }
-        int iChar = c.digitValue();
-        qreal width = _i2of5charmap[iChar][iElt] == 'W' ? wide_bar : narrow_bar;
-        pos = addElement(painter, r, pos, width, offset==1);
       }
     }
-  }
 
-  // stop character
-  pos = addBar(painter, r, pos, wide_bar);
-  pos = addSpace(painter, r, pos, narrow_bar);
-  pos = addBar(painter, r, pos, narrow_bar);
+    // stop character
+    runs.elements << bar_width_mult << -1 << 1;
 
-  painter->restore();
+    cacheBarcodeRuns("i2of5", _str, runs);
+  }
 
-  return;
+  drawBarcodeRuns(painter, dpi, r, runs, bc);
 }
-
-
@@ -30,7 +30,24 @@
 
 
 
-LabelPaintEngine::LabelPaintEngine(ReportPrinter *parentPrinter, QString cmdPrefix) : QPaintEngine(QPaintEngine::AllFeatures), m_parentPrinter(parentPrinter), m_printToBuffer(false), m_CmdPrefix(cmdPrefix)
+// splits a label body into its fields, one command line each
+static QList<QByteArray> splitFields(const QByteArray &body)
+{
+  QList<QByteArray> fields;
+  int start = 0;
+  while(start < body.size()) {
+    int nl = body.indexOf('\n', start);
+    int end = (nl < 0) ? body.size() : nl + 1;
+    fields.append(body.mid(start, end - start));
+    start = end;
+  }
+  return fields;
+}
+
+
+LabelPaintEngine::LabelPaintEngine(ReportPrinter *parentPrinter, QString cmdPrefix) : QPaintEngine(QPaintEngine::AllFeatures), m_parentPrinter(parentPrinter), m_printToBuffer(false), m_CmdPrefix(cmdPrefix),
+  m_labelStart(0), m_bodyStart(0), m_footerStart(0), m_formatState(FormatOff), m_hasPendingLabel(false),
+  m_output(0), m_outputFailed(false), m_bytesWritten(0)
 {
   m_Rotation90.rotate(90);
   m_Rotation180.rotate(180);
@@ -43,6 +60,177 @@ LabelPaintEngine::LabelPaintEngine(ReportPrinter *parentPrinter, QString cmdPref
 
   m_CustomInitString = m_parentPrinter->getParam("init");
   m_OutputFile =  m_parentPrinter->getParam("tofile");
+
+  // formats stored or recalled by hand take precedence
+  if(ReportPrinter::getStoreMask(m_parentPrinter->getParams()).isEmpty() &&
+     ReportPrinter::getRecallMask(m_parentPrinter->getParams()).isEmpty()) {
+    m_AutoFormat = m_parentPrinter->getParam("autoformat");
+  }
+  resetFormat();
+}
+
+
+LabelPaintEngine::~LabelPaintEngine()
+{
+  delete m_output;
+}
+
+
+void LabelPaintEngine::resetFormat()
+{
+  m_formatState = m_AutoFormat.isEmpty() ? FormatOff : FormatPending;
+  m_hasPendingLabel = false;
+  m_pendingHeader.clear();
+  m_pendingFields.clear();
+  m_pendingFooter.clear();
+  m_staticFields.clear();
+}
+
+
+void LabelPaintEngine::startLabel(const QByteArray &header)
+{
+  m_labelStart = m_printBuffer.size();
+  m_printBuffer.append(header);
+  m_bodyStart = m_printBuffer.size();
+}
+
+
+void LabelPaintEngine::finishLabel()
+{
+  m_footerStart = m_printBuffer.size();
+  addEndMessage();
+
+  if(m_formatState != FormatOff) {
+    compileLabel();
+  }
+
+  flushOutput(false);
+}
+
+
+void LabelPaintEngine::insertBeforeLabel(const QByteArray &cmds)
+{
+  m_printBuffer.insert(m_labelStart, cmds);
+  m_labelStart += cmds.size();
+  m_bodyStart += cmds.size();
+}
+
+
+QByteArray LabelPaintEngine::storeFormatCmds(const QByteArray &header, const QByteArray &fields) const
+{
+  Q_UNUSED(header);
+  Q_UNUSED(fields);
+  return QByteArray();
+}
+
+
+QByteArray LabelPaintEngine::recallFormatCmds() const
+{
+  return QByteArray();
+}
+
+
+bool LabelPaintEngine::isStorableField(const QByteArray &field) const
+{
+  Q_UNUSED(field);
+  return true;
+}
+
+
+// Takes the label just finished back out of the buffer and writes it again,
+// recalling the stored format when possible.
+void LabelPaintEngine::compileLabel()
+{
+  QByteArray header = m_printBuffer.mid(m_labelStart, m_bodyStart - m_labelStart);
+  QList<QByteArray> fields = splitFields(m_printBuffer.mid(m_bodyStart, m_footerStart - m_bodyStart));
+  QByteArray footer = m_printBuffer.mid(m_footerStart);
+  m_printBuffer.truncate(m_labelStart);
+
+  if(m_formatState == FormatStored) {
+    writeLabel(header, fields, footer);
+    return;
+  }
+
+  if(!m_hasPendingLabel) {
+    m_hasPendingLabel = true;
+    m_pendingHeader = header;
+    m_pendingFields = fields;
+    m_pendingFooter = footer;
+    return;
+  }
+
+  // the static layer is made of the fields both labels have
+  QHash<QByteArray, int> current;
+  foreach(const QByteArray &field, fields) {
+    current[field]++;
+  }
+  QByteArray staticFields;
+  foreach(const QByteArray &field, m_pendingFields) {
+    if(current.value(field) > 0 && isStorableField(field)) {
+      current[field]--;
+      m_staticFields[field]++;
+      staticFields += field;
+    }
+  }
+
+  QByteArray store;
+  if(!staticFields.isEmpty()) {
+    store = storeFormatCmds(m_pendingHeader, staticFields);
+  }
+  if(store.isEmpty()) {
+    m_formatState = FormatOff;
+    m_staticFields.clear();
+  }
+  else {
+    m_formatState = FormatStored;
+    m_printBuffer.append(store);
+  }
+
+  writeLabel(m_pendingHeader, m_pendingFields, m_pendingFooter);
+  writeLabel(header, fields, footer);
+
+  m_hasPendingLabel = false;
+  m_pendingHeader.clear();
+  m_pendingFields.clear();
+  m_pendingFooter.clear();
+}
+
+
+void LabelPaintEngine::writeLabel(const QByteArray &header, const QList<QByteArray> &fields, const QByteArray &footer)
+{
+  QByteArray variableFields;
+  bool recall = false;
+
+  if(m_formatState == FormatStored) {
+    QHash<QByteArray, int> remaining = m_staticFields;
+    int missing = 0;
+    foreach(int count, remaining) {
+      missing += count;
+    }
+    foreach(const QByteArray &field, fields) {
+      if(remaining.value(field) > 0) {
+        remaining[field]--;
+        missing--;
+      }
+      else {
+        variableFields += field;
+      }
+    }
+    // a label lacking one of the stored fields is sent in full
+    recall = (missing == 0);
+  }
+
+  m_printBuffer.append(header);
+  if(recall) {
+    m_printBuffer.append(recallFormatCmds());
+    m_printBuffer.append(variableFields);
+  }
+  else {
+    foreach(const QByteArray &field, fields) {
+      m_printBuffer.append(field);
+    }
+  }
+  m_printBuffer.append(footer);
 }
 
 QString LabelPaintEngine::transformRotationCmd()
@@ -102,17 +290,40 @@ void 	LabelPaintEngine::updateState ( const QPaintEngineState & state )
 
 bool	LabelPaintEngine::newPage ()
 {
-    return true;
+  // the positions of the next page start from the top of a label again
+  finishLabel();
+  return begin(paintDevice());
 }
 
 
 bool 	LabelPaintEngine::end ()
 {
-  addEndMessage();
+  finishLabel();
+
+  // a job of a single label has nothing to share
+  if(m_hasPendingLabel) {
+    m_formatState = FormatOff;
+    writeLabel(m_pendingHeader, m_pendingFields, m_pendingFooter);
+  }
+  resetFormat();
 
   if (m_printToBuffer)
     return true;
 
+  flushOutput(true);
+
+  bool ok = (m_output != 0 && !m_outputFailed);
+  delete m_output;
+  m_output = 0;
+  m_outputFailed = false;
+  m_bytesWritten = 0;
+
+  return ok;
+}
+
+
+QString LabelPaintEngine::outputName() const
+{
   QString outPutName;
 
   if(!m_OutputFile.isEmpty()) {
@@ -127,20 +338,43 @@ bool 	LabelPaintEngine::end ()
 #endif
   }
 
-  QFile f(outPutName);
-  bool ok = f.open(QIODevice::WriteOnly);
-  if(!ok) {
-    qWarning() << "Invalid printer name:" << f.fileName();
-    return false;
+  return outPutName;
+}
+
+
+// Sends the finished labels to the printer. Called at label boundaries only,
+// the first label goes out at once so the printer can start, the next ones
+// once a chunk is ready. Writing blocks while the printer or spooler is busy,
+// so encoding never runs far ahead of printing.
+void LabelPaintEngine::flushOutput(bool force)
+{
+  const int chunkSize = 64 * 1024;
+
+  if(m_printToBuffer || m_printBuffer.isEmpty()) {
+    return;
+  }
+  if(!force && m_bytesWritten > 0 && m_printBuffer.size() < chunkSize) {
+    return;
   }
 
-  qint64 bytesWritten = f.write(m_printBuffer);
-  if(bytesWritten==0) {
-    qWarning() << "Failed to print to:" << f.fileName();
-    return false;
+  if(m_output == 0) {
+    m_output = new QFile(outputName());
+    if(!m_output->open(QIODevice::WriteOnly)) {
+      qWarning() << "Invalid printer name:" << m_output->fileName();
+      m_outputFailed = true;
+    }
   }
 
-  return true;
+  if(!m_outputFailed) {
+    qint64 bytesWritten = m_output->write(m_printBuffer);
+    if(bytesWritten != m_printBuffer.size() || !m_output->flush()) {
+      qWarning() << "Failed to print to:" << m_output->fileName();
+      m_outputFailed = true;
+    }
+    m_bytesWritten += qMax(bytesWritten, (qint64)0);
+  }
+
+  m_printBuffer.clear();
 }
 
 
@@ -22,12 +22,16 @@
 #define LABELPAINTENGINE_H
 
 #include <QPaintEngine>
+#include <QFile>
+#include <QHash>
+#include <QList>
 #include "reportprinter.h"
 
 class LabelPaintEngine : public QPaintEngine
 {
 public:
   LabelPaintEngine(ReportPrinter *parentPrinter, QString cmdPrefix);
+  virtual ~LabelPaintEngine();
 
   virtual bool 	begin ( QPaintDevice * pdev ) = 0;
 
@@ -53,6 +57,7 @@ public:
 
   virtual bool newPage();
 
+  // keep the whole job in memory instead of streaming it to the printer
   void			setPrintToBuffer() {m_printToBuffer = true;}
   QByteArray	getBuffer() const {return m_printBuffer;}
 
@@ -69,6 +74,20 @@ protected:
   int     resolution() const { return (qreal)m_parentPrinter->resolution(); }  // resolution in points per inches
   int     density() const { return qRound (resolution() / 25.4); }  // density in points per mm
   QString customInitString() const { return m_CustomInitString; }
+  QString autoFormat() const { return m_AutoFormat; }
+
+  // Every page is a label: begin() writes the label header with startLabel()
+  // and finishLabel() closes it with addEndMessage().
+  // With the "autoformat" printer param, the fields shared by the first two
+  // labels of a job are sent once as a stored format, and every label that
+  // still has all of them recalls that format and only sends its own fields.
+  void    startLabel(const QByteArray &header);
+  void    finishLabel();
+  virtual QByteArray storeFormatCmds(const QByteArray &header, const QByteArray &fields) const; // empty: not supported
+  virtual QByteArray recallFormatCmds() const;
+  virtual bool isStorableField(const QByteArray &field) const;
+  // sends cmds ahead of the current label, e.g. to download a graphic it recalls
+  void    insertBeforeLabel(const QByteArray &cmds);
 
   ReportPrinter *m_parentPrinter;
   QByteArray m_printBuffer;
@@ -82,6 +101,29 @@ private:
   QTransform m_Rotation180;
   QTransform m_Rotation270;
   QString   m_OutputFile;
+  QString   m_AutoFormat;
+
+  enum FormatState { FormatOff, FormatPending, FormatStored };
+
+  void      compileLabel();
+  void      writeLabel(const QByteArray &header, const QList<QByteArray> &fields, const QByteArray &footer);
+  void      resetFormat();
+  QString   outputName() const;
+  void      flushOutput(bool force);
+
+  int       m_labelStart;   // offsets in m_printBuffer of the current label
+  int       m_bodyStart;
+  int       m_footerStart;
+  FormatState m_formatState;
+  bool      m_hasPendingLabel; // first label, held until the second one shows the static fields
+  QByteArray m_pendingHeader;
+  QList<QByteArray> m_pendingFields;
+  QByteArray m_pendingFooter;
+  QHash<QByteArray, int> m_staticFields; // field -> occurrences in the stored format
+
+  QFile    *m_output;       // printer or spool file, opened with the first label
+  bool      m_outputFailed;
+  qint64    m_bytesWritten;
 };
 
 #endif // LABELPAINTENGINE_H
@@ -20,6 +20,7 @@
 #include "openreports.h"
 
 #include "orprerender.h"
+#include "orreportcache.h"
 #include "orprintrender.h"
 #include "renderobjects.h"
 #include "builtinSqlFunctions.h"
@@ -130,22 +131,11 @@ orReport::orReport(const char *pReportName, const ParameterList &pParams, QSqlDa
 void orReport::constructor(const QString &pReportName)
 {
   _internal->_reportName = pReportName;
-  XSqlQuery report(_internal->_prerenderer.database());
-  report.prepare(getSqlFromTag("fmt04", _internal->_prerenderer.database().driverName()));	// MANU
-  report.bindValue(":report_name", pReportName);
-  report.exec();
-  if (report.first())
-  {
-    _internal->_reportExists = true;
-    QString errorMessage;
-    int     errorLine;
 
-    QDomDocument docReport;
-    if (docReport.setContent(report.value("report_source").toString(), &errorMessage, &errorLine))
-      setDom(docReport);
-  }
-  else
-    _internal->_reportExists = false;
+  // parsed once per process and shared, see ORReportCache
+  ORReportDefinitionPtr definition = ORReportCache::definition(pReportName, _internal->_prerenderer.database(), &_internal->_reportExists);
+  if (definition)
+    _internal->_prerenderer.setDefinition(definition);
 }
 
 orReport::~orReport()
@@ -241,6 +231,7 @@ bool orReport::print(QPrinter *prtThis, bool boolSetupPrinter, bool showPreview,
 
       if(_internal->_prerenderer.isValid())
       {
+        _internal->_prerenderer.setSpatialIndex(showPreview); // the preview paints pages by tiles
         _internal->_genDoc = _internal->_prerenderer.generate();
         if(_internal->_genDoc)
         {
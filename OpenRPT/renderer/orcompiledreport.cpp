@@ -0,0 +1,895 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     The layout of a compiled report, the numbers of the header, the
+ * image table and the definition big endian:
+ *
+ *   header       magic, version, image count, offset and size of the
+ *                definition, offset and size of the source and the
+ *                QSysInfo::Endian of the images, 8 x quint32
+ *   image table  offset, width, height, bytes per line and QImage::Format
+ *                of each image, 5 x quint32 each
+ *   definition   the ORReportData, written with QDataStream::Qt_5_0
+ *   source       the XML source, UTF-8
+ *   images       the pixels of each image, each starting on 16 bytes
+ *
+ * The pixels are copied from QImage::constBits() and mapped back as they
+ * are, so 32 bit pixels are in the byte order of the machine that compiled
+ * the report. load() refuses a file of the other byte order.
+ */
+
+#include "orcompiledreport.h"
+
+#include <QAtomicInt>
+#include <QBrush>
+#include <QDataStream>
+#include <QFile>
+#include <QFont>
+#include <QHash>
+#include <QImage>
+#include <QObject>
+#include <QPair>
+#include <QPen>
+#include <QSaveFile>
+#include <QSysInfo>
+
+#include <parsexmlutils.h>
+
+static const quint32 compiledMagic = 0x4F52431A; // "ORC" ^Z
+static const int headerSize = 8 * 4;
+static const int imageEntrySize = 5 * 4;
+static const int imageAlign = 16;
+
+enum ObjectType {
+  ObjectLine = 1,
+  ObjectRect,
+  ObjectLabel,
+  ObjectField,
+  ObjectText,
+  ObjectBarcode,
+  ObjectImage,
+  ObjectGraph,
+  ObjectCrossTab
+};
+
+// the images of the definition by their index in the image table
+class ORCompiledImages
+{
+  public:
+    ORCompiledImages() : background(-1) {}
+
+    int background;
+    QList<QImage> images;
+    QHash<const ORImageData*, int> index;      // writing
+    QList<QPair<ORImageData*, int> > objects;  // reading
+};
+
+//
+// writing
+//
+static void writeData(QDataStream & out, const ORDataData & d)
+{
+  out << d.query << d.column;
+}
+
+static void writeDataList(QDataStream & out, const QList<ORDataData> & list)
+{
+  out << (qint32)list.count();
+  for(int i = 0; i < list.count(); i++)
+    writeData(out, list.at(i));
+}
+
+static void writeTitle(QDataStream & out, const ORTitleData & t)
+{
+  out << t.string << t.font << t.font_defined;
+}
+
+static void writeCrossTabQuery(QDataStream & out, const ORCrossTabQueryData & q)
+{
+  out << q.m_query << q.m_hAlign << q.m_vAlign;
+}
+
+static void writeObject(QDataStream & out, ORObject * o, ORCompiledImages & images)
+{
+  if(o->isLine())
+  {
+    ORLineData * l = o->toLine();
+    out << (qint32)ObjectLine
+        << (qint32)l->xStart << (qint32)l->yStart << (qint32)l->xEnd << (qint32)l->yEnd;
+  }
+  else if(o->isRect())
+  {
+    ORRectData * r = o->toRect();
+    out << (qint32)ObjectRect
+        << (qint32)r->x << (qint32)r->y << (qint32)r->width << (qint32)r->height;
+  }
+  else if(o->isLabel())
+  {
+    ORLabelData * l = o->toLabel();
+    out << (qint32)ObjectLabel << l->rect << l->font << (qint32)l->align << l->string;
+  }
+  else if(o->isField())
+  {
+    ORFieldData * f = o->toField();
+    out << (qint32)ObjectField << f->rect << f->font << (qint32)f->align;
+    writeData(out, f->data);
+    out << f->trackTotal << f->sub_total << f->builtinFormat << f->format
+        << (qint32)f->lines << (qint32)f->columns
+        << (double)f->xSpacing << (double)f->ySpacing
+        << f->triggerPageBreak << f->leftToRight;
+  }
+  else if(o->isText())
+  {
+    ORTextData * t = o->toText();
+    out << (qint32)ObjectText << t->rect << t->font << (qint32)t->align;
+    writeData(out, t->data);
+    out << (qint32)t->bottompad;
+  }
+  else if(o->isBarcode())
+  {
+    ORBarcodeData * b = o->toBarcode();
+    out << (qint32)ObjectBarcode << b->rect << b->format << (qint32)b->maxlength;
+    writeData(out, b->data);
+    out << (qint32)b->align << b->narrowBarWidth;
+  }
+  else if(o->isImage())
+  {
+    ORImageData * im = o->toImage();
+    // a decoded inline image leaves only an empty, not null, inline_data
+    qint32 image = images.index.value(im, -1);
+    out << (qint32)ObjectImage << im->rect << im->mode << im->format
+        << (image >= 0 ? QString("") : im->inline_data) << image;
+    writeData(out, im->data);
+  }
+  else if(o->isGraph())
+  {
+    ORGraphData * g = o->toGraph();
+    out << (qint32)ObjectGraph;
+    writeData(out, g->data);
+    out << g->font << g->rect;
+    writeTitle(out, g->title);
+    writeTitle(out, g->dataaxis.title);
+    out << g->dataaxis.column << g->dataaxis.font << g->dataaxis.font_defined;
+    writeTitle(out, g->valueaxis.title);
+    out << g->valueaxis.min << g->valueaxis.max << g->valueaxis.autominmax
+        << g->valueaxis.font << g->valueaxis.font_defined;
+    out << (qint32)g->series.count();
+    for(int i = 0; i < g->series.count(); i++)
+    {
+      ORSeriesData * s = g->series.at(i);
+      out << s->name << s->color << s->column
+          << s->style.bar << s->style.line << s->style.point;
+    }
+  }
+  else if(o->isCrossTab())
+  {
+    ORCrossTabData * c = o->toCrossTab();
+    out << (qint32)ObjectCrossTab;
+    writeData(out, c->data);
+    out << c->font << c->rect;
+    const ORCrossTabTablePropertiesData & t = c->m_tableProperties;
+    out << t.m_wrapPolicyColumnsFirst << t.m_showColumnHeaderOnEachPart
+        << t.m_showRowHeaderOnEachPart << t.m_cellLeftMargin << t.m_cellRightMargin
+        << t.m_cellTopMargin << t.m_cellBottomMargin;
+    writeCrossTabQuery(out, c->m_column);
+    writeCrossTabQuery(out, c->m_row);
+    writeCrossTabQuery(out, c->m_value);
+  }
+  else
+    return;
+
+  out << o->pen() << o->brush() << (double)o->rotation() << o->border();
+}
+
+static void writeSection(QDataStream & out, ORSectionData * sd, ORCompiledImages & images)
+{
+  out << (sd != 0);
+  if(sd == 0)
+    return;
+
+  out << sd->name << sd->extra << (double)sd->height;
+
+  out << (qint32)sd->objects.count();
+  for(int i = 0; i < sd->objects.count(); i++)
+    writeObject(out, sd->objects.at(i), images);
+
+  writeDataList(out, sd->trackTotal);
+}
+
+static void writeReport(QDataStream & out, ORReportData & data, ORCompiledImages & images)
+{
+  out << data.title << data.name << data.description;
+
+  out << (qint32)data.definedParams.count();
+  for(QMap<QString,ORParameter>::const_iterator it = data.definedParams.constBegin();
+      it != data.definedParams.constEnd(); ++it)
+  {
+    const ORParameter & p = it.value();
+    out << p.name << p.type << p.defaultValue << p.description << p.listtype
+        << p.query << p.values << p.active;
+  }
+
+  const ORWatermarkData & wm = data.wmData;
+  out << (qint32)wm.opacity << wm.useDefaultFont << wm.font << wm.staticText << wm.text;
+  writeData(out, wm.data);
+  out << wm.valid;
+
+  const ORBackgroundData & bg = data.bgData;
+  out << bg.enabled << bg.staticImage << (images.background >= 0 ? QString() : bg.image);
+  writeData(out, bg.data);
+  out << (qint32)bg.opacity << bg.mode << (qint32)bg.align << bg.rect;
+
+  const ReportPageOptions & page = data.page;
+  out << page.getMarginTop() << page.getMarginBottom()
+      << page.getMarginLeft() << page.getMarginRight()
+      << page.getPageSize() << page.getCustomWidth() << page.getCustomHeight()
+      << page.isPortrait() << page.getLabelType();
+
+  out << (qint32)data.queries.size();
+  for(unsigned int i = 0; i < data.queries.size(); i++)
+  {
+    QuerySource * qs = data.queries.get(i);
+    out << qs->name() << qs->query() << qs->loadFromDb()
+        << qs->metaSqlGroup() << qs->metaSqlName();
+  }
+
+  writeSection(out, data.pghead_first, images);
+  writeSection(out, data.pghead_odd, images);
+  writeSection(out, data.pghead_even, images);
+  writeSection(out, data.pghead_last, images);
+  writeSection(out, data.pghead_any, images);
+  writeSection(out, data.rpthead, images);
+  writeSection(out, data.rptfoot, images);
+  writeSection(out, data.pgfoot_first, images);
+  writeSection(out, data.pgfoot_odd, images);
+  writeSection(out, data.pgfoot_even, images);
+  writeSection(out, data.pgfoot_last, images);
+  writeSection(out, data.pgfoot_any, images);
+
+  out << (qint32)data.sections.count();
+  for(int i = 0; i < data.sections.count(); i++)
+  {
+    ORDetailSectionData * dsd = data.sections.at(i);
+    out << dsd->name << (qint32)dsd->pagebreak << dsd->key.query << dsd->key.column;
+    writeSection(out, dsd->detail, images);
+
+    out << (qint32)dsd->groupList.count();
+    for(int g = 0; g < dsd->groupList.count(); g++)
+    {
+      ORDetailGroupSectionData * grp = dsd->groupList.at(g);
+      out << grp->name << grp->column << (qint32)grp->pagebreak;
+      writeDataList(out, grp->_subtotCheckPoints.keys());
+      writeSection(out, grp->head, images);
+      writeSection(out, grp->foot, images);
+    }
+    writeDataList(out, dsd->trackTotal);
+  }
+
+  out << data.color_map;
+  writeDataList(out, data.trackTotal);
+}
+
+//
+// reading
+//
+static ORDataData readData(QDataStream & in)
+{
+  ORDataData d;
+  in >> d.query >> d.column;
+  return d;
+}
+
+static QList<ORDataData> readDataList(QDataStream & in)
+{
+  QList<ORDataData> list;
+  qint32 count = 0;
+  in >> count;
+  for(int i = 0; i < count && in.status() == QDataStream::Ok; i++)
+    list.append(readData(in));
+  return list;
+}
+
+static void readTitle(QDataStream & in, ORTitleData & t)
+{
+  in >> t.string >> t.font >> t.font_defined;
+}
+
+static void readCrossTabQuery(QDataStream & in, ORCrossTabQueryData & q)
+{
+  in >> q.m_query >> q.m_hAlign >> q.m_vAlign;
+}
+
+static ORObject * readObject(QDataStream & in, ORCompiledImages & images)
+{
+  qint32 type = 0;
+  qint32 i1, i2, i3, i4;
+  double d1, d2;
+  ORObject * o = 0;
+
+  in >> type;
+  switch(type)
+  {
+    case ObjectLine:
+    {
+      ORLineData * l = new ORLineData();
+      in >> i1 >> i2 >> i3 >> i4;
+      l->xStart = i1; l->yStart = i2; l->xEnd = i3; l->yEnd = i4;
+      o = l;
+      break;
+    }
+    case ObjectRect:
+    {
+      ORRectData * r = new ORRectData();
+      in >> i1 >> i2 >> i3 >> i4;
+      r->x = i1; r->y = i2; r->width = i3; r->height = i4;
+      o = r;
+      break;
+    }
+    case ObjectLabel:
+    {
+      ORLabelData * l = new ORLabelData();
+      in >> l->rect >> l->font >> i1 >> l->string;
+      l->align = i1;
+      o = l;
+      break;
+    }
+    case ObjectField:
+    {
+      ORFieldData * f = new ORFieldData();
+      in >> f->rect >> f->font >> i1;
+      f->align = i1;
+      f->data = readData(in);
+      in >> f->trackTotal >> f->sub_total >> f->builtinFormat >> f->format
+         >> i2 >> i3 >> d1 >> d2 >> f->triggerPageBreak >> f->leftToRight;
+      f->lines = i2;
+      f->columns = i3;
+      f->xSpacing = d1;
+      f->ySpacing = d2;
+      o = f;
+      break;
+    }
+    case ObjectText:
+    {
+      ORTextData * t = new ORTextData();
+      in >> t->rect >> t->font >> i1;
+      t->align = i1;
+      t->data = readData(in);
+      in >> i2;
+      t->bottompad = i2;
+      o = t;
+      break;
+    }
+    case ObjectBarcode:
+    {
+      ORBarcodeData * b = new ORBarcodeData();
+      in >> b->rect >> b->format >> i1;
+      b->maxlength = i1;
+      b->data = readData(in);
+      in >> i2 >> b->narrowBarWidth;
+      b->align = i2;
+      o = b;
+      break;
+    }
+    case ObjectImage:
+    {
+      ORImageData * im = new ORImageData();
+      in >> im->rect >> im->mode >> im->format >> im->inline_data >> i1;
+      im->data = readData(in);
+      if(i1 >= 0)
+        images.objects.append(qMakePair(im, (int)i1));
+      o = im;
+      break;
+    }
+    case ObjectGraph:
+    {
+      ORGraphData * g = new ORGraphData();
+      g->data = readData(in);
+      in >> g->font >> g->rect;
+      readTitle(in, g->title);
+      readTitle(in, g->dataaxis.title);
+      in >> g->dataaxis.column >> g->dataaxis.font >> g->dataaxis.font_defined;
+      readTitle(in, g->valueaxis.title);
+      in >> g->valueaxis.min >> g->valueaxis.max >> g->valueaxis.autominmax
+         >> g->valueaxis.font >> g->valueaxis.font_defined;
+      in >> i1;
+      for(int i = 0; i < i1 && in.status() == QDataStream::Ok; i++)
+      {
+        ORSeriesData * s = new ORSeriesData();
+        in >> s->name >> s->color >> s->column
+           >> s->style.bar >> s->style.line >> s->style.point;
+        g->series.append(s);
+      }
+      o = g;
+      break;
+    }
+    case ObjectCrossTab:
+    {
+      ORCrossTabData * c = new ORCrossTabData();
+      c->data = readData(in);
+      in >> c->font >> c->rect;
+      ORCrossTabTablePropertiesData & t = c->m_tableProperties;
+      in >> t.m_wrapPolicyColumnsFirst >> t.m_showColumnHeaderOnEachPart
+         >> t.m_showRowHeaderOnEachPart >> t.m_cellLeftMargin >> t.m_cellRightMargin
+         >> t.m_cellTopMargin >> t.m_cellBottomMargin;
+      readCrossTabQuery(in, c->m_column);
+      readCrossTabQuery(in, c->m_row);
+      readCrossTabQuery(in, c->m_value);
+      o = c;
+      break;
+    }
+    default:
+      in.setStatus(QDataStream::ReadCorruptData);
+      return 0;
+  }
+
+  QPen pen;
+  QBrush brush;
+  QPen border;
+  double rotation = 0.0;
+  in >> pen >> brush >> rotation >> border;
+  o->setPen(pen);
+  o->setBrush(brush);
+  o->setRotation(rotation);
+  o->setBorder(border);
+  return o;
+}
+
+static ORSectionData * readSection(QDataStream & in, ORCompiledImages & images)
+{
+  bool present = false;
+  in >> present;
+  if(!present || in.status() != QDataStream::Ok)
+    return 0;
+
+  ORSectionData * sd = new ORSectionData();
+  double height = 0.0;
+  in >> sd->name >> sd->extra >> height;
+  sd->height = height;
+
+  qint32 count = 0;
+  in >> count;
+  for(int i = 0; i < count && in.status() == QDataStream::Ok; i++)
+  {
+    ORObject * o = readObject(in, images);
+    if(o)
+      sd->objects.append(o);
+  }
+
+  sd->trackTotal = readDataList(in);
+  return sd;
+}
+
+static void readReport(QDataStream & in, ORReportData & data, ORCompiledImages & images)
+{
+  qint32 i1, i2;
+  bool b1;
+  double d1, d2;
+  QString s1;
+
+  in >> data.title >> data.name >> data.description;
+
+  in >> i1;
+  for(int i = 0; i < i1 && in.status() == QDataStream::Ok; i++)
+  {
+    ORParameter p;
+    in >> p.name >> p.type >> p.defaultValue >> p.description >> p.listtype
+       >> p.query >> p.values >> p.active;
+    data.definedParams.insert(p.name, p);
+  }
+
+  ORWatermarkData & wm = data.wmData;
+  in >> i1 >> wm.useDefaultFont >> wm.font >> wm.staticText >> wm.text;
+  wm.opacity = i1;
+  wm.data = readData(in);
+  in >> wm.valid;
+
+  ORBackgroundData & bg = data.bgData;
+  in >> bg.enabled >> bg.staticImage >> bg.image;
+  bg.data = readData(in);
+  in >> i1 >> bg.mode >> i2 >> bg.rect;
+  bg.opacity = i1;
+  bg.align = i2;
+
+  ReportPageOptions & page = data.page;
+  in >> d1 >> d2;
+  page.setMarginTop(d1);
+  page.setMarginBottom(d2);
+  in >> d1 >> d2;
+  page.setMarginLeft(d1);
+  page.setMarginRight(d2);
+  in >> s1 >> d1 >> d2;
+  page.setPageSize(s1);
+  page.setCustomWidth(d1);
+  page.setCustomHeight(d2);
+  in >> b1 >> s1;
+  page.setPortrait(b1);
+  page.setLabelType(s1);
+
+  in >> i1;
+  for(int i = 0; i < i1 && in.status() == QDataStream::Ok; i++)
+  {
+    QString name, query, group, mqlname;
+    bool fromDb = false;
+    in >> name >> query >> fromDb >> group >> mqlname;
+    data.queries.add(new QuerySource(name, query, fromDb, group, mqlname));
+  }
+
+  data.pghead_first = readSection(in, images);
+  data.pghead_odd = readSection(in, images);
+  data.pghead_even = readSection(in, images);
+  data.pghead_last = readSection(in, images);
+  data.pghead_any = readSection(in, images);
+  data.rpthead = readSection(in, images);
+  data.rptfoot = readSection(in, images);
+  data.pgfoot_first = readSection(in, images);
+  data.pgfoot_odd = readSection(in, images);
+  data.pgfoot_even = readSection(in, images);
+  data.pgfoot_last = readSection(in, images);
+  data.pgfoot_any = readSection(in, images);
+
+  in >> i1;
+  for(int i = 0; i < i1 && in.status() == QDataStream::Ok; i++)
+  {
+    ORDetailSectionData * dsd = new ORDetailSectionData();
+    in >> dsd->name >> i2 >> dsd->key.query >> dsd->key.column;
+    dsd->pagebreak = i2;
+    dsd->detail = readSection(in, images);
+
+    qint32 groups = 0;
+    in >> groups;
+    for(int g = 0; g < groups && in.status() == QDataStream::Ok; g++)
+    {
+      ORDetailGroupSectionData * grp = new ORDetailGroupSectionData();
+      in >> grp->name >> grp->column >> i2;
+      grp->pagebreak = i2;
+      QList<ORDataData> checkPoints = readDataList(in);
+      for(int c = 0; c < checkPoints.count(); c++)
+        grp->_subtotCheckPoints[checkPoints.at(c)] = 0.0;
+      grp->head = readSection(in, images);
+      grp->foot = readSection(in, images);
+      dsd->groupList.append(grp);
+    }
+    dsd->trackTotal = readDataList(in);
+    data.sections.append(dsd);
+  }
+
+  in >> data.color_map;
+  data.trackTotal = readDataList(in);
+}
+
+//
+// the mapped file, shared by the images that point into it
+//
+class ORMappedFile
+{
+  public:
+    ORMappedFile(const QString & fileName) : file(fileName), data(0), size(0), ref(1) {}
+
+    QFile file;
+    uchar * data;
+    qint64 size;
+    QAtomicInt ref;
+};
+
+static void releaseMappedFile(void * info)
+{
+  ORMappedFile * mapped = static_cast<ORMappedFile*>(info);
+  if(!mapped->ref.deref())
+    delete mapped; // closing the file unmaps it
+}
+
+static quint32 alignedOffset(quint32 offset)
+{
+  return (offset + imageAlign - 1) & ~(quint32)(imageAlign - 1);
+}
+
+//
+// ORCompiledReport
+//
+bool ORCompiledReport::write(QIODevice * device, ORReportDefinition & definition, const QString & source, QString * error)
+{
+  if(!definition.isValid() || definition.data() == 0)
+  {
+    if(error)
+      *error = QObject::tr("The report definition is not valid.");
+    return false;
+  }
+  if(!definition.isCacheable())
+  {
+    if(error)
+      *error = QObject::tr("The report loads data into the database and can not be compiled.");
+    return false;
+  }
+
+  // color tables are not written, so indexed images go as 32 bit
+  ORCompiledImages images;
+  if(!definition._bgImage.isNull())
+  {
+    images.background = images.images.count();
+    images.images.append(definition._bgImage);
+  }
+  // in the order of the objects, so that a definition is always written
+  // the same way
+  QList<ORSectionData*> sections = ORReportDefinition::allSections(*(definition.data()));
+  for(int i = 0; i < sections.count(); i++)
+  {
+    const QList<ORObject*> & objects = sections.at(i)->objects;
+    for(int o = 0; o < objects.count(); o++)
+    {
+      if(!objects.at(o)->isImage())
+        continue;
+      const ORImageData * im = objects.at(o)->toImage();
+      if(images.index.contains(im) || !definition._images.contains(im))
+        continue;
+      images.index.insert(im, images.images.count());
+      images.images.append(definition._images.value(im));
+    }
+  }
+  for(int i = 0; i < images.images.count(); i++)
+  {
+    if(images.images.at(i).colorCount() > 0)
+      images.images[i] = images.images.at(i).convertToFormat(QImage::Format_ARGB32);
+  }
+
+  QByteArray structure;
+  {
+    QDataStream out(&structure, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << (qint32)images.background;
+    writeReport(out, *(definition.data()), images);
+  }
+  QByteArray src = source.toUtf8();
+
+  quint32 structOffset = headerSize + imageEntrySize * images.images.count();
+  quint32 sourceOffset = structOffset + structure.size();
+  quint32 offset = sourceOffset + src.size();
+
+  QByteArray table;
+  QList<quint32> offsets;
+  {
+    QDataStream out(&table, QIODevice::WriteOnly);
+    out << compiledMagic << (quint32)FormatVersion << (quint32)images.images.count()
+        << structOffset << (quint32)structure.size()
+        << sourceOffset << (quint32)src.size() << (quint32)QSysInfo::ByteOrder;
+    for(int i = 0; i < images.images.count(); i++)
+    {
+      const QImage & img = images.images.at(i);
+      offset = alignedOffset(offset);
+      offsets.append(offset);
+      out << offset << (quint32)img.width() << (quint32)img.height()
+          << (quint32)img.bytesPerLine() << (quint32)img.format();
+      offset += img.byteCount();
+    }
+  }
+
+  bool ok = (device->write(table) == table.size() &&
+             device->write(structure) == structure.size() &&
+             device->write(src) == src.size());
+  qint64 pos = sourceOffset + src.size();
+  for(int i = 0; ok && i < images.images.count(); i++)
+  {
+    const QImage & img = images.images.at(i);
+    if(offsets.at(i) > pos)
+      ok = (device->write(QByteArray(offsets.at(i) - pos, '\0')) == offsets.at(i) - pos);
+    ok = ok && (device->write((const char*)img.constBits(), img.byteCount()) == img.byteCount());
+    pos = offsets.at(i) + img.byteCount();
+  }
+
+  if(!ok && error)
+    *error = device->errorString();
+  return ok;
+}
+
+bool ORCompiledReport::compile(const QString & source, const QString & fileName, QSqlDatabase db, QString * error)
+{
+  ORReportDefinitionPtr definition = ORReportDefinition::parse(source, db);
+  if(!definition->isValid())
+  {
+    if(error)
+      *error = QObject::tr("The report definition is not valid.");
+    return false;
+  }
+
+  // written next to the target and renamed over it: a process that has the
+  // old file mapped keeps reading it, truncating it would crash that process
+  QSaveFile file(fileName);
+  if(!file.open(QIODevice::WriteOnly))
+  {
+    if(error)
+      *error = QObject::tr("Could not open %1: %2").arg(fileName).arg(file.errorString());
+    return false;
+  }
+  if(!write(&file, *definition, source, error))
+  {
+    file.cancelWriting();
+    return false;
+  }
+  if(!file.commit())
+  {
+    if(error)
+      *error = QObject::tr("Could not write %1: %2").arg(fileName).arg(file.errorString());
+    return false;
+  }
+  return true;
+}
+
+// the header and image table, checked against the size of the file
+static bool readHeader(const uchar * data, qint64 size, quint32 & imageCount,
+                       quint32 & structOffset, quint32 & structSize,
+                       quint32 & sourceOffset, quint32 & sourceSize, QString * error)
+{
+  if(size < headerSize)
+  {
+    if(error)
+      *error = QObject::tr("The file is not a compiled report.");
+    return false;
+  }
+
+  QDataStream in(QByteArray::fromRawData((const char*)data, headerSize));
+  quint32 magic, version, byteOrder;
+  in >> magic >> version >> imageCount >> structOffset >> structSize
+     >> sourceOffset >> sourceSize >> byteOrder;
+  if(magic != compiledMagic)
+  {
+    if(error)
+      *error = QObject::tr("The file is not a compiled report.");
+    return false;
+  }
+  if(version != ORCompiledReport::FormatVersion)
+  {
+    if(error)
+      *error = QObject::tr("The report was compiled with format %1, this version reads %2; compile it again.")
+                 .arg(version).arg((int)ORCompiledReport::FormatVersion);
+    return false;
+  }
+  if(byteOrder != (quint32)QSysInfo::ByteOrder)
+  {
+    if(error)
+      *error = QObject::tr("The report was compiled on a machine of another byte order; compile it again.");
+    return false;
+  }
+  if((qint64)headerSize + (qint64)imageEntrySize * imageCount > structOffset ||
+     (qint64)structOffset + structSize > size ||
+     (qint64)sourceOffset + sourceSize > size)
+  {
+    if(error)
+      *error = QObject::tr("The compiled report is truncated or damaged.");
+    return false;
+  }
+  return true;
+}
+
+ORReportDefinitionPtr ORCompiledReport::load(const QString & fileName, QSqlDatabase db, QString * error)
+{
+  ORMappedFile * mapped = new ORMappedFile(fileName);
+  if(mapped->file.open(QIODevice::ReadOnly))
+  {
+    mapped->size = mapped->file.size();
+    if(mapped->size > 0)
+      mapped->data = mapped->file.map(0, mapped->size);
+  }
+  if(mapped->data == 0)
+  {
+    if(error)
+      *error = QObject::tr("Could not open %1: %2").arg(fileName).arg(mapped->file.errorString());
+    releaseMappedFile(mapped);
+    return ORReportDefinitionPtr();
+  }
+
+  quint32 imageCount, structOffset, structSize, sourceOffset, sourceSize;
+  if(!readHeader(mapped->data, mapped->size, imageCount, structOffset, structSize,
+                 sourceOffset, sourceSize, error))
+  {
+    releaseMappedFile(mapped);
+    return ORReportDefinitionPtr();
+  }
+
+  QSharedPointer<ORReportDefinition> def(new ORReportDefinition());
+  def->_data = new ORReportData();
+
+  ORCompiledImages images;
+  QDataStream in(QByteArray::fromRawData((const char*)mapped->data + structOffset, structSize));
+  in.setVersion(QDataStream::Qt_5_0);
+  qint32 background = -1;
+  in >> background;
+  readReport(in, *(def->_data), images);
+  if(in.status() != QDataStream::Ok)
+  {
+    if(error)
+      *error = QObject::tr("The compiled report is truncated or damaged.");
+    releaseMappedFile(mapped);
+    return ORReportDefinitionPtr();
+  }
+
+  // the images use the mapped pixels, each holding the file open
+  QDataStream table(QByteArray::fromRawData((const char*)mapped->data + headerSize, imageEntrySize * imageCount));
+  for(quint32 i = 0; i < imageCount; i++)
+  {
+    quint32 offset, width, height, bpl, format;
+    table >> offset >> width >> height >> bpl >> format;
+
+    QImage img;
+    if(offset % 4 == 0 && (qint64)offset + (qint64)bpl * height <= mapped->size)
+    {
+      mapped->ref.ref();
+      img = QImage((const uchar*)mapped->data + offset, width, height, bpl,
+                   (QImage::Format)format, releaseMappedFile, mapped);
+      if(img.isNull())
+        releaseMappedFile(mapped);
+    }
+    images.images.append(img);
+  }
+
+  if(background >= 0)
+    def->_bgImage = images.images.value(background);
+  for(int i = 0; i < images.objects.count(); i++)
+  {
+    QImage img = images.images.value(images.objects.at(i).second);
+    if(!img.isNull())
+      def->_images.insert(images.objects.at(i).first, img);
+  }
+
+  if(def->_data->page.getPageSize() == "Labels")
+    def->_label = LabelSizeInfo::getByName(def->_data->page.getLabelType(), db);
+  def->_valid = true;
+
+  releaseMappedFile(mapped);
+  return def;
+}
+
+bool ORCompiledReport::source(const QString & fileName, QString & source, QString * error)
+{
+  QFile file(fileName);
+  if(!file.open(QIODevice::ReadOnly))
+  {
+    if(error)
+      *error = QObject::tr("Could not open %1: %2").arg(fileName).arg(file.errorString());
+    return false;
+  }
+
+  QByteArray header = file.read(headerSize);
+  qint64 size = (header.size() < headerSize ? header.size() : file.size());
+  quint32 imageCount, structOffset, structSize, sourceOffset, sourceSize;
+  if(!readHeader((const uchar*)header.constData(), size, imageCount, structOffset, structSize,
+                 sourceOffset, sourceSize, error))
+    return false;
+
+  if(!file.seek(sourceOffset))
+  {
+    if(error)
+      *error = file.errorString();
+    return false;
+  }
+  source = QString::fromUtf8(file.read(sourceSize));
+  return true;
+}
+
+bool ORCompiledReport::isCompiled(const QString & fileName)
+{
+  QFile file(fileName);
+  if(!file.open(QIODevice::ReadOnly))
+    return false;
+
+  QDataStream in(file.read(4));
+  quint32 magic = 0;
+  in >> magic;
+  return (magic == compiledMagic);
+}
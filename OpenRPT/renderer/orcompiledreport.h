@@ -0,0 +1,63 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#ifndef __ORCOMPILEDREPORT_H__
+#define __ORCOMPILEDREPORT_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+#include "orreportcache.h"
+
+class QIODevice;
+
+//
+// ORCompiledReport
+// The compiled form of a report definition, an .orc file: the parsed
+// definition written with QDataStream, the static background and inline
+// images as raw pixels, and the XML source it was compiled from so the
+// report can be imported and exported again.
+// Loading one maps the file into memory and reads the definition back with
+// no XML parsing and no uudecoding; the images use the mapped pixels as they
+// are and keep the file mapped until the last copy of them is gone.
+// A file with another FormatVersion, or compiled on a machine of the other
+// byte order, is refused and has to be compiled again: .orc files are not
+// portable between little and big endian machines.
+//
+class ORCompiledReport
+{
+  public:
+    enum { FormatVersion = 2 };
+
+    // the definition has to be valid and may not load data with <database>
+    static bool write(QIODevice *, ORReportDefinition &, const QString & source, QString * error = 0);
+    // fileName is replaced only once the new file is complete, by a rename
+    static bool compile(const QString & source, const QString & fileName,
+                        QSqlDatabase = QSqlDatabase(), QString * error = 0);
+
+    // the database is the one label sizes are looked up in
+    static ORReportDefinitionPtr load(const QString & fileName, QSqlDatabase = QSqlDatabase(), QString * error = 0);
+    // the XML source a compiled file was made from
+    static bool source(const QString & fileName, QString & source, QString * error = 0);
+
+    static bool isCompiled(const QString & fileName);
+};
+
+#endif // __ORCOMPILEDREPORT_H__
@@ -0,0 +1,162 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "orimageexport.h"
+#include "orprintrender.h"
+#include "renderobjects.h"
+
+#include <QAtomicInt>
+#include <QFileInfo>
+#include <QImageWriter>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QtDebug>
+
+//
+// ORImagePageTask
+// Renders one page on a worker thread and either hands the image back
+// or writes it to a file.
+//
+class ORImagePageTask : public QRunnable
+{
+  public:
+    ORImagePageTask(const ORImageExport * exporter, int page, QImage * result)
+      : _exporter(exporter), _page(page), _result(result), _failures(0) {}
+    ORImagePageTask(const ORImageExport * exporter, int page, const QString & fileName, const QByteArray & format, QAtomicInt * failures)
+      : _exporter(exporter), _page(page), _result(0), _fileName(fileName), _format(format), _failures(failures) {}
+
+    virtual void run()
+    {
+      QImage image = _exporter->renderPage(_page);
+      if(_result)
+      {
+        *_result = image;
+        return;
+      }
+
+      QImageWriter writer(_fileName, _format);
+      QByteArray fmt = _format.toLower();
+      if(fmt == "tif" || fmt == "tiff")
+        writer.setCompression(1); // CCITT for 1 bit images, LZW otherwise
+      if(image.isNull() || !writer.write(image))
+      {
+        qWarning() << "Unable to write page" << _page + 1 << "to" << _fileName << writer.errorString();
+        _failures->ref();
+      }
+    }
+
+  private:
+    const ORImageExport * _exporter;
+    int _page;
+    QImage * _result;
+    QString _fileName;
+    QByteArray _format;
+    QAtomicInt * _failures;
+};
+
+ORImageExport::ORImageExport(ORODocument * pDocument)
+  : _document(pDocument), _threadCount(0), _resolution(200), _colorMode(Color)
+{
+}
+
+ORImageExport::~ORImageExport()
+{
+}
+
+void ORImageExport::setDocument(ORODocument * pDocument)
+{
+  _document = pDocument;
+}
+
+void ORImageExport::setThreadCount(int count)
+{
+  _threadCount = count;
+}
+
+void ORImageExport::setResolution(int dpi)
+{
+  _resolution = dpi;
+}
+
+void ORImageExport::setColorMode(ColorMode mode)
+{
+  _colorMode = mode;
+}
+
+QImage ORImageExport::renderPage(int pageNb) const
+{
+  QImage image = ORPrintRender::renderPageToImage(_document, pageNb, _resolution);
+  if(image.isNull())
+    return image;
+
+  if(_colorMode == Grayscale)
+    image = image.convertToFormat(QImage::Format_Grayscale8);
+  else if(_colorMode == Monochrome)
+    image = image.convertToFormat(QImage::Format_Mono, Qt::MonoOnly | Qt::ThresholdDither | Qt::AvoidDither);
+
+  return image;
+}
+
+QList<QImage> ORImageExport::renderPages() const
+{
+  if(_document == 0)
+    return QList<QImage>();
+
+  // each task writes to its own slot, nothing is resized while they run
+  QVector<QImage> images(_document->pages());
+  QImage * results = images.data();
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(_threadCount > 0 ? _threadCount : qMax(1, QThread::idealThreadCount()));
+  for(int page = 0; page < images.size(); page++)
+    pool.start(new ORImagePageTask(this, page, results + page));
+  pool.waitForDone();
+
+  return images.toList();
+}
+
+QString ORImageExport::fileNameForPage(const QString & fileName, int pageNb)
+{
+  if(fileName.contains("%1"))
+    return fileName.arg(pageNb);
+
+  QFileInfo fi(fileName);
+  QString suffix = fi.suffix();
+  QString base = (suffix.isEmpty() ? fileName : fileName.left(fileName.length() - suffix.length() - 1));
+  return base + QString("-%1").arg(pageNb) + (suffix.isEmpty() ? QString() : "." + suffix);
+}
+
+bool ORImageExport::exportToFiles(const QString & fileName, const QByteArray & format) const
+{
+  if(_document == 0 || fileName.isEmpty())
+    return false;
+
+  QAtomicInt failures(0);
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(_threadCount > 0 ? _threadCount : qMax(1, QThread::idealThreadCount()));
+  for(int page = 0; page < _document->pages(); page++)
+    pool.start(new ORImagePageTask(this, page, fileNameForPage(fileName, page + 1), format, &failures));
+  pool.waitForDone();
+
+  return (failures.load() == 0);
+}
@@ -0,0 +1,71 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+#ifndef __ORIMAGEEXPORT_H__
+#define __ORIMAGEEXPORT_H__
+
+#include <QByteArray>
+#include <QImage>
+#include <QList>
+#include <QString>
+
+class ORODocument;
+
+//
+// ORImageExport
+// This class rasterizes the pages of an ORODocument on a pool of worker
+// threads, each page with its own QPainter on its own QImage. Nothing in
+// here touches QPixmap or any other GUI thread only object.
+//
+class ORImageExport
+{
+  public:
+    enum ColorMode { Color, Grayscale, Monochrome };
+
+    ORImageExport(ORODocument * = 0);
+    virtual ~ORImageExport();
+
+    void setDocument(ORODocument *);
+    ORODocument * document() const { return _document; }
+
+    void setThreadCount(int); // 0 : one thread per core
+    int threadCount() const { return _threadCount; }
+
+    void setResolution(int); // dots per inch
+    int resolution() const { return _resolution; }
+
+    void setColorMode(ColorMode); // Monochrome is 1 bit per pixel, fit for fax
+    ColorMode colorMode() const { return _colorMode; }
+
+    QImage renderPage(int) const;
+    QList<QImage> renderPages() const;
+
+    // writes one file per page; a %1 in the name is replaced by the page
+    // number, otherwise the page number is added before the extension
+    bool exportToFiles(const QString &, const QByteArray & format = "PNG") const;
+    static QString fileNameForPage(const QString &, int);
+
+  protected:
+    ORODocument * _document;
+    int _threadCount;
+    int _resolution;
+    ColorMode _colorMode;
+};
+
+#endif // __ORIMAGEEXPORT_H__
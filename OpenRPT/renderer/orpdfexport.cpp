@@ -0,0 +1,583 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "orpdfexport.h"
+#include "orprintrender.h"
+#include "renderobjects.h"
+
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QPageLayout>
+#include <QPainter>
+#include <QPdfWriter>
+#include <QRegExp>
+#include <QRunnable>
+#include <QSet>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <QWaitCondition>
+#include <QtDebug>
+
+//
+// ORPdfObject
+// A single object copied out of a one page PDF. The text before the stream
+// keyword is kept as fragments around the indirect references it contains
+// so the writer can renumber them without parsing the object again. The
+// stream data itself is copied verbatim. The hash of the stream is taken
+// on the worker thread so the writer can spot objects, like the fonts and
+// images, that an earlier page already wrote.
+//
+struct ORPdfObject
+{
+  ORPdfObject() : shareable(true) {}
+
+  QList<QByteArray> text;  // always one more fragment than there are refs
+  QList<int>        refs;  // index of the object in the page, -1 for the page tree
+  QByteArray        stream;
+  QByteArray        streamHash;
+  bool              shareable; // false for the page and its annotations
+};
+
+//
+// ORPdfPage
+// The objects needed to draw one page, starting with the page object.
+//
+struct ORPdfPage
+{
+  ORPdfPage() : valid(false) {}
+
+  bool valid;
+  QList<ORPdfObject> objects;
+};
+
+//
+// ORPdfExportJob
+// State shared between the writer and the worker threads.
+//
+struct ORPdfExportJob
+{
+  ORODocument * document;
+  QPageLayout layout;
+  int resolution;
+
+  QMutex mutex;
+  QWaitCondition ready;
+  QVector<ORPdfPage*> pages; // filled in by the workers, taken by the writer
+};
+
+static QByteArray renderPdfPage(ORPdfExportJob * job, int pageNb)
+{
+  QByteArray data;
+  QBuffer buffer(&data);
+  buffer.open(QIODevice::WriteOnly);
+
+  QPdfWriter writer(&buffer);
+  writer.setCreator("OpenRPT Print Renderer");
+  writer.setResolution(job->resolution);
+  writer.setPageLayout(job->layout);
+
+  QPainter painter;
+  if(!painter.begin(&writer))
+    return QByteArray();
+  ORPrintRender::renderPage(job->document, pageNb, &painter, writer.logicalDpiX(), writer.logicalDpiY(), QSize(0, 0), job->resolution);
+  painter.end();
+
+  return data;
+}
+
+// returns the position of the stream keyword that follows the object
+// dictionary or -1 if the object has no stream
+static int streamKeyword(const QByteArray & body)
+{
+  int pos = 0;
+  while((pos = body.indexOf("stream", pos)) >= 0)
+  {
+    int after = pos + 6;
+    if(after < body.size() && (body.at(after) == '\n' || body.at(after) == '\r'))
+    {
+      int before = pos - 1;
+      while(before >= 0 && (body.at(before) == ' ' || body.at(before) == '\n' || body.at(before) == '\r'))
+        before--;
+      if(before >= 1 && body.at(before) == '>' && body.at(before - 1) == '>')
+        return pos;
+    }
+    pos = after;
+  }
+  return -1;
+}
+
+static QByteArray dictionaryPart(const QByteArray & body)
+{
+  int pos = streamKeyword(body);
+  return (pos < 0 ? body : body.left(pos));
+}
+
+// finds the next "n 0 R" reference at or after pos, skipping digits
+// that belong to a name such as /F1
+static int nextReference(QRegExp & refRe, const QString & text, int pos)
+{
+  while((pos = refRe.indexIn(text, pos)) != -1)
+  {
+    if(pos == 0 || !text.at(pos - 1).isLetterOrNumber())
+      return pos;
+    pos++;
+  }
+  return -1;
+}
+
+static int referenceAfter(const QByteArray & dict, const char * key)
+{
+  int pos = dict.indexOf(key);
+  if(pos < 0)
+    return -1;
+
+  QRegExp refRe("(\\d+)\\s+\\d+\\s+R");
+  if(nextReference(refRe, QString::fromLatin1(dict.constData(), dict.size()), pos) < 0)
+    return -1;
+  return refRe.cap(1).toInt();
+}
+
+// Splits the output of QPdfWriter for a single page into the objects
+// reachable from that page. The catalog, the page tree and the document
+// information are left behind as the writer produces its own.
+static bool parsePdfPage(const QByteArray & pdf, ORPdfPage & page)
+{
+  int sx = pdf.lastIndexOf("startxref");
+  if(sx < 0)
+    return false;
+  int xrefPos = pdf.mid(sx + 9, 32).simplified().split(' ').value(0).toInt();
+  if(xrefPos <= 0 || pdf.mid(xrefPos, 4) != "xref")
+    return false;
+  int trailerPos = pdf.indexOf("trailer", xrefPos);
+  if(trailerPos < 0)
+    return false;
+
+  // read the cross-reference table as whitespace separated tokens: each
+  // subsection is "first count" followed by count "offset generation n|f"
+  // entries, whatever end of line the entries were padded with
+  QMap<int, int> byOffset; // offset -> object number
+  QList<QByteArray> tokens = pdf.mid(xrefPos + 4, trailerPos - xrefPos - 4).simplified().split(' ');
+  if(tokens.size() == 1 && tokens.at(0).isEmpty())
+    tokens.clear();
+  int t = 0;
+  while(t < tokens.size())
+  {
+    if(t + 2 > tokens.size())
+      return false;
+    int first = tokens.at(t).toInt();
+    int count = tokens.at(t + 1).toInt();
+    t += 2;
+    if(count < 0 || t + count * 3 > tokens.size())
+      return false;
+    for(int i = 0; i < count; i++, t += 3)
+    {
+      if(tokens.at(t + 2) == "n")
+        byOffset.insert(tokens.at(t).toInt(), first + i);
+    }
+  }
+
+  QMap<int, QByteArray> bodies;
+  QMapIterator<int, int> oit(byOffset);
+  while(oit.hasNext())
+  {
+    oit.next();
+    int end = oit.hasNext() ? oit.peekNext().key() : xrefPos;
+    int start = pdf.indexOf("obj", oit.key());
+    int stop = pdf.lastIndexOf("endobj", end - 1);
+    if(start < 0 || stop < start + 3)
+      return false;
+    start += 3;
+    while(start < stop && (pdf.at(start) == '\n' || pdf.at(start) == '\r' || pdf.at(start) == ' '))
+      start++;
+    bodies.insert(oit.value(), pdf.mid(start, stop - start));
+  }
+
+  int root = referenceAfter(pdf.mid(trailerPos, sx - trailerPos), "/Root");
+  int pageTree = referenceAfter(dictionaryPart(bodies.value(root)), "/Pages");
+  int pageObj = referenceAfter(dictionaryPart(bodies.value(pageTree)), "/Kids");
+  if(!bodies.contains(pageObj))
+    return false;
+
+  // collect everything the page refers to, the page object first
+  QRegExp refRe("(\\d+)\\s+\\d+\\s+R");
+  QList<int> order;
+  QMap<int, int> local;
+  QSet<int> seen;
+  seen << pageObj << pageTree << root;
+  order << pageObj;
+  for(int i = 0; i < order.size(); i++)
+  {
+    local.insert(order.at(i), i);
+    QByteArray dict = dictionaryPart(bodies.value(order.at(i)));
+    QString text = QString::fromLatin1(dict.constData(), dict.size());
+    int p = 0;
+    while((p = nextReference(refRe, text, p)) != -1)
+    {
+      int r = refRe.cap(1).toInt();
+      if(!seen.contains(r) && bodies.contains(r))
+      {
+        seen << r;
+        order << r;
+      }
+      p += refRe.matchedLength();
+    }
+  }
+
+  foreach(int n, order)
+  {
+    QByteArray body = bodies.value(n);
+    int sp = streamKeyword(body);
+    QByteArray dict = (sp < 0 ? body : body.left(sp));
+    QString text = QString::fromLatin1(dict.constData(), dict.size());
+
+    ORPdfObject obj;
+    if(sp >= 0)
+    {
+      obj.stream = body.mid(sp);
+      obj.streamHash = QCryptographicHash::hash(obj.stream, QCryptographicHash::Sha1);
+    }
+    // an annotation belongs to a single page
+    obj.shareable = (n != pageObj && !dict.contains("/Annot"));
+
+    int last = 0;
+    int p = 0;
+    while((p = nextReference(refRe, text, p)) != -1)
+    {
+      int r = refRe.cap(1).toInt();
+      int len = refRe.matchedLength();
+      if(r == pageTree || local.contains(r))
+      {
+        obj.text << dict.mid(last, p - last);
+        obj.refs << (r == pageTree ? -1 : local.value(r));
+        last = p + len;
+      }
+      p += len;
+    }
+    obj.text << dict.mid(last);
+    page.objects << obj;
+  }
+
+  return true;
+}
+
+//
+// ORPdfPageTask
+// Renders and splits one page on a worker thread.
+//
+class ORPdfPageTask : public QRunnable
+{
+  public:
+    ORPdfPageTask(ORPdfExportJob * job, int page) : _job(job), _page(page) {}
+
+    virtual void run()
+    {
+      ORPdfPage * result = new ORPdfPage();
+      result->valid = parsePdfPage(renderPdfPage(_job, _page), *result);
+
+      QMutexLocker locker(&_job->mutex);
+      _job->pages[_page] = result;
+      _job->ready.wakeAll();
+    }
+
+  private:
+    ORPdfExportJob * _job;
+    int _page;
+};
+
+static QByteArray pdfString(const QString & str)
+{
+  QByteArray out("(\xFE\xFF");
+  for(int i = 0; i < str.length(); i++)
+  {
+    ushort u = str.at(i).unicode();
+    char bytes[2] = { (char)(u >> 8), (char)(u & 0xFF) };
+    for(int b = 0; b < 2; b++)
+    {
+      if(bytes[b] == '(' || bytes[b] == ')' || bytes[b] == '\\')
+        out.append('\\');
+      if(bytes[b] == '\r')
+        out.append("\\r");
+      else
+        out.append(bytes[b]);
+    }
+  }
+  out.append(')');
+  return out;
+}
+
+static bool writeBytes(QIODevice * out, const QByteArray & bytes, qint64 & pos)
+{
+  qint64 written = out->write(bytes);
+  if(written > 0)
+    pos += written;
+  return (written == bytes.size());
+}
+
+// the dictionary of the object with its references renumbered
+static QByteArray objectText(const ORPdfObject & obj, const QVector<int> & numbers, int pageTree)
+{
+  QByteArray data;
+  for(int i = 0; i < obj.text.size(); i++)
+  {
+    data += obj.text.at(i);
+    if(i < obj.refs.size())
+      data += QByteArray::number(obj.refs.at(i) < 0 ? pageTree : numbers.at(obj.refs.at(i))) + " 0 R";
+  }
+  if(!data.endsWith('\n'))
+    data += '\n';
+  return data;
+}
+
+static bool writeObject(QIODevice * out, int number, const QByteArray & text, const ORPdfObject & obj, qint64 & pos)
+{
+  if(!writeBytes(out, QByteArray::number(number) + " 0 obj\n" + text, pos))
+    return false;
+  if(!obj.stream.isEmpty())
+  {
+    if(!writeBytes(out, obj.stream, pos))
+      return false;
+    if(!obj.stream.endsWith('\n') && !writeBytes(out, "\n", pos))
+      return false;
+  }
+  return writeBytes(out, "endobj\n", pos);
+}
+
+//
+// ORPdfPageWriter
+// Copies the objects of the pages into the output. Objects are written
+// after the ones they refer to so that an object whose dictionary, once
+// renumbered, and stream match one written for an earlier page is replaced
+// by a reference to that one. The font subsets of pages drawing the same
+// glyphs and the images repeated on every page are only written once.
+//
+class ORPdfPageWriter
+{
+  public:
+    ORPdfPageWriter(QIODevice * out, QVector<qint64> & xref, qint64 & pos, int pageTree)
+      : _out(out), _xref(xref), _pos(pos), _pageTree(pageTree), _page(0) {}
+
+    // returns the number of the page object or 0 on a write error
+    int write(const ORPdfPage & page)
+    {
+      _page = &page;
+      _numbers.fill(0, page.objects.size());
+      _visited.fill(false, page.objects.size());
+      if(page.objects.isEmpty() || !visit(0))
+        return 0;
+      return _numbers.at(0);
+    }
+
+  protected:
+    bool visit(int index)
+    {
+      _visited[index] = true;
+      const ORPdfObject & obj = _page->objects.at(index);
+      foreach(int r, obj.refs)
+      {
+        if(r >= 0 && !_visited.at(r) && !visit(r))
+          return false;
+      }
+      // a reference back to an object not written yet gets its number now
+      foreach(int r, obj.refs)
+      {
+        if(r >= 0 && _numbers.at(r) == 0)
+        {
+          _numbers[r] = _xref.size();
+          _xref << 0;
+        }
+      }
+
+      QByteArray text = objectText(obj, _numbers, _pageTree);
+      QByteArray key;
+      bool reserved = (_numbers.at(index) != 0);
+      if(obj.shareable && !reserved)
+      {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(text);
+        hash.addData(obj.streamHash);
+        key = hash.result();
+        int number = _shared.value(key, 0);
+        if(number != 0)
+        {
+          _numbers[index] = number;
+          return true;
+        }
+      }
+
+      if(reserved)
+        _xref[_numbers.at(index)] = _pos;
+      else
+      {
+        _numbers[index] = _xref.size();
+        _xref << _pos;
+      }
+      if(!key.isEmpty())
+        _shared.insert(key, _numbers.at(index));
+      return writeObject(_out, _numbers.at(index), text, obj, _pos);
+    }
+
+    QIODevice * _out;
+    QVector<qint64> & _xref;
+    qint64 & _pos;
+    int _pageTree;
+
+    const ORPdfPage * _page;
+    QVector<int> _numbers;  // output number of each object of the page
+    QVector<bool> _visited;
+    QHash<QByteArray, int> _shared; // hash of what was written -> number
+};
+
+//
+// ORPdfExport
+//
+ORPdfExport::ORPdfExport(ORODocument * pDocument)
+  : _document(pDocument), _threadCount(0), _resolution(300)
+{
+}
+
+ORPdfExport::~ORPdfExport()
+{
+}
+
+void ORPdfExport::setDocument(ORODocument * pDocument)
+{
+  _document = pDocument;
+}
+
+void ORPdfExport::setThreadCount(int count)
+{
+  _threadCount = count;
+}
+
+void ORPdfExport::setResolution(int resolution)
+{
+  _resolution = resolution;
+}
+
+bool ORPdfExport::exportToFile(const QString & fileName)
+{
+  QFile file(fileName);
+  if(!file.open(QIODevice::WriteOnly))
+  {
+    qWarning() << "Unable to open" << fileName << "for writing";
+    return false;
+  }
+  return exportToDevice(&file);
+}
+
+bool ORPdfExport::exportToDevice(QIODevice * out)
+{
+  if(_document == 0 || out == 0 || !out->isWritable())
+    return false;
+
+  ORPdfExportJob job;
+  job.document = _document;
+  job.resolution = _resolution;
+  job.layout = QPageLayout(QPageSize(ORPrintRender::paperSize(_document), QPageSize::Inch),
+                           QPageLayout::Portrait, QMarginsF(0, 0, 0, 0));
+  job.pages.fill(0, _document->pages());
+
+  int threads = (_threadCount > 0 ? _threadCount : QThread::idealThreadCount());
+  if(threads < 1)
+    threads = 1;
+
+  // keep a bounded number of finished pages waiting for the writer
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+  const int window = threads * 2;
+  int queued = 0;
+  for(; queued < job.pages.size() && queued < window; queued++)
+    pool.start(new ORPdfPageTask(&job, queued));
+
+  // object 1 is the catalog and object 2 the page tree, both written last
+  QVector<qint64> xref(3, 0);
+  QList<int> kids;
+  qint64 pos = 0;
+  bool ok = writeBytes(out, "%PDF-1.4\n%\xE2\xE3\xCF\xD3\n", pos);
+  ORPdfPageWriter writer(out, xref, pos, 2);
+
+  for(int p = 0; ok && p < job.pages.size(); p++)
+  {
+    job.mutex.lock();
+    while(job.pages.at(p) == 0)
+      job.ready.wait(&job.mutex);
+    ORPdfPage * page = job.pages.at(p);
+    job.pages[p] = 0;
+    job.mutex.unlock();
+
+    if(!page->valid)
+    {
+      qWarning() << "Unable to render page" << p + 1 << "to PDF";
+      ok = false;
+    }
+    else
+    {
+      int kid = writer.write(*page);
+      ok = (kid != 0);
+      kids << kid;
+    }
+    delete page;
+
+    if(ok && queued < job.pages.size())
+      pool.start(new ORPdfPageTask(&job, queued++));
+  }
+
+  // after a failure the pages not started yet are dropped and the ones
+  // already rendered thrown away
+  pool.clear();
+  pool.waitForDone();
+  qDeleteAll(job.pages);
+
+  if(!ok)
+    return false;
+
+  xref[1] = pos;
+  ok = writeBytes(out, "1 0 obj\n<<\n/Type /Catalog\n/Pages 2 0 R\n>>\nendobj\n", pos);
+
+  xref[2] = pos;
+  QByteArray tree("2 0 obj\n<<\n/Type /Pages\n/Kids [\n");
+  foreach(int kid, kids)
+    tree += QByteArray::number(kid) + " 0 R\n";
+  tree += "]\n/Count " + QByteArray::number(kids.size()) + "\n>>\nendobj\n";
+  ok = ok && writeBytes(out, tree, pos);
+
+  int info = xref.size();
+  xref << pos;
+  ok = ok && writeBytes(out, QByteArray::number(info) + " 0 obj\n<<\n/Creator " + pdfString("OpenRPT Print Renderer") +
+                             "\n/Producer " + pdfString("OpenRPT Print Renderer") +
+                             "\n/Title " + pdfString(_document->title()) + "\n>>\nendobj\n", pos);
+
+  qint64 xrefPos = pos;
+  QByteArray table = "xref\n0 " + QByteArray::number(xref.size()) + "\n0000000000 65535 f \n";
+  for(int i = 1; i < xref.size(); i++)
+    table += QString("%1 00000 n \n").arg(xref.at(i), 10, 10, QLatin1Char('0')).toLatin1();
+  table += "trailer\n<<\n/Size " + QByteArray::number(xref.size()) +
+           "\n/Info " + QByteArray::number(info) + " 0 R\n/Root 1 0 R\n>>\nstartxref\n" +
+           QByteArray::number(xrefPos) + "\n%%EOF\n";
+  ok = ok && writeBytes(out, table, pos);
+
+  return ok;
+}
@@ -0,0 +1,64 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+#ifndef __ORPDFEXPORT_H__
+#define __ORPDFEXPORT_H__
+
+#include <QString>
+
+class QIODevice;
+class ORODocument;
+
+//
+// ORPdfExport
+// This class writes an ORODocument to PDF using a pool of worker threads.
+// Every page is rendered, encoded and compressed on its own as a single
+// page PDF. The calling thread then copies the objects of those pages into
+// the output in page order and writes the cross-reference table, so the
+// result is the same whatever the number of threads.
+// Fonts are subset per page: an object identical to one written for an
+// earlier page is shared, but pages drawing different glyphs still carry
+// their own subsets, which makes the files larger than the ones written by
+// ORPrintRender::exportToPDF(). Rendering stops at the first page failing.
+//
+class ORPdfExport
+{
+  public:
+    ORPdfExport(ORODocument * = 0);
+    virtual ~ORPdfExport();
+
+    void setDocument(ORODocument *);
+    ORODocument * document() const { return _document; }
+
+    void setThreadCount(int); // 0 : one thread per core
+    int threadCount() const { return _threadCount; }
+
+    void setResolution(int);
+    int resolution() const { return _resolution; }
+
+    bool exportToFile(const QString &);
+    bool exportToDevice(QIODevice *);
+
+  protected:
+    ORODocument * _document;
+    int _threadCount;
+    int _resolution;
+};
+
+#endif // __ORPDFEXPORT_H__
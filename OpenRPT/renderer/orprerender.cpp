@@ -23,6 +23,7 @@
 #include "orprerender.h"
 #include "renderobjects.h"
 #include "orutils.h"
+#include "orreportcache.h"
 #include "graph.h"
 #include "crosstab.h"
 #include "reportprinter.h"
@@ -48,19 +49,38 @@
 // without presenting to them things that they don't need to see
 // and may change over time.
 //
+//
+// ORBurstData
+// What burst() read: the rows of every query and where each part of the
+// detail query starts. Nothing in here changes once burst() returns.
+//
+class ORBurstData {
+  public:
+    int partSize(int part, int rows) const
+    {
+      return (part + 1 < firsts.size() ? firsts.at(part + 1) : rows) - firsts.at(part);
+    }
+
+    QList<QPair<QString, orQueryRows> > queries; // in the order createQueries() runs them
+    QString query;      // the detail query that is split
+    QString column;     // the column it is split on
+    QList<int> firsts;  // first row of each part
+    QStringList keys;   // value of the column for each part
+};
+
 class ORPreRenderPrivate {
   public:
     ORPreRenderPrivate();
     virtual ~ORPreRenderPrivate();
 
     bool _valid;
-    QDomDocument _docReport;
     ParameterList _lstParameters;
 
     QSqlDatabase _database;
     ORODocument* _document;
     OROPage*     _page;
-    ORReportData* _reportData;
+    ORReportDefinitionPtr _definition; // shared, never changed while laying out
+    ORReportData* _reportData; // the data of _definition
 
     qreal _yOffset;      // how far down the current page are we in inches. That way we can use dpi.
     qreal _topMargin;    // value stored in the correct units
@@ -72,6 +92,7 @@ class ORPreRenderPrivate {
     int _pageCounter;    // what page are we currently on?
 
     QList<orQuery*> _lstQueries;
+    orQuery _emptyQuery; // what getQuerySource() gives for unknown names
     QMap<QString, QColor> _colorMap;
     QList<OROTextBox*> _postProcText;
 
@@ -98,11 +119,18 @@ class ORPreRenderPrivate {
     bool    _bgScale;    // scale image to fit in _bgRect?
     Qt::AspectRatioMode _bgScaleMode; // how do we scale the image?
 
+    bool    _spatialIndex; // build an OROPage index when a page is finished
+
+    QSharedPointer<ORBurstData> _burst; // set by burst(), may be shared with other instances
+    int     _burstPart;    // the part generate() lays out, -1 for the whole report
+
     void renderBackground(OROPage *);
     void renderWatermark(OROPage *);
 
     QMap<ORDataData,double> _subtotPageCheckPoints;
     QMap<ORDataData,double> * _subtotContextMap;
+    QHash<const ORDetailGroupSectionData*, QMap<ORDataData,double> > _subtotGroupCheckPoints;
+    QMap<ORDataData,double> & groupCheckPoints(const ORDetailGroupSectionData *);
     ORDetailSectionData * _subtotContextDetail;
     bool _subtotContextPageFooter;
 
@@ -111,6 +139,8 @@ class ORPreRenderPrivate {
     bool populateColorData(const ORDataData&, orData&);
 
     orQuery* getQuerySource(const QString &);
+    void createQueries();
+    void createBurstQueries(int);
 
     void createNewPage();
     qreal finishCurPage(bool = false);
@@ -162,6 +192,9 @@ ORPreRenderPrivate::ORPreRenderPrivate()
   _bgScale = false;
   _bgScaleMode = Qt::IgnoreAspectRatio;
 
+  _spatialIndex = false;
+  _burstPart = -1;
+
   _subtotContextMap = 0;
   _subtotContextDetail = 0;
   _subtotContextPageFooter = false;
@@ -172,11 +205,8 @@ ORPreRenderPrivate::ORPreRenderPrivate()
 
 ORPreRenderPrivate::~ORPreRenderPrivate()
 {
-  if(_reportData != 0)
-  {
-    delete _reportData;
-    _reportData = 0;
-  }
+  _reportData = 0;
+  _definition.clear();
 
   while(!_lstQueries.isEmpty())
     delete _lstQueries.takeFirst();
@@ -214,8 +244,6 @@ bool ORPreRenderPrivate::populateColorData(const ORDataData& dataSource, orData&
 
 orQuery* ORPreRenderPrivate::getQuerySource(const QString & qstrQueryName)
 {
-  static orQuery emptyQuery;
-
   for(int queryCursor = 0; queryCursor < _lstQueries.count(); queryCursor++)
   {
     if (_lstQueries.at(queryCursor)->getName() == qstrQueryName)
@@ -224,7 +252,7 @@ orQuery* ORPreRenderPrivate::getQuerySource(const QString & qstrQueryName)
 
   QString docName = _reportData ? _reportData->name : "";
   qWarning() << "No Query Source with name" << qstrQueryName << "in" << docName;
-  return &emptyQuery;
+  return &_emptyQuery;
 }
 
 void ORPreRenderPrivate::renderBackground(OROPage * p)
@@ -345,6 +373,9 @@ qreal ORPreRenderPrivate::finishCurPageSize(bool lastPage)
       retval = renderSectionSize(*(_reportData->pgfoot_any));
   _subtotContextPageFooter = false;
 
+  if(_spatialIndex && _page != 0)
+    _page->buildIndex();
+
   return retval;
 }
 
@@ -444,6 +475,9 @@ qreal ORPreRenderPrivate::finishCurPage(bool lastPage)
   }
   _subtotContextPageFooter = false;
 
+  if(_spatialIndex && _page != 0)
+    _page->buildIndex();
+
   return retval;
 }
 
@@ -487,16 +521,16 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
       {
         cnt++;
         grp = detailData.groupList[i];
-        QMapIterator<ORDataData,double> it(grp->_subtotCheckPoints);
+        QMutableMapIterator<ORDataData,double> it(groupCheckPoints(grp));
         while(it.hasNext())
         {
           it.next();
-          grp->_subtotCheckPoints.insert(it.key(), 0.0);
+          it.setValue(0.0);
         }
         keys.append(grp->column);
         if(!keys[i].isEmpty()) keyValues.append(query->value(keys[i]).toString());
         else keyValues.append(QString());
-        _subtotContextMap = &(grp->_subtotCheckPoints);
+        _subtotContextMap = &groupCheckPoints(grp);
         if(grp->head)
           renderSection(*(grp->head));
         _subtotContextMap = 0;
@@ -552,7 +586,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
                   createNewPage();
                 do_break = false;
                 grp = detailData.groupList[i];
-                _subtotContextMap = &(grp->_subtotCheckPoints);
+                _subtotContextMap = &groupCheckPoints(grp);
                 if(grp->foot)
                 {
                   if ( renderSectionSize(*(grp->foot)) + finishCurPageSize() + _bottomMargin + _yOffset >= _maxHeight)
@@ -561,7 +595,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
                 }
                 _subtotContextMap = 0;
                 // reset the sub-total values for this group
-                QMapIterator<ORDataData,double> it(grp->_subtotCheckPoints);
+                QMutableMapIterator<ORDataData,double> it(groupCheckPoints(grp));
                 while(it.hasNext())
                 {
                   it.next();
@@ -570,7 +604,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
                   XSqlQuery * xqry = getQuerySource(data.query)->getQuery();
                   if(xqry)
                     d = xqry->getFieldTotal(data.column);
-                  grp->_subtotCheckPoints.insert(it.key(), d);
+                  it.setValue(d);
                 }
                 if(ORDetailGroupSectionData::BreakAfterGroupFoot == grp->pagebreak)
                   do_break = true;
@@ -585,7 +619,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
                 for(i = pos; i < cnt; i++)
                 {
                   grp = detailData.groupList[i];
-                  _subtotContextMap = &(grp->_subtotCheckPoints);
+                  _subtotContextMap = &groupCheckPoints(grp);
                   if(grp->head)
                   {
                     if ( renderSectionSize(*(grp->head)) + finishCurPageSize() + _bottomMargin + _yOffset >= _maxHeight)
@@ -624,7 +658,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
         for(i = cnt - 1; i >= 0; i--)
         {
           grp = detailData.groupList[i];
-          _subtotContextMap = &(grp->_subtotCheckPoints);
+          _subtotContextMap = &groupCheckPoints(grp);
           if(grp->foot)
           {
             if ( renderSectionSize(*(grp->foot)) + finishCurPageSize() + _bottomMargin + _yOffset >= _maxHeight)
@@ -633,7 +667,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
           }
           _subtotContextMap = 0;
           // reset the sub-total values for this group
-          QMapIterator<ORDataData,double> it(grp->_subtotCheckPoints);
+          QMutableMapIterator<ORDataData,double> it(groupCheckPoints(grp));
           while(it.hasNext())
           {
             it.next();
@@ -642,7 +676,7 @@ void ORPreRenderPrivate::renderDetailSection(ORDetailSectionData & detailData)
             XSqlQuery * xqry = getQuerySource(data.query)->getQuery();
             if(xqry)
               d = xqry->getFieldTotal(data.column);
-            grp->_subtotCheckPoints.insert(it.key(), d);
+            it.setValue(d);
           }
         }
       }
@@ -720,7 +754,7 @@ qreal ORPreRenderPrivate::renderSection(const ORSectionData & sectionData)
       pos += QPointF(_leftMargin, _yOffset);
       size /= 100.0;
 
-      addTextPrimitive(elemThis, pos, size, l->align, qApp->translate(_reportData->name.toUtf8().data(), l->string.toUtf8().data(), 0, QCoreApplication::UnicodeUTF8), l->font);
+      addTextPrimitive(elemThis, pos, size, l->align, QCoreApplication::translate(_reportData->name.toUtf8().data(), l->string.toUtf8().data(), 0, QCoreApplication::UnicodeUTF8), l->font);
     }
     else if (elemThis->isField())
     {
@@ -842,8 +876,12 @@ qreal ORPreRenderPrivate::renderSection(const ORSectionData & sectionData)
       ORImageData * im = elemThis->toImage();
       QString uudata = im->inline_data;
       QByteArray imgdata;
+      // inline images are decoded once, when the definition is parsed
+      QImage img = (_definition ? _definition->image(im) : QImage());
 
-      if(uudata == QString::null)
+      if(!img.isNull())
+        ;
+      else if(uudata == QString::null)
       {
         orData dataThis;
         populateData(im->data, dataThis);
@@ -879,9 +917,9 @@ qreal ORPreRenderPrivate::renderSection(const ORSectionData & sectionData)
         imgdata = QUUDecode(uudata);
       }
 
-      QImage img;
-
-      if(imgdata.isEmpty()) {
+      if(!img.isNull())
+          ;
+      else if(imgdata.isEmpty()) {
           // not uuencoded data, so it should be a file name
           bool ok = img.load(uudata.trimmed());
           if(!ok) {
@@ -1288,8 +1326,9 @@ double ORPreRenderPrivate::getNearestSubTotalCheckPoint(const ORDataData & d)
     for(int i = 0; i < (int)_subtotContextDetail->groupList.count(); i++)
     {
       grp = _subtotContextDetail->groupList[i];
-      if(grp->_subtotCheckPoints.contains(d))
-        dbl = grp->_subtotCheckPoints[d];
+      QMap<ORDataData,double> & checkPoints = groupCheckPoints(grp);
+      if(checkPoints.contains(d))
+        dbl = checkPoints[d];
     }
     return dbl;
 
@@ -1299,6 +1338,91 @@ double ORPreRenderPrivate::getNearestSubTotalCheckPoint(const ORDataData & d)
 }
 
 
+//
+// groupCheckPoints
+//   The sub-total check points of a group for this run. They start from the
+//   ones the definition lists and are kept here, the definition may be
+//   shared with other runs.
+//
+QMap<ORDataData,double> & ORPreRenderPrivate::groupCheckPoints(const ORDetailGroupSectionData * grp)
+{
+  QHash<const ORDetailGroupSectionData*, QMap<ORDataData,double> >::iterator it = _subtotGroupCheckPoints.find(grp);
+  if(it == _subtotGroupCheckPoints.end())
+    it = _subtotGroupCheckPoints.insert(grp, grp->_subtotCheckPoints);
+  return it.value();
+}
+
+//
+// createQueries
+//   Run the context and parameter queries and every query source of the
+//   report, in that order.
+//
+void ORPreRenderPrivate::createQueries()
+{
+  _lstQueries.append( new orQuery( "Context Query",			// MANU
+        getSqlFromTag("fmt03", _database.driverName()),
+      ParameterList(), true, _database ));
+
+  QString tQuery = getSqlFromTag("fmt01",_database.driverName() );	// MANU
+  if(_database.driverName()== "QOCI")
+	  tQuery.replace("from dual","");
+
+  QString val = QString::null;
+  QRegExp re("'");
+  for(int t = 0; t < _lstParameters.count(); t++)
+  {
+    Parameter p = _lstParameters[t];
+    val = p.value().toString();
+    val = val.replace(re, "''");
+    if (_database.driverName() == "QMYSQL")
+      tQuery += QString().sprintf(", \"%s\" AS \"%d\"", val.toLatin1().data(), t + 1);
+	else if (_database.driverName() == "QOCI")
+		tQuery += QString().sprintf(", '%s' AS \"%d\"", val.toLatin1().data(), t + 1);
+    else
+      tQuery += QString().sprintf(", text('%s') AS \"%d\"", val.toLatin1().data(), t + 1);
+
+    if(!p.name().isEmpty())
+    {
+      if (_database.driverName() == "QMYSQL" )
+        tQuery += QString().sprintf(", \"%s\" AS \"%s\"", val.toLatin1().data(), p.name().toLatin1().data());
+	  else if ( _database.driverName() == "QOCI")
+		  tQuery += QString().sprintf(", '%s' AS \"%s\"", val.toLatin1().data(), p.name().toLatin1().data());
+      else
+        tQuery += QString().sprintf(", text('%s') AS \"%s\"", val.toLatin1().data(), p.name().toLatin1().data());
+    }
+  }
+  if(_database.driverName() == "QOCI")
+	tQuery.push_back(" from dual");
+
+  _lstQueries.append(new orQuery("Parameter Query", tQuery, ParameterList(), true, _database));
+  
+  QuerySource * qs = 0;
+  for(unsigned int i = 0; i < _reportData->queries.size(); i++) {
+      qs = _reportData->queries.get(i);
+      _lstQueries.append(new orQuery(qs->name(), qs->query(_database), _lstParameters, true, _database));
+  }
+}
+
+//
+// createBurstQueries
+//   Give the queries the rows burst() read in, the detail query only the
+//   rows of the given part.
+//
+void ORPreRenderPrivate::createBurstQueries(int part)
+{
+  for(int i = 0; i < _burst->queries.size(); i++)
+  {
+    const QString & name = _burst->queries.at(i).first;
+    const orQueryRows & rows = _burst->queries.at(i).second;
+    XSqlQuery * query = 0;
+    if(name == _burst->query)
+      query = rows.createQuery(_burst->firsts.at(part), _burst->partSize(part, rows.count()));
+    else
+      query = rows.createQuery();
+    _lstQueries.append(new orQuery(name, query));
+  }
+}
+
 //
 // ORPreRender
 //
@@ -1341,7 +1465,7 @@ ORODocument* ORPreRender::generate()
   // Do this check now so we don't have to undo alot of work later if it fails
   LabelSizeInfo label;
   if(_internal->_reportData->page.getPageSize() == "Labels") {
-    label = LabelSizeInfo::getByName(_internal->_reportData->page.getLabelType());
+    label = _internal->_definition->label();
     if(label.isNull())
       return 0;
   }
@@ -1414,50 +1538,13 @@ ORODocument* ORPreRender::generate()
   while(!_internal->_lstQueries.isEmpty())
     delete _internal->_lstQueries.takeFirst();
 
-  _internal->_lstQueries.append( new orQuery( "Context Query",			// MANU
-        getSqlFromTag("fmt03", _internal->_database.driverName()),
-      ParameterList(), true, _internal->_database ));
-
-  QString tQuery = getSqlFromTag("fmt01",_internal->_database.driverName() );	// MANU
-  if(_internal->_database.driverName()== "QOCI")
-	  tQuery.replace("from dual","");
-
-  QString val = QString::null;
-  QRegExp re("'");
-  for(int t = 0; t < _internal->_lstParameters.count(); t++)
-  {
-    Parameter p = _internal->_lstParameters[t];
-    val = p.value().toString();
-    val = val.replace(re, "''");
-    if (_internal->_database.driverName() == "QMYSQL")
-      tQuery += QString().sprintf(", \"%s\" AS \"%d\"", val.toLatin1().data(), t + 1);
-	else if (_internal->_database.driverName() == "QOCI")
-		tQuery += QString().sprintf(", '%s' AS \"%d\"", val.toLatin1().data(), t + 1);
-    else
-      tQuery += QString().sprintf(", text('%s') AS \"%d\"", val.toLatin1().data(), t + 1);
-
-    if(!p.name().isEmpty())
-    {
-      if (_internal->_database.driverName() == "QMYSQL" )
-        tQuery += QString().sprintf(", \"%s\" AS \"%s\"", val.toLatin1().data(), p.name().toLatin1().data());
-	  else if ( _internal->_database.driverName() == "QOCI")
-		  tQuery += QString().sprintf(", '%s' AS \"%s\"", val.toLatin1().data(), p.name().toLatin1().data());
-      else
-        tQuery += QString().sprintf(", text('%s') AS \"%s\"", val.toLatin1().data(), p.name().toLatin1().data());
-    }
-  }
-  if(_internal->_database.driverName() == "QOCI")
-	tQuery.push_back(" from dual");
-
-  _internal->_lstQueries.append(new orQuery("Parameter Query", tQuery, ParameterList(), true, _internal->_database));
-  
-  QuerySource * qs = 0;
-  for(unsigned int i = 0; i < _internal->_reportData->queries.size(); i++) {
-      qs = _internal->_reportData->queries.get(i);
-      _internal->_lstQueries.append(new orQuery(qs->name(), qs->query(_internal->_database), _internal->_lstParameters, true, _internal->_database));
-  }
+  if(_internal->_burst && _internal->_burstPart >= 0)
+    _internal->createBurstQueries(_internal->_burstPart);
+  else
+    _internal->createQueries();
 
   _internal->_subtotPageCheckPoints.clear();
+  _internal->_subtotGroupCheckPoints.clear();
   for(int i = 0; i < _internal->_reportData->trackTotal.count(); i++)
   {
     _internal->_subtotPageCheckPoints.insert(_internal->_reportData->trackTotal[i], 0);
@@ -1596,13 +1683,23 @@ bool ORPreRender::setDom(const QDomDocument & docReport)
 {
   if(_internal != 0)
   {
-    if(_internal->_reportData != 0)
-      delete _internal->_reportData;
+    // only the parsed definition is kept, not the document
+    return setDefinition(ORReportDefinition::parse(docReport, database()));
+  }
+  return isValid();
+}
+
+bool ORPreRender::setDefinition(ORReportDefinitionPtr definition)
+{
+  if(_internal != 0)
+  {
     _internal->_valid = false;
+    _internal->_burst.clear();
+    _internal->_subtotGroupCheckPoints.clear();
 
-    _internal->_docReport = docReport;
-    _internal->_reportData = new ORReportData();
-    if(parseReport(_internal->_docReport.documentElement(),*(_internal->_reportData), database()))
+    _internal->_definition = definition;
+    _internal->_reportData = (definition ? definition->data() : 0);
+    if(definition && definition->isValid())
     {
       _internal->_valid = true;
 
@@ -1658,12 +1755,7 @@ bool ORPreRender::setDom(const QDomDocument & docReport)
       {
         if(_internal->_reportData->bgData.staticImage)
         {
-          if(!_internal->_reportData->bgData.image.isEmpty())
-          {
-            QByteArray imgdata = QUUDecode(_internal->_reportData->bgData.image);
-            QImage img = QImage::fromData(imgdata);
-            _internal->_bgImage = img;
-          }
+          _internal->_bgImage = definition->backgroundImage();
         }
         else
         {
@@ -1689,6 +1781,7 @@ void ORPreRender::setParamList(const ParameterList & pParams)
 {
   if(_internal != 0) {
     _internal->_lstParameters = pParams;
+    _internal->_burst.clear();
   }
 }
 
@@ -1833,3 +1926,107 @@ void ORPreRender::setBackgroundScaleMode(Qt::AspectRatioMode mode)
     _internal->_bgScaleMode = mode;
 }
 
+bool ORPreRender::spatialIndex() const
+{
+  return ( _internal != 0 ? _internal->_spatialIndex : false );
+}
+
+void ORPreRender::setSpatialIndex(bool b)
+{
+  if(_internal != 0)
+    _internal->_spatialIndex = b;
+}
+
+bool ORPreRender::burst()
+{
+  if (_internal == 0 || !_internal->_valid || _internal->_reportData == 0)
+    return false;
+
+  _internal->_burst.clear();
+
+  // split on the outermost group of the first detail section that has one
+  ORDetailSectionData * detailData = 0;
+  for(int i = 0; i < _internal->_reportData->sections.count() && detailData == 0; i++)
+  {
+    ORDetailSectionData * section = _internal->_reportData->sections.at(i);
+    if(section && section->detail && !section->groupList.isEmpty() && !section->groupList.first()->column.isEmpty())
+      detailData = section;
+  }
+  if(detailData == 0)
+  {
+    qWarning() << "No detail section with a group to burst on in" << _internal->_reportData->name;
+    return false;
+  }
+
+  QSharedPointer<ORBurstData> burst(new ORBurstData());
+  burst->query = detailData->key.query;
+  burst->column = detailData->groupList.first()->column;
+
+  while(!_internal->_lstQueries.isEmpty())
+    delete _internal->_lstQueries.takeFirst();
+  _internal->createQueries();
+
+  int detailRows = -1;
+  for(int i = 0; i < _internal->_lstQueries.size(); i++)
+  {
+    orQuery * q = _internal->_lstQueries.at(i);
+    burst->queries.append(qMakePair(q->getName(), orQueryRows(q->getQuery())));
+    if(q->getName() == burst->query)
+      detailRows = i;
+  }
+
+  while(!_internal->_lstQueries.isEmpty())
+    delete _internal->_lstQueries.takeFirst();
+
+  if(detailRows == -1)
+  {
+    qWarning() << "No Query Source with name" << burst->query << "in" << _internal->_reportData->name;
+    return false;
+  }
+
+  // a new part starts wherever the group would print a new header
+  const orQueryRows & rows = burst->queries.at(detailRows).second;
+  for(int r = 0; r < rows.count(); r++)
+  {
+    QString key = rows.value(r, burst->column).toString();
+    if(r == 0 || key != burst->keys.last())
+    {
+      burst->firsts.append(r);
+      burst->keys.append(key);
+    }
+  }
+
+  _internal->_burst = burst;
+  return true;
+}
+
+int ORPreRender::burstCount() const
+{
+  if(_internal == 0 || !_internal->_burst)
+    return 0;
+  return _internal->_burst->keys.size();
+}
+
+QString ORPreRender::burstKey(int part) const
+{
+  if(part < 0 || part >= burstCount())
+    return QString::null;
+  return _internal->_burst->keys.at(part);
+}
+
+void ORPreRender::shareBurst(const ORPreRender & other)
+{
+  if(_internal != 0 && other._internal != 0)
+    _internal->_burst = other._internal->_burst;
+}
+
+ORODocument* ORPreRender::generate(int part)
+{
+  if(part < 0 || part >= burstCount())
+    return 0;
+
+  _internal->_burstPart = part;
+  ORODocument * doc = generate();
+  _internal->_burstPart = -1;
+  return doc;
+}
@@ -25,8 +25,10 @@
 #include <QRectF>
 #include <QString>
 #include <QFont>
+#include <QSharedPointer>
 
 class ORPreRenderPrivate;
+class ORReportDefinition;
 class ParameterList;
 class ORODocument;
 
@@ -35,6 +37,13 @@ class ORODocument;
 // This class takes a report definition and prerenders the result to
 // an ORODocument that can be used to pass to any number of renderers.
 //
+// ORPreRender is reentrant: separate instances may generate() at the same
+// time on separate threads, as long as each one is given a connection
+// opened by its own thread (QSqlDatabase connections are not shared across
+// threads). The ORODocument it returns may then be rendered from any one
+// thread, and its pages from several (see ORPrintRender::renderPage()).
+// A single instance must not be used from two threads at once.
+//
 class ORPreRender {
   public:
 
@@ -49,6 +58,9 @@ class ORPreRender {
     QSqlDatabase database() const;
 
     bool setDom(const QDomDocument &);
+    // an already parsed definition, see ORReportCache and ORCompiledReport::load();
+    // it is shared, not copied
+    bool setDefinition(QSharedPointer<ORReportDefinition>);
     void setParamList(const ParameterList &);
     ParameterList paramList() const;
 
@@ -78,6 +90,23 @@ class ORPreRender {
     bool backgroundScale() const;
     Qt::AspectRatioMode backgroundScaleMode() const;
 
+    // index the primitives of each page as it is finished, for partial
+    // repaints and hit-testing : default false
+    void setSpatialIndex(bool);
+    bool spatialIndex() const;
+
+    // Burst mode: burst() runs the queries once and splits the rows of the
+    // detail query on the column of its outermost group. generate(int) then
+    // lays out one part as a document of its own, with its own page numbers,
+    // without going back to the database for the data. Another instance
+    // given the same definition and parameters can take the parts over with
+    // shareBurst() and lay some of them out on another thread.
+    // A new definition or parameter list forgets the parts.
+    bool burst();
+    int burstCount() const;
+    QString burstKey(int) const;
+    void shareBurst(const ORPreRender &);
+    ORODocument * generate(int);
 
   protected:
 
@@ -19,6 +19,7 @@
  */
 
 #include "orprintrender.h"
+#include "orpdfexport.h"
 #include "renderobjects.h"
 #include "pagesizeinfo.h"
 #include "barcodes.h"
@@ -26,10 +27,43 @@
 #include <QTextDocument>
 #include <QTextCursor>
 #include <QPaintEngine>
+#include <QPicture>
 
 static void renderBackground(QImage &, const QImage &, const QRect &, bool, Qt::AspectRatioMode, int, unsigned int);
 static void renderWatermark(QImage &, const QString &, const QFont &, const unsigned int, double, double, double, double);
 
+//
+// ORPagePicture
+// A QPicture that reports the resolution of the device the page will be
+// replayed on, so fonts are resolved and text laid out while recording
+// exactly as renderPage() would do it on that device.
+//
+class ORPagePicture : public QPicture
+{
+  public:
+    ORPagePicture(int xDpi, int yDpi) : _xDpi(xDpi), _yDpi(yDpi) {}
+
+  protected:
+    virtual int metric(PaintDeviceMetric m) const
+    {
+      switch(m)
+      {
+        case PdmDpiX:
+        case PdmPhysicalDpiX:
+          return _xDpi;
+        case PdmDpiY:
+        case PdmPhysicalDpiY:
+          return _yDpi;
+        default:
+          return QPicture::metric(m);
+      }
+    }
+
+  private:
+    int _xDpi;
+    int _yDpi;
+};
+
 ORPrintRender::ORPrintRender()
 {
   _printer = 0;
@@ -123,6 +157,10 @@ bool ORPrintRender::render(ORODocument * pDocument)
   if(toPage == 0 || toPage > pDocument->pages())
     toPage = pDocument->pages();
 
+  // a single copy has nothing to replay
+  bool replay = (_printer->numCopies() > 1);
+  QSize margins(_printer->paperRect().left() - _printer->pageRect().left(), _printer->paperRect().top() - _printer->pageRect().top());
+
   for(int copy = 0; copy < _printer->numCopies(); copy++)
   {
     for(int page = fromPage; page < toPage; page++)
@@ -134,11 +172,21 @@ bool ORPrintRender::render(ORODocument * pDocument)
       if(_printer->pageOrder() == QPrinter::LastPageFirst)
         pageToPrint = toPage - 1 - page;
 
-      QSize margins(_printer->paperRect().left() - _printer->pageRect().left(), _printer->paperRect().top() - _printer->pageRect().top());
-      renderPage(pDocument, pageToPrint, _painter, xDpi, yDpi, margins, _printer->resolution());
+      if(replay)
+        replayPage(pDocument, pageToPrint, _painter, xDpi, yDpi, margins, _printer->resolution());
+      else
+        renderPage(pDocument, pageToPrint, _painter, xDpi, yDpi, margins, _printer->resolution());
     }
   }
 
+  // the recordings for this printer are of no use to anything else
+  if(replay)
+  {
+    QString key = displayListKey(xDpi, yDpi, margins, _printer->resolution());
+    for(int page = fromPage; page < toPage; page++)
+      pDocument->page(page)->removeDisplayList(key);
+  }
+
   if(endWhenComplete)
     _painter->end();
 
@@ -148,6 +196,52 @@ bool ORPrintRender::render(ORODocument * pDocument)
   return true;
 }
 
+QString ORPrintRender::displayListKey(qreal xDpi, qreal yDpi, QSize margins, int printResolution)
+{
+  return QString("%1:%2:%3:%4:%5").arg(xDpi).arg(yDpi).arg(printResolution).arg(margins.width()).arg(margins.height());
+}
+
+void ORPrintRender::replayPage(ORODocument * pDocument, int pageNb, QPainter *painter, qreal xDpi, qreal yDpi, QSize margins, int printResolution)
+{
+  // Label printer commands are generated from the primitives themselves and
+  // would be lost in a recording, and so would the link annotations of a
+  // PDF file. A printer driven through the PDF engine, as on Linux, has no
+  // use for links and replays like any other.
+  QPaintEngine::Type type = painter->paintEngine()->type();
+  QPrinter * printer = dynamic_cast<QPrinter*>(painter->device());
+  bool pdfFile = (type == QPaintEngine::Pdf &&
+                  (printer == 0 || !printer->outputFileName().isEmpty()));
+  if(type == QPaintEngine::User || pdfFile)
+  {
+    renderPage(pDocument, pageNb, painter, xDpi, yDpi, margins, printResolution);
+    return;
+  }
+
+  OROPage * p = pDocument->page(pageNb);
+  if(p == 0)
+    return;
+
+  QString key = displayListKey(xDpi, yDpi, margins, printResolution);
+  QPicture picture = p->displayList(key);
+  if(picture.isNull())
+  {
+    ORPagePicture recording(qRound(xDpi), qRound(yDpi));
+    QPainter recorder;
+    if(!recorder.begin(&recording))
+    {
+      renderPage(pDocument, pageNb, painter, xDpi, yDpi, margins, printResolution);
+      return;
+    }
+    renderPage(pDocument, pageNb, &recorder, xDpi, yDpi, margins, printResolution);
+    recorder.end();
+
+    picture = recording;
+    p->setDisplayList(key, picture);
+  }
+
+  painter->drawPicture(0, 0, picture);
+}
+
 void renderBackground(QImage & dest, const QImage & bgImage, const QRect & bgRect, bool bgScale, Qt::AspectRatioMode bgScaleMode, int bgAlign, unsigned int bgOpacity)
 {
   QImage img = bgImage;
@@ -268,10 +362,17 @@ void renderWatermark(QImage & image, const QString & wmText, const QFont & wmFon
   }
 }
 
-void ORPrintRender::renderPage(ORODocument * pDocument, int pageNb, QPainter *painter, qreal xDpi, qreal yDpi, QSize margins, int printResolution)
+void ORPrintRender::renderPage(ORODocument * pDocument, int pageNb, QPainter *painter, qreal xDpi, qreal yDpi, QSize margins, int printResolution, const QRectF & exposed)
 {
   OROPage * p = pDocument->page(pageNb);
 
+  bool partial = exposed.isValid();
+  if(partial)
+  {
+    painter->save();
+    painter->setClipRect(QRectF(exposed.x() * xDpi, exposed.y() * yDpi, exposed.width() * xDpi, exposed.height() * yDpi), Qt::IntersectClip);
+  }
+
   if(((!p->backgroundImage().isNull()) && (p->backgroundOpacity() != 0)) ||
      ((!p->watermarkText().isEmpty()) && (p->watermarkOpacity() != 0)))
   {
@@ -349,10 +450,14 @@ void ORPrintRender::renderPage(ORODocument * pDocument, int pageNb, QPainter *pa
     }
   }
 
-  // Render Page Objects
-  for(int i = 0; i < p->primitives(); i++)
+  // Render Page Objects, only the ones in the exposed area if there is one
+  QList<OROPrimitive*> exposedPrims;
+  if(partial)
+    exposedPrims = p->primitivesIn(exposed);
+  int count = (partial ? exposedPrims.count() : p->primitives());
+  for(int i = 0; i < count; i++)
   {
-    OROPrimitive * prim = p->primitive(i);
+    OROPrimitive * prim = (partial ? exposedPrims.at(i) : p->primitive(i));
 
     QPen pen(prim->pen());
     painter->save();
@@ -497,6 +602,50 @@ void ORPrintRender::renderPage(ORODocument * pDocument, int pageNb, QPainter *pa
     painter->restore();
 
   }
+
+  if(partial)
+    painter->restore();
+}
+
+QSizeF ORPrintRender::paperSize(ORODocument * pDocument)
+{
+  ReportPageOptions opts = pDocument->pageOptions();
+  QSizeF size(opts.getCustomWidth(), opts.getCustomHeight());
+  if(opts.getPageSize() != "Custom")
+  {
+    PageSizeInfo psi = PageSizeInfo::getByName(opts.getPageSize());
+    if(!psi.isNull())
+      size = QSizeF(psi.width() / 100.0, psi.height() / 100.0);
+  }
+  if(size.width() <= 0 || size.height() <= 0)
+    size = QSizeF(8.5, 11.0);
+  if(!opts.isPortrait())
+    size.transpose();
+  return size;
+}
+
+// Draws a page on a white QImage. Only QImage and QPainter are involved so
+// this may be called from any thread, several pages at a time.
+QImage ORPrintRender::renderPageToImage(ORODocument * pDocument, int pageNb, int dpi)
+{
+  if(pDocument == 0 || pageNb < 0 || pageNb >= pDocument->pages() || dpi <= 0)
+    return QImage();
+
+  QSizeF size = paperSize(pDocument);
+  QImage image(qRound(size.width() * dpi), qRound(size.height() * dpi), QImage::Format_RGB32);
+  if(image.isNull())
+    return image;
+  image.setDotsPerMeterX(qRound(dpi / 0.0254));
+  image.setDotsPerMeterY(qRound(dpi / 0.0254));
+  image.fill(Qt::white);
+
+  QPainter painter;
+  if(painter.begin(&image))
+  {
+    renderPage(pDocument, pageNb, &painter, dpi, dpi, QSize(0, 0), dpi);
+    painter.end();
+  }
+  return image;
 }
 
 bool ORPrintRender::exportToPDF(ORODocument * pDocument, QString pdfFileName)
@@ -519,3 +668,13 @@ bool ORPrintRender::exportToPDF(ORODocument * pDocument, QString pdfFileName)
   return render.render(pDocument, &printer);
 }
 
+bool ORPrintRender::exportToPDF(ORODocument * pDocument, QString pdfFileName, int threadCount)
+{
+  if(!pDocument)
+    return false;
+
+  ORPdfExport exporter(pDocument);
+  exporter.setThreadCount(threadCount);
+  exporter.setResolution(300);
+  return exporter.exportToFile(pdfFileName);
+}
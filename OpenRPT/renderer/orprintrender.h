@@ -42,10 +42,20 @@ class ORPrintRender
     bool render(ORODocument *, ReportPrinter *);
     bool render(ORODocument *);
 
-    static void renderPage(ORODocument * pDocument, int pageNb, QPainter *painter, qreal xDpi, qreal yDpi, QSize margins, int printResolution);
+    // exposed, in inches, limits the painting to that part of the page
+    static void renderPage(ORODocument * pDocument, int pageNb, QPainter *painter, qreal xDpi, qreal yDpi, QSize margins, int printResolution, const QRectF & exposed = QRectF());
+    // same as renderPage() but the page is recorded the first time and the
+    // recording replayed afterwards, for copies, reprints and the preview
+    static void replayPage(ORODocument * pDocument, int pageNb, QPainter *painter, qreal xDpi, qreal yDpi, QSize margins, int printResolution);
+    static QImage renderPageToImage(ORODocument * pDocument, int pageNb, int dpi);
+    static QSizeF paperSize(ORODocument * pDocument); // in inches, already oriented
     static bool exportToPDF(ORODocument * pDocument, QString pdfFileName);
+    static bool exportToPDF(ORODocument * pDocument, QString pdfFileName, int threadCount); // through ORPdfExport, 0 : one thread per core
 
   protected:
+    // what a recording of a page is kept under for the given output
+    static QString displayListKey(qreal xDpi, qreal yDpi, QSize margins, int printResolution);
+
     QPrinter* _printer;
     QPainter* _painter;
 };
@@ -0,0 +1,258 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     This file contains the parsed form of a report definition and the
+ * process wide cache of the definitions read from the report table. Most
+ * applications run the same few reports over and over; with the cache each
+ * run only asks the database whether the stored source changed since it was
+ * parsed.
+ */
+
+#include "orreportcache.h"
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QCryptographicHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QXmlStreamReader>
+
+#include <xsqlquery.h>
+#include <parsexmlutils.h>
+#include <quuencode.h>
+#include <builtinSqlFunctions.h>
+
+//
+// ORReportDefinition
+//
+ORReportDefinition::ORReportDefinition()
+  : _valid(false), _cacheable(true), _data(0)
+{
+}
+
+ORReportDefinition::~ORReportDefinition()
+{
+  if(_data != 0)
+  {
+    delete _data;
+    _data = 0;
+  }
+}
+
+QSharedPointer<ORReportDefinition> ORReportDefinition::parse(const QDomDocument & docReport, QSqlDatabase db)
+{
+  QSharedPointer<ORReportDefinition> def(new ORReportDefinition());
+  def->_data = new ORReportData();
+  def->_cacheable = docReport.documentElement().firstChildElement("database").isNull();
+  if(!parseReport(docReport.documentElement(), *(def->_data), db))
+    return def;
+
+  def->prepare(db);
+  return def;
+}
+
+QSharedPointer<ORReportDefinition> ORReportDefinition::parse(const QString & source, QSqlDatabase db)
+{
+  QSharedPointer<ORReportDefinition> def(new ORReportDefinition());
+  def->_data = new ORReportData();
+
+  QXmlStreamReader xml(source);
+  bool loadedData = false;
+  bool parsed = parseReport(xml, *(def->_data), db, &loadedData);
+  def->_cacheable = !loadedData;
+  if(parsed)
+    def->prepare(db);
+  return def;
+}
+
+void ORReportDefinition::prepare(QSqlDatabase db)
+{
+  _valid = true;
+
+  const ORBackgroundData & bgData = _data->bgData;
+  if(bgData.enabled && bgData.staticImage && !bgData.image.isEmpty())
+    _bgImage = QImage::fromData(QUUDecode(bgData.image));
+
+  if(_data->page.getPageSize() == "Labels")
+    _label = LabelSizeInfo::getByName(_data->page.getLabelType(), db);
+
+  // inline data that does not decode is a file name, read on each run
+  QList<ORSectionData*> sections = allSections(*_data);
+  for(int i = 0; i < sections.count(); i++)
+  {
+    QList<ORObject*> & objects = sections.at(i)->objects;
+    for(int o = 0; o < objects.count(); o++)
+    {
+      if(!objects.at(o)->isImage())
+        continue;
+      ORImageData * im = objects.at(o)->toImage();
+      if(im->inline_data.isNull())
+        continue;
+      QImage img = QImage::fromData(QUUDecode(im->inline_data));
+      if(!img.isNull())
+        _images.insert(im, img);
+    }
+  }
+}
+
+QList<ORSectionData*> ORReportDefinition::allSections(const ORReportData & data)
+{
+  QList<ORSectionData*> list;
+  list << data.pghead_first << data.pghead_odd << data.pghead_even
+       << data.pghead_last << data.pghead_any
+       << data.rpthead << data.rptfoot
+       << data.pgfoot_first << data.pgfoot_odd << data.pgfoot_even
+       << data.pgfoot_last << data.pgfoot_any;
+  for(int i = 0; i < data.sections.count(); i++)
+  {
+    ORDetailSectionData * dsd = data.sections.at(i);
+    list << dsd->detail;
+    for(int g = 0; g < dsd->groupList.count(); g++)
+      list << dsd->groupList.at(g)->head << dsd->groupList.at(g)->foot;
+  }
+  list.removeAll(0);
+  return list;
+}
+
+//
+// ORReportCache
+//
+class ORReportCacheEntry
+{
+  public:
+    int grade;
+    QByteArray checksum;
+    ORReportDefinitionPtr definition;
+};
+
+typedef QCache<QString, ORReportCacheEntry> ORReportDefinitionCache;
+
+Q_GLOBAL_STATIC_WITH_ARGS(ORReportDefinitionCache, reportCache, (200))
+Q_GLOBAL_STATIC(QMutex, reportCacheLock)
+static QAtomicInt reportCacheEnabled(1);
+
+// the same name may be a different report on another database
+static QString reportCacheKey(const QSqlDatabase & db, const QString & name)
+{
+  return QString("%1://%2@%3:%4/%5").arg(db.driverName()).arg(db.userName())
+           .arg(db.hostName()).arg(db.port()).arg(db.databaseName())
+         + QChar(0) + name;
+}
+
+static ORReportDefinitionPtr cachedDefinition(const QString & key, int grade, const QByteArray & checksum)
+{
+  QMutexLocker locker(reportCacheLock());
+  ORReportCacheEntry * entry = reportCache()->object(key);
+  if(entry != 0 && entry->grade == grade && entry->checksum == checksum)
+    return entry->definition;
+  return ORReportDefinitionPtr();
+}
+
+ORReportDefinitionPtr ORReportCache::definition(const QString & name, QSqlDatabase db, bool * exists)
+{
+  if(exists)
+    *exists = false;
+  if(!db.isValid())
+    db = QSqlDatabase::database();
+
+  bool enabled = (reportCacheEnabled.load() != 0);
+  QString key = reportCacheKey(db, name);
+  int grade = 0;
+  QByteArray checksum;
+
+  // PostgreSQL can tell whether the source changed without sending it over
+  bool checked = false;
+  if(enabled && db.driverName() == "QPSQL")
+  {
+    XSqlQuery check(db);
+    check.prepare(getSqlFromTag("fmt20", db.driverName()));
+    check.bindValue(":report_name", name);
+    if(check.exec())
+    {
+      if(!check.first())
+        return ORReportDefinitionPtr();
+      checked = true;
+      if(exists)
+        *exists = true;
+      grade = check.value("report_grade").toInt();
+      checksum = check.value("report_checksum").toString().toLatin1();
+      ORReportDefinitionPtr def = cachedDefinition(key, grade, checksum);
+      if(def)
+        return def;
+    }
+  }
+
+  XSqlQuery report(db);
+  report.prepare(getSqlFromTag("fmt04", db.driverName()));
+  report.bindValue(":report_name", name);
+  report.exec();
+  if(!report.first())
+    return ORReportDefinitionPtr();
+  if(exists)
+    *exists = true;
+
+  QString source = report.value("report_source").toString();
+  if(!checked)
+  {
+    // the source still has to come over, but not to be parsed again
+    grade = report.value("report_grade").toInt();
+    checksum = QCryptographicHash::hash(source.toUtf8(), QCryptographicHash::Md5).toHex();
+    if(enabled)
+    {
+      ORReportDefinitionPtr def = cachedDefinition(key, grade, checksum);
+      if(def)
+        return def;
+    }
+  }
+
+  ORReportDefinitionPtr def = ORReportDefinition::parse(source, db);
+  if(!def->isValid())
+    return ORReportDefinitionPtr();
+  if(enabled && def->isCacheable())
+  {
+    ORReportCacheEntry * entry = new ORReportCacheEntry();
+    entry->grade = grade;
+    entry->checksum = checksum;
+    entry->definition = def;
+
+    QMutexLocker locker(reportCacheLock());
+    reportCache()->insert(key, entry);
+  }
+  return def;
+}
+
+void ORReportCache::clear()
+{
+  QMutexLocker locker(reportCacheLock());
+  reportCache()->clear();
+}
+
+bool ORReportCache::isEnabled()
+{
+  return reportCacheEnabled.load() != 0;
+}
+
+void ORReportCache::setEnabled(bool enabled)
+{
+  reportCacheEnabled.store(enabled ? 1 : 0);
+  if(!enabled)
+    clear();
+}
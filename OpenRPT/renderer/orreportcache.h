@@ -0,0 +1,107 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+#ifndef __ORREPORTCACHE_H__
+#define __ORREPORTCACHE_H__
+
+#include <QDomDocument>
+#include <QHash>
+#include <QImage>
+#include <QSharedPointer>
+#include <QSqlDatabase>
+#include <QString>
+
+#include <labelsizeinfo.h>
+
+class ORReportData;
+class ORImageData;
+class ORSectionData;
+
+//
+// ORReportDefinition
+// A parsed report definition, along with what can be worked out from it
+// before any run: the static background and inline images decoded and, for
+// labels, the label size. Nothing in it changes once it is made, so any number of ORPreRender
+// instances, on any threads, can lay out reports from the same one.
+//
+class ORReportDefinition
+{
+  public:
+    virtual ~ORReportDefinition();
+
+    // the database is the one <database> elements are loaded into and
+    // label sizes are looked up in
+    static QSharedPointer<ORReportDefinition> parse(const QDomDocument &, QSqlDatabase = QSqlDatabase());
+    // straight from the source text, without building a QDomDocument
+    static QSharedPointer<ORReportDefinition> parse(const QString & source, QSqlDatabase = QSqlDatabase());
+
+    bool isValid() const { return _valid; }
+    ORReportData * data() const { return _data; }
+    const QImage & backgroundImage() const { return _bgImage; }
+    // the decoded inline image of an image object, null if it has none
+    QImage image(const ORImageData * im) const { return _images.value(im); }
+    const LabelSizeInfo & label() const { return _label; }
+
+    // false when parsing it also loaded data into the database, which a
+    // parsed copy would skip
+    bool isCacheable() const { return _cacheable; }
+
+  protected:
+    ORReportDefinition();
+
+    void prepare(QSqlDatabase);
+    static QList<ORSectionData*> allSections(const ORReportData &);
+
+    bool _valid;
+    bool _cacheable;
+    ORReportData * _data;
+    QImage _bgImage;
+    QHash<const ORImageData*, QImage> _images;
+    LabelSizeInfo _label;
+
+  private:
+    friend class ORCompiledReport;
+    Q_DISABLE_COPY(ORReportDefinition)
+};
+
+typedef QSharedPointer<ORReportDefinition> ORReportDefinitionPtr;
+
+//
+// ORReportCache
+// The definitions of the reports stored in the report table, parsed once per
+// process. A definition is kept for the name and grade it was read for, on
+// that database, until the source stored in the table changes; checking it
+// costs one small query instead of fetching and parsing the whole source.
+// All the functions are thread safe.
+//
+class ORReportCache
+{
+  public:
+    // the newest grade of the named report, or a null pointer when there is
+    // no report by that name or its source is not well formed; exists tells
+    // the two apart
+    static ORReportDefinitionPtr definition(const QString & name, QSqlDatabase db = QSqlDatabase(), bool * exists = 0);
+
+    static void clear();
+
+    static bool isEnabled();
+    static void setEnabled(bool); // default true; false parses on every call
+};
+
+#endif // __ORREPORTCACHE_H__
@@ -22,6 +22,113 @@
 
 #include "../../MetaSQL/metasql.h"
 
+#include <xsqlquerycache.h>
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSqlDriver>
+#include <QSqlResult>
+
+//
+// orQueryText
+// The SQL text of a query split once at its %n and $"name" placeholders,
+// kept for the text so running the same report again does not scan it. The
+// literals are the text around the placeholders, one more than there are.
+//
+class orQueryPlaceholder
+{
+  public:
+    bool    named;
+    int     number;
+    QString name;
+    bool    quoted; // inside a '...' string
+};
+
+class orQueryText
+{
+  public:
+    orQueryText(const QString &);
+
+    bool metaSql;
+    QStringList literals;
+    QVector<orQueryPlaceholder> placeholders;
+};
+
+orQueryText::orQueryText(const QString & sql)
+{
+  // MetaSQL does its own substitutions
+  int open = sql.indexOf("<?");
+  metaSql = (open != -1 && sql.indexOf("?>", open + 2) != -1);
+  if(metaSql)
+    return;
+
+  const QChar * s = sql.constData();
+  int length = sql.length();
+  int literal = 0;
+  bool quoted = false;
+  for(int i = 0; i < length; i++)
+  {
+    if(s[i] == '\'')
+      quoted = !quoted;
+    else if(s[i] == '%' && i + 1 < length && s[i + 1].isDigit())
+    {
+      int end = i + 1;
+      while(end < length && s[end].isDigit())
+        end++;
+
+      orQueryPlaceholder p;
+      p.named = false;
+      p.number = sql.mid(i + 1, end - i - 1).toInt();
+      p.quoted = quoted;
+      literals.append(sql.mid(literal, i - literal));
+      placeholders.append(p);
+      literal = end;
+      i = end - 1;
+    }
+    else if(s[i] == '$' && i + 1 < length && s[i + 1] == '"')
+    {
+      int end = sql.indexOf('"', i + 2);
+      if(end == -1)
+        continue;
+
+      orQueryPlaceholder p;
+      p.named = true;
+      p.number = 0;
+      p.name = sql.mid(i + 2, end - i - 2).toLower();
+      p.quoted = quoted;
+      literals.append(sql.mid(literal, i - literal));
+      placeholders.append(p);
+      literal = end + 1;
+      i = end;
+    }
+  }
+  literals.append(sql.mid(literal));
+}
+
+typedef QSharedPointer<const orQueryText> orQueryTextPtr;
+typedef QCache<QString, orQueryTextPtr> orQueryTextCache;
+
+Q_GLOBAL_STATIC_WITH_ARGS(orQueryTextCache, queryTextCache, (200))
+Q_GLOBAL_STATIC(QMutex, queryTextCacheLock)
+static QAtomicInt queryBindValues(0);
+
+static orQueryTextPtr queryText(const QString & sql)
+{
+  {
+    QMutexLocker locker(queryTextCacheLock());
+    orQueryTextPtr * cached = queryTextCache()->object(sql);
+    if(cached)
+      return *cached;
+  }
+
+  orQueryTextPtr text(new orQueryText(sql));
+  QMutexLocker locker(queryTextCacheLock());
+  queryTextCache()->insert(sql, new orQueryTextPtr(text));
+  return text;
+}
+
 //
 // Class orQuery implementations
 //
@@ -33,76 +140,74 @@ orQuery::orQuery()
 orQuery::orQuery( const QString &qstrPName, const QString &qstrSQL,
                   ParameterList qstrlstParams, bool doexec, QSqlDatabase pDb )
 {
-  QString qstrParsedSQL(qstrSQL);
-  QString qstrParam;
-  int     intParamNum;
-  int     intStartIndex = 0;
-
   qryQuery = 0;
   _database = pDb;
 
   //  Initialize some privates
   qstrName  = qstrPName;
 
-  QRegExp rexp("<\\?.*\\?>");
-  if(rexp.indexIn(qstrParsedSQL) == -1)
+  orQueryTextPtr text = queryText(qstrSQL);
+  if(!text->metaSql)
   {
-    // Parse through the passed SQL populating the parameters
-    QRegExp re("(?:%(\\d+))|(?:\\$\"([^\"]*)\")");
-    while ((intStartIndex = re.indexIn(qstrParsedSQL,intStartIndex)) != -1)
+    // Find the values of the placeholders, then write the text in one go
+    bool bind = bindValues();
+    QVector<QString> values(text->placeholders.size());
+    int length = 0;
+    for(int i = 0; i < text->placeholders.size(); i++)
     {
+      const orQueryPlaceholder & p = text->placeholders.at(i);
+      QVariant v;
       QString val = " ";
-
-      QString match = re.cap(0);
-      if(match[0] == '$')
+      if(p.named)
       {
-        QString n = re.cap(2).toLower();
-        val = qstrlstParams.value(n).toString();
+        v = qstrlstParams.value(p.name);
+        val = v.toString();
         if(val.isNull())
         {
           // add this to the list of missing parameters
-          if(!missingParamList.contains(n))
-            missingParamList.append(n);
+          if(!missingParamList.contains(p.name))
+            missingParamList.append(p.name);
         }
       }
-      else if(match[0] == '%')
+      //  Verify the parameter index
+      else if (p.number <= (int)qstrlstParams.count())
       {
-        //  Grab the parameter number
-        intParamNum = re.cap(1).toInt();
-
-        //  Replace the parameter hold with the specified paramemter
-        //  Verify the parameter index
-        if (intParamNum <= (int)qstrlstParams.count())
-          val = qstrlstParams.value(intParamNum - 1).toString();
-        else
-        {
-          // add this to the list of missing parameters
-          QString s = QString("%%1").arg(intParamNum);
-          if(!missingParamList.contains(s)) missingParamList.append(s);
-        }
+        v = qstrlstParams.value(p.number - 1);
+        val = v.toString();
       }
       else
       {
-        // ?!?!? How did we get here.
-        qDebug("Match did not start with $ or %%...");
+        // add this to the list of missing parameters
+        QString s = QString("%%1").arg(p.number);
+        if(!missingParamList.contains(s)) missingParamList.append(s);
       }
 
-      QString qstrWork = qstrParsedSQL.left(intStartIndex)
-                       + val
-                       + qstrParsedSQL.right(qstrParsedSQL.length() - intStartIndex - re.matchedLength());
-      intStartIndex += val.length();
-      qstrParsedSQL = qstrWork;
+      // a value inside a string can only be spliced in
+      if(bind && !p.quoted)
+      {
+        val = QString(":_%1_").arg(_bindValues.count() + 1);
+        _bindValues.append(val, v);
+      }
+      values[i] = val;
+      length += val.length() + text->literals.at(i).length();
     }
+    length += text->literals.last().length();
 
-    qstrQuery = qstrParsedSQL;
+    qstrQuery.reserve(length);
+    for(int i = 0; i < values.size(); i++)
+    {
+      qstrQuery += text->literals.at(i);
+      qstrQuery += values.at(i);
+    }
+    qstrQuery += text->literals.last();
 
     if(doexec)
       execute();
   }
   else
   {
-    qstrQuery = qstrParsedSQL;
-    MetaSQLQuery mql(qstrParsedSQL);
+    qstrQuery = qstrSQL;
+    MetaSQLQuery mql(qstrSQL);
     qryQuery = new XSqlQuery(mql.toQuery(qstrlstParams, _database, doexec));
     if (doexec)
       qryQuery->first();
@@ -119,16 +224,148 @@ orQuery::~orQuery()
   }
 }
 
+orQuery::orQuery(const QString &qstrPName, XSqlQuery *query)
+{
+  qstrName = qstrPName;
+  qryQuery = query;
+  if(qryQuery != 0)
+    qryQuery->first();
+}
+
 bool orQuery::execute()
 {
   if(qryQuery == 0)
   {
-    qryQuery  = new XSqlQuery(qstrQuery, _database);
+    if(!_bindValues.isEmpty() || XSqlQueryCache::isEnabled())
+    {
+      // the same text again runs the statement the server already planned
+      qryQuery = new XSqlQuery(XSqlQueryCache::prepare(qstrQuery, _database));
+      for(int i = 0; i < _bindValues.count(); i++)
+        qryQuery->bindValue(_bindValues.name(i), _bindValues.value(i));
+      qryQuery->exec();
+    }
+    else
+      qryQuery = new XSqlQuery(qstrQuery, _database);
     return qryQuery->first();
   }
   return false;
 }
 
+bool orQuery::bindValues()
+{
+  return queryBindValues.load() != 0;
+}
+
+void orQuery::setBindValues(bool bind)
+{
+  queryBindValues.store(bind ? 1 : 0);
+}
+
+//
+// orMemoryDriver and orMemoryResult
+// The smallest driver and result QSqlQuery needs to walk rows that are
+// already in memory.
+//
+class orMemoryDriver : public QSqlDriver
+{
+  public:
+    virtual bool hasFeature(DriverFeature f) const { return (f == QuerySize); }
+    virtual bool open(const QString &, const QString &, const QString &, const QString &, int, const QString &) { return false; }
+    virtual void close() {}
+    virtual QSqlResult * createResult() const { return 0; }
+};
+
+Q_GLOBAL_STATIC(orMemoryDriver, memoryDriver)
+
+class orMemoryResult : public QSqlResult
+{
+  public:
+    orMemoryResult(const QSqlRecord & record, QSharedPointer<QVector<QVector<QVariant> > > rows, int first, int count)
+      : QSqlResult(memoryDriver()), _record(record), _rows(rows), _first(first), _count(count)
+    {
+      setSelect(true);
+      setActive(true);
+      setAt(QSql::BeforeFirstRow);
+    }
+
+  protected:
+    virtual QVariant data(int i)
+    {
+      const QVector<QVariant> & row = _rows->at(_first + at());
+      return (i >= 0 && i < row.size()) ? row.at(i) : QVariant();
+    }
+    virtual bool isNull(int i) { return data(i).isNull(); }
+    virtual bool reset(const QString &) { return false; }
+    virtual bool fetch(int i)
+    {
+      if(i < 0 || i >= _count)
+        return false;
+      setAt(i);
+      return true;
+    }
+    virtual bool fetchFirst() { return fetch(0); }
+    virtual bool fetchLast() { return fetch(_count - 1); }
+    virtual int size() { return _count; }
+    virtual int numRowsAffected() { return -1; }
+    virtual QSqlRecord record() const { return _record; }
+
+  private:
+    QSqlRecord _record;
+    QSharedPointer<QVector<QVector<QVariant> > > _rows;
+    int _first;
+    int _count;
+};
+
+//
+// Class orQueryRows implementations
+//
+orQueryRows::orQueryRows()
+  : _rows(new QVector<QVector<QVariant> >())
+{
+}
+
+orQueryRows::orQueryRows(XSqlQuery *query)
+  : _rows(new QVector<QVector<QVariant> >())
+{
+  if(query == 0)
+    return;
+
+  _record = query->record();
+  _record.clearValues();
+  int columns = _record.count();
+  if(query->first())
+  {
+    do
+    {
+      QVector<QVariant> row(columns);
+      for(int i = 0; i < columns; i++)
+        row[i] = query->value(i);
+      _rows->append(row);
+    } while(query->next());
+  }
+}
+
+int orQueryRows::count() const
+{
+  return _rows->size();
+}
+
+QVariant orQueryRows::value(int row, const QString &column) const
+{
+  int i = _record.indexOf(column);
+  if(row < 0 || row >= _rows->size() || i < 0)
+    return QVariant();
+  return _rows->at(row).at(i);
+}
+
+XSqlQuery * orQueryRows::createQuery(int first, int count) const
+{
+  first = qBound(0, first, _rows->size());
+  if(count < 0 || first + count > _rows->size())
+    count = _rows->size() - first;
+  return new XSqlQuery(new orMemoryResult(_record, _rows, first, count));
+}
+
 //
 // Class orData
 //
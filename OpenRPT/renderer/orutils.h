@@ -25,6 +25,9 @@
 #include <QSqlDatabase>
 #include <QSqlRecord>
 #include <QSqlField>
+#include <QSharedPointer>
+#include <QVector>
+#include <QVariant>
 #include <xsqlquery.h>
 #include <parameter.h>
 
@@ -49,10 +52,12 @@ class orQuery {
     XSqlQuery   *qryQuery;
 
     QSqlDatabase _database;
+    ParameterList _bindValues;
 
   public:
     orQuery();
     orQuery(const QString &, const QString &, ParameterList, bool doexec, QSqlDatabase pDb = QSqlDatabase());
+    orQuery(const QString &, XSqlQuery *); // takes an already run query over
 
     virtual ~orQuery();
 
@@ -63,10 +68,37 @@ class orQuery {
     inline const QString &getSql() const { return qstrQuery; }
     inline const QString &getName() const { return qstrName; }
 
+    // whether the values of %n and $"name" outside of '...' strings are
+    // bound as :_1_, :_2_, ... instead of spliced into the text; only for
+    // reports that use them for values, not for names or keywords
+    static bool bindValues();
+    static void setBindValues(bool); // default false
+
     QStringList     missingParamList;
 };
 
 
+// Query Rows Class
+// All the rows of a query read into memory. Copies share the rows, which
+// are never changed once read, so they can be handed to other threads.
+class orQueryRows {
+  public:
+    orQueryRows();
+    orQueryRows(XSqlQuery *); // reads all the rows from the first one on
+
+    int count() const;
+    QVariant value(int row, const QString &) const;
+
+    // a new query with its own cursor over count rows from first on,
+    // -1 for all of them; it needs no database connection
+    XSqlQuery * createQuery(int first = 0, int count = -1) const;
+
+  private:
+    QSqlRecord _record;
+    QSharedPointer<QVector<QVector<QVariant> > > _rows;
+};
+
+
 // Data class
 class orData {
   private:
@@ -16,8 +16,10 @@
 #include <QDialogButtonBox>
 #include <QHBoxLayout>
 #include <QMouseEvent>
+#include <QMutex>
 #include <QPainter>
 #include <QPushButton>
+#include <QRunnable>
 #include <QScrollBar>
 #include <QTextDocument>
 #include <QTextFrame>
@@ -26,6 +28,82 @@
 #include <math.h>
 
 const int spacing = 30;
+const int pageCacheSize = 128 * 1024; // kilobytes of rendered pages kept
+const int tileSize = 512;             // pixels, for pages larger than the view
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Background rendering                                                      //
+///////////////////////////////////////////////////////////////////////////////
+
+// pages the preview still wants, shared with the render tasks
+struct PreviewRenderState
+{
+    QMutex lock;
+    QSet<PreviewPageKey> wanted;
+};
+
+// renders one page, or the tile of it in pixels when tile is valid, into
+// an image on a worker thread. Whole pages are replayed from their
+// recording; a tile only renders the primitives found in its part of the
+// page. A page scrolled out of view before its task starts is skipped and
+// a null image returned.
+class PreviewPageTask : public QRunnable
+{
+public:
+    PreviewPageTask(PreviewWidget *widget, QSharedPointer<PreviewRenderState> state,
+                    ORODocument *doc, const PreviewPageKey &key, double zoom,
+                    const QSize &size, const QRect &tile, qreal xDpi, qreal yDpi, const QSize &margins)
+      : _widget(widget), _state(state), _doc(doc), _key(key), _zoom(zoom),
+        _size(size), _tile(tile), _xDpi(xDpi), _yDpi(yDpi), _margins(margins) {}
+
+    virtual void run()
+    {
+        bool wanted;
+        {
+            QMutexLocker locker(&_state->lock);
+            wanted = _state->wanted.contains(_key);
+        }
+
+        QImage image;
+        if (wanted && !_tile.isValid()) {
+            image = QImage(_size, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            painter.scale(_zoom, _zoom);
+            ORPrintRender::replayPage(_doc, _key.page, &painter, _xDpi, _yDpi, _margins, 100);
+            painter.end();
+        }
+        else if (wanted) {
+            image = QImage(_tile.size(), QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            painter.translate(-_tile.x(), -_tile.y());
+            painter.scale(_zoom, _zoom);
+            // the part of the page under the tile, in inches
+            QRectF exposed(_tile.x() / _zoom / _xDpi, _tile.y() / _zoom / _yDpi,
+                           _tile.width() / _zoom / _xDpi, _tile.height() / _zoom / _yDpi);
+            ORPrintRender::renderPage(_doc, _key.page, &painter, _xDpi, _yDpi, _margins, 100, exposed);
+            painter.end();
+        }
+
+        QMetaObject::invokeMethod(_widget, "pageRendered", Qt::QueuedConnection,
+                                  Q_ARG(int, _key.page), Q_ARG(int, _key.zoomKey),
+                                  Q_ARG(int, _key.tile), Q_ARG(QImage, image));
+    }
+
+private:
+    PreviewWidget *_widget;
+    QSharedPointer<PreviewRenderState> _state;
+    ORODocument *_doc;
+    PreviewPageKey _key;
+    double _zoom;
+    QSize _size;
+    QRect _tile;
+    qreal _xDpi;
+    qreal _yDpi;
+    QSize _margins;
+};
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -110,7 +188,8 @@ PreviewWidget::PreviewWidget(ORODocument *document,
                              QPrinter *pPrinter,
                              QWidget *parent)
     : QAbstractScrollArea(parent),
-      _doc(document), _pPrinter(pPrinter), _zoom(1.0), mousepos(), scrollpos()
+      _doc(document), _pPrinter(pPrinter), _zoom(1.0), mousepos(), scrollpos(),
+      _pageCache(pageCacheSize), _renderState(new PreviewRenderState)
 {
     viewport()->setBackgroundRole(QPalette::Dark);
     verticalScrollBar()->setSingleStep(25);
@@ -122,12 +201,16 @@ PreviewWidget::PreviewWidget(ORODocument *document,
 
 PreviewWidget::~PreviewWidget()
 {
+    // the tasks use the document, let the running ones finish
+    _renderPool.clear();
+    _renderPool.waitForDone();
 }
 
 // updateView() ///////////////////////////////////////////////////////////////
 // update the view
 void PreviewWidget::updateView()
 {
+    _pageCache.clear();
     resizeEvent(0);
     viewport()->update();
 }
@@ -203,17 +286,33 @@ void PreviewWidget::paintEvent(QPaintEvent *)
 
     painter.translate(-horizontalScrollBar()->value(),
                       -verticalScrollBar()->value());
-    painter.translate(spacing, spacing);
 
     double paperwidth = paperRect(viewport()).width();
     double paperheight = paperRect(viewport()).height();
     int nbCol = nbColumns();
-
-    for(int page = 0; page < _doc->pages(); page++)
+    int colWidth = columnWidth();
+    int lineHeight = (int)(spacing + paperheight * _zoom);
+    int zoomKey = qRound(_zoom * 100);
+
+    // only the pages intersecting the viewport are drawn
+    QRect exposed(horizontalScrollBar()->value(), verticalScrollBar()->value(),
+                  viewport()->width(), viewport()->height());
+    int firstLine = qMax(0, (exposed.top() - spacing) / lineHeight);
+    int lastLine = qMax(0, (exposed.bottom() - spacing) / lineHeight);
+    int firstPage = firstLine * nbCol;
+    int lastPage = qMin(_doc->pages(), (lastLine + 1) * nbCol);
+
+    _visible.clear();
+    for(int page = firstPage; page < lastPage; page++)
     {
-        int column = page % nbCol;
+        int x = spacing + (page % nbCol) * colWidth;
+        int y = spacing + (page / nbCol) * lineHeight;
+        QRect pageRect(x, y, (int)ceil((paperwidth + 2) * _zoom), (int)ceil((paperheight + 2) * _zoom));
+        if (!pageRect.intersects(exposed))
+            continue;
 
         painter.save();
+        painter.translate(x, y);
         painter.scale(_zoom, _zoom);
 
         // draw outline and shadow
@@ -227,18 +326,92 @@ void PreviewWidget::paintEvent(QPaintEvent *)
         painter.drawLine(QLineF(2, paperheight+1, paperwidth, paperheight+1));
         painter.drawLine(QLineF(2, paperheight+2, paperwidth, paperheight+2));
 
-        qreal xDpi = parentWidget()->logicalDpiX();
-        qreal yDpi = parentWidget()->logicalDpiY();
+        painter.restore();
+
+        // the blank page stands in until the page is rendered. A page
+        // larger than the view is rendered by tiles, only the ones exposed
+        QSize pageSize((int)ceil(paperwidth * zoomKey / 100.0), (int)ceil(paperheight * zoomKey / 100.0));
+        if (pageSize.width() <= viewport()->width() && pageSize.height() <= viewport()->height()) {
+            drawPage(painter, PageKey(page, zoomKey), QPoint(x, y));
+            continue;
+        }
+        QRect inPage = exposed.intersected(QRect(QPoint(x, y), pageSize)).translated(-x, -y);
+        if (inPage.isEmpty())
+            continue;
+        int tileColumns = (pageSize.width() + tileSize - 1) / tileSize;
+        for (int row = inPage.top() / tileSize; row <= inPage.bottom() / tileSize; row++)
+            for (int col = inPage.left() / tileSize; col <= inPage.right() / tileSize; col++)
+                drawPage(painter, PageKey(page, zoomKey, row * tileColumns + col),
+                         QPoint(x + col * tileSize, y + row * tileSize));
+    }
 
-        QSize margins(_pPrinter->paperRect().left() - _pPrinter->pageRect().left(), _pPrinter->paperRect().top() - _pPrinter->pageRect().top());
+    // pages queued earlier but scrolled away since are skipped
+    QMutexLocker locker(&_renderState->lock);
+    _renderState->wanted = _visible;
+}
 
-        ORPrintRender::renderPage(_doc, page, &painter, xDpi, yDpi, margins, 100);
+// drawPage() /////////////////////////////////////////////////////////////////
+// draw a rendered page or tile, or ask for it
 
-        painter.restore();
-        int xTranslation = column==nbCol-1 ? (columnWidth()* -(nbCol-1)) : columnWidth();
-        int yTranslation = column==nbCol-1 ? (int)(spacing + paperRect(viewport()).height() * _zoom) : 0;
-        painter.translate(xTranslation, yTranslation);
+void PreviewWidget::drawPage(QPainter &painter, const PageKey &key, const QPoint &pos)
+{
+    _visible.insert(key);
+    QPixmap *pixmap = _pageCache.object(key);
+    if (pixmap)
+        painter.drawPixmap(pos, *pixmap);
+    else
+        requestPage(key);
+}
+
+// requestPage() //////////////////////////////////////////////////////////////
+// queue a page or a tile for rendering at the given zoom
+
+void PreviewWidget::requestPage(const PageKey &key)
+{
+    if (_pending.contains(key))
+        return;
+    _pending.insert(key);
+
+    double zoom = key.zoomKey / 100.0;
+    QSize size((int)ceil(paperRect(viewport()).width() * zoom),
+               (int)ceil(paperRect(viewport()).height() * zoom));
+    QRect tile;
+    if (key.tile >= 0) {
+        int tileColumns = (size.width() + tileSize - 1) / tileSize;
+        tile = QRect((key.tile % tileColumns) * tileSize, (key.tile / tileColumns) * tileSize,
+                     tileSize, tileSize).intersected(QRect(QPoint(0, 0), size));
+    }
+    qreal xDpi = parentWidget()->logicalDpiX();
+    qreal yDpi = parentWidget()->logicalDpiY();
+    QSize margins(_pPrinter->paperRect().left() - _pPrinter->pageRect().left(), _pPrinter->paperRect().top() - _pPrinter->pageRect().top());
+
+    {
+        QMutexLocker locker(&_renderState->lock);
+        _renderState->wanted.insert(key);
     }
+    _renderPool.start(new PreviewPageTask(this, _renderState, _doc, key, zoom,
+                                          size, tile, xDpi, yDpi, margins));
+}
+
+// pageRendered() /////////////////////////////////////////////////////////////
+// store a page or a tile rendered in the background and show it
+
+void PreviewWidget::pageRendered(int page, int zoomKey, int tile, const QImage &image)
+{
+    PageKey key(page, zoomKey, tile);
+    _pending.remove(key);
+
+    if (image.isNull()) {
+        // skipped, but it may have come back into view meanwhile
+        if (_visible.contains(key))
+            viewport()->update();
+        return;
+    }
+
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+    _pageCache.insert(key, pixmap, qMax(1, image.byteCount() / 1024));
+    if (_visible.contains(key))
+        viewport()->update();
 }
 
 // resizeEvent() //////////////////////////////////////////////////////////////
@@ -32,12 +32,37 @@
 #define PREVIEWDIALOG_H
 
 #include <QAbstractScrollArea>
+#include <QCache>
 #include <QDialog>
+#include <QImage>
+#include <QPixmap>
+#include <QSet>
+#include <QSharedPointer>
+#include <QThreadPool>
 
 class PreviewWidget;
 class QAbstractScrollArea;
 class ORODocument;
 class QPrinter;
+struct PreviewRenderState;
+
+// a rendered page at a zoom level, or one tile of it when the page is
+// larger than the view
+struct PreviewPageKey
+{
+    PreviewPageKey(int p = 0, int z = 0, int t = -1) : page(p), zoomKey(z), tile(t) {}
+    bool operator==(const PreviewPageKey &o) const
+    { return page == o.page && zoomKey == o.zoomKey && tile == o.tile; }
+
+    int page;
+    int zoomKey;
+    int tile;    // row * columns + column, -1 for the whole page
+};
+
+inline uint qHash(const PreviewPageKey &key)
+{
+    return (uint)key.page * 31u * 31u + (uint)key.zoomKey * 31u + (uint)(key.tile + 1);
+}
 
 ///////////////////////////////////////////////////////////////////////////////
 /// \class PreviewDialog
@@ -75,6 +100,8 @@ private slots:
     // zoom preview
     void zoomIn();
     void zoomOut();
+    // a page or a tile finished rendering in the background
+    void pageRendered(int page, int zoomKey, int tile, const QImage &image);
 
 private:
     virtual void paintEvent(QPaintEvent *e);
@@ -85,7 +112,8 @@ private:
     QRectF paperRect(QPaintDevice *device);
     int columnWidth();
     int nbColumns();
-
+    void drawPage(QPainter &painter, const PreviewPageKey &key, const QPoint &pos);
+    void requestPage(const PreviewPageKey &key);
 
 private:
     ORODocument * _doc;
@@ -93,6 +121,14 @@ private:
     double _zoom;
     QPoint mousepos;
     QPoint scrollpos;
+
+    // rendered pages and tiles, cost in kilobytes
+    typedef PreviewPageKey PageKey;
+    QCache<PageKey, QPixmap> _pageCache;
+    QSet<PageKey> _pending;
+    QSet<PageKey> _visible;
+    QSharedPointer<PreviewRenderState> _renderState;
+    QThreadPool _renderPool;
 };
 
 #endif // PREVIEWDIALOG_H
@@ -39,7 +39,11 @@ HEADERS = openreports.h \
           orcrosstab.h \
           orutils.h \
           orprerender.h \
+          orreportcache.h \
+          orcompiledreport.h \
           orprintrender.h \
+          orpdfexport.h \
+          orimageexport.h \
           renderobjects.h \
           previewdialog.h \
           labelpaintengine.h \
@@ -47,6 +51,7 @@ HEADERS = openreports.h \
           satopaintengine.h \
           satoprintengine.h \
           zebrapaintengine.h \
+          zebraencoding.h \
           zebraprintengine.h \
           reportprinter.h \
           textelementsplitter.h \
@@ -60,11 +65,16 @@ SOURCES = openreports.cpp \
           i2of5.cpp \
           code128.cpp \
           codeean.cpp \
+          barcodecache.cpp \
           crosstab.cpp \
           graph.cpp \
           orutils.cpp \
           orprerender.cpp \
+          orreportcache.cpp \
+          orcompiledreport.cpp \
           orprintrender.cpp \
+          orpdfexport.cpp \
+          orimageexport.cpp \
           renderobjects.cpp \
           previewdialog.cpp \ 
           labelpaintengine.cpp \
@@ -72,6 +82,7 @@ SOURCES = openreports.cpp \
           satopaintengine.cpp \
           satoprintengine.cpp \
           zebrapaintengine.cpp \
+          zebraencoding.cpp \
           zebraprintengine.cpp \
           reportprinter.cpp \
           textelementsplitter.cpp \
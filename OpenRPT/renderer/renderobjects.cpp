@@ -18,8 +18,14 @@
  * Please contact info@openmfg.com with any questions on this license.
  */
 
+#include <QAtomicInt>
 #include <QDebug>
+#include <QMutexLocker>
 #include <QPainter>
+#include <QTransform>
+
+#include <algorithm>
+#include <math.h>
 
 #include "renderobjects.h"
 #include "parsexmlutils.h"
@@ -28,7 +34,7 @@
 // ORODocument
 //
 ORODocument::ORODocument(const QString & title, ReportPrinter::type printerType)
-  : _title(title), _type(printerType)
+  : _title(title), _type(printerType), _displayLists(DisplayListBytes / 1024)
 {
 }
 
@@ -66,14 +72,21 @@ void ORODocument::addPage(OROPage* p)
 void ORODocument::setPageOptions(const ReportPageOptions & options)
 {
   _pageOptions = options;
+  QMutexLocker locker(&_displayListLock);
+  _displayLists.clear();
 }
 
 //
 // OROPage
 //
+// never the same twice, so a recording of a page that is gone or changed
+// can not be taken for one of the page now at that address
+static QAtomicInt displayListVersions(0);
+
 OROPage::OROPage(ORODocument * pDocument)
-  : _document(pDocument)
+  : _document(pDocument), _indexColumns(0), _indexRows(0)
 {
+  _displayListVersion = displayListVersions.fetchAndAddOrdered(1);
   _wmOpacity = 25;
   _bgPos = QPointF(0, 0);
   _bgSize = QSizeF(1, 1);
@@ -126,56 +139,198 @@ void OROPage::addPrimitive(OROPrimitive* p)
 
   p->_page = this;
   _primitives.append(p);
+  clearDisplayLists();
+  clearIndex();
+}
+
+// inclusive test, so lines and points of no width are still found
+static bool overlaps(const QRectF & a, const QRectF & b)
+{
+  return a.left() <= b.right() && b.left() <= a.right() &&
+         a.top() <= b.bottom() && b.top() <= a.bottom();
+}
+
+void OROPage::buildIndex(qreal cellSize)
+{
+  clearIndex();
+  if(_primitives.isEmpty() || cellSize <= 0)
+    return;
+
+  _indexBounds.resize(_primitives.count());
+  for(int i = 0; i < _primitives.count(); i++)
+  {
+    _indexBounds[i] = _primitives.at(i)->boundingRect();
+    _indexArea = (i == 0 ? _indexBounds.at(i) : _indexArea.united(_indexBounds.at(i)));
+  }
+  // keep the area from collapsing when everything sits on one line
+  if(_indexArea.width() <= 0)
+    _indexArea.setWidth(cellSize);
+  if(_indexArea.height() <= 0)
+    _indexArea.setHeight(cellSize);
+
+  _indexColumns = qBound(1, (int)ceil(_indexArea.width() / cellSize), 256);
+  _indexRows = qBound(1, (int)ceil(_indexArea.height() / cellSize), 256);
+  _indexCells.resize(_indexColumns * _indexRows);
+
+  for(int i = 0; i < _indexBounds.count(); i++)
+  {
+    const QRectF & r = _indexBounds.at(i);
+    int c0 = qBound(0, (int)((r.left()   - _indexArea.left()) / _indexArea.width()  * _indexColumns), _indexColumns - 1);
+    int c1 = qBound(0, (int)((r.right()  - _indexArea.left()) / _indexArea.width()  * _indexColumns), _indexColumns - 1);
+    int r0 = qBound(0, (int)((r.top()    - _indexArea.top())  / _indexArea.height() * _indexRows),    _indexRows - 1);
+    int r1 = qBound(0, (int)((r.bottom() - _indexArea.top())  / _indexArea.height() * _indexRows),    _indexRows - 1);
+    for(int row = r0; row <= r1; row++)
+      for(int col = c0; col <= c1; col++)
+        _indexCells[row * _indexColumns + col].append(i);
+  }
+}
+
+void OROPage::clearIndex()
+{
+  _indexBounds.clear();
+  _indexCells.clear();
+  _indexArea = QRectF();
+  _indexColumns = _indexRows = 0;
+}
+
+QList<OROPrimitive*> OROPage::primitivesIn(const QRectF & area) const
+{
+  QList<OROPrimitive*> found;
+  QRectF rect = area.normalized();
+
+  if(!hasIndex())
+  {
+    for(int i = 0; i < _primitives.count(); i++)
+      if(overlaps(_primitives.at(i)->boundingRect(), rect))
+        found.append(_primitives.at(i));
+    return found;
+  }
+
+  if(!overlaps(_indexArea, rect))
+    return found;
+
+  int c0 = qBound(0, (int)((rect.left()   - _indexArea.left()) / _indexArea.width()  * _indexColumns), _indexColumns - 1);
+  int c1 = qBound(0, (int)((rect.right()  - _indexArea.left()) / _indexArea.width()  * _indexColumns), _indexColumns - 1);
+  int r0 = qBound(0, (int)((rect.top()    - _indexArea.top())  / _indexArea.height() * _indexRows),    _indexRows - 1);
+  int r1 = qBound(0, (int)((rect.bottom() - _indexArea.top())  / _indexArea.height() * _indexRows),    _indexRows - 1);
+
+  // a primitive spanning several cells is listed in each of them
+  QVector<int> hits;
+  for(int row = r0; row <= r1; row++)
+    for(int col = c0; col <= c1; col++)
+      hits += _indexCells.at(row * _indexColumns + col);
+  std::sort(hits.begin(), hits.end());
+  hits.erase(std::unique(hits.begin(), hits.end()), hits.end());
+
+  for(int i = 0; i < hits.count(); i++)
+    if(overlaps(_indexBounds.at(hits.at(i)), rect))
+      found.append(_primitives.at(hits.at(i)));
+  return found;
+}
+
+QList<OROPrimitive*> OROPage::primitivesAt(const QPointF & pt) const
+{
+  return primitivesIn(QRectF(pt, QSizeF(0, 0)));
+}
+
+QString OROPage::displayListKey(const QString & key) const
+{
+  return QString("%1/%2").arg(_displayListVersion).arg(key);
+}
+
+QPicture OROPage::displayList(const QString & key) const
+{
+  if(_document == 0)
+    return QPicture();
+
+  QMutexLocker locker(&_document->_displayListLock);
+  QPicture * picture = _document->_displayLists.object(displayListKey(key));
+  return (picture ? *picture : QPicture());
+}
+
+void OROPage::setDisplayList(const QString & key, const QPicture & picture)
+{
+  if(_document == 0)
+    return;
+
+  // one larger than the whole budget is not kept at all
+  QMutexLocker locker(&_document->_displayListLock);
+  _document->_displayLists.insert(displayListKey(key), new QPicture(picture), picture.size() / 1024 + 1);
+}
+
+void OROPage::removeDisplayList(const QString & key)
+{
+  if(_document == 0)
+    return;
+
+  QMutexLocker locker(&_document->_displayListLock);
+  _document->_displayLists.remove(displayListKey(key));
+}
+
+// the recordings of the old state age out of the document's cache
+void OROPage::clearDisplayLists()
+{
+  _displayListVersion = displayListVersions.fetchAndAddOrdered(1);
 }
 
 void OROPage::setWatermarkText(const QString & txt)
 {
   _wmText = txt;
+  clearDisplayLists();
 }
 
 void OROPage::setWatermarkFont(const QFont & fnt)
 {
   _wmFont = fnt;
+  clearDisplayLists();
 }
 
 void OROPage::setWatermarkOpacity(unsigned char o)
 {
   _wmOpacity = o;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundImage(const QImage & img)
 {
   _bgImage = img;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundPosition(const QPointF & p)
 {
   _bgPos = p;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundSize(const QSizeF & s)
 {
   _bgSize = s;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundScale(bool b)
 {
   _bgScale = b;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundScaleMode(Qt::AspectRatioMode m)
 {
   _bgScaleMode = m;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundAlign(int a)
 {
   _bgAlign = a;
+  clearDisplayLists();
 }
 
 void OROPage::setBackgroundOpacity(unsigned char o)
 {
   _bgOpacity = o;
+  clearDisplayLists();
 }
 
 //
@@ -199,6 +354,8 @@ OROPrimitive::~OROPrimitive()
   if(_page != 0)
   {
     _page->_primitives.removeAt(_page->_primitives.indexOf(this));
+    _page->clearDisplayLists();
+    _page->clearIndex();
     _page = 0;
   }
 }
@@ -213,6 +370,43 @@ void OROPrimitive::setRotationAxis(const QPointF p)
 	_rotationAxis = p;
 }
 
+QRectF OROPrimitive::boundingRect() const
+{
+  QSizeF sz;
+  if(type() == OROTextBox::TextBox)
+    sz = ((const OROTextBox*)this)->size();
+  else if(type() == OROBarcode::Barcode)
+    sz = ((const OROBarcode*)this)->size();
+  else if(type() == OROImage::Image)
+    sz = ((const OROImage*)this)->size();
+  else if(type() == ORORect::Rect)
+    sz = ((const ORORect*)this)->size();
+  else if(type() == OROLine::Line)
+  {
+    QPointF e = ((const OROLine*)this)->endPoint();
+    sz = QSizeF(e.x() - _position.x(), e.y() - _position.y());
+  }
+
+  // same transformation as ORPrintRender::renderPage(), in inches
+  QTransform t;
+  if(_rotationAxis.isNull())
+  {
+    t.translate(_position.x(), _position.y());
+    t.rotate(_rotation);
+  }
+  else
+  {
+    t.translate(_rotationAxis.x(), _rotationAxis.y());
+    t.rotate(_rotation);
+    t.translate(_position.x() - _rotationAxis.x(), _position.y() - _rotationAxis.y());
+  }
+  QRectF rc = t.mapRect(QRectF(QPointF(0, 0), sz).normalized());
+
+  // pen widths are in hundredths of an inch
+  qreal pad = qMax(_pen.widthF(), _border.widthF()) / 200.0;
+  return rc.adjusted(-pad, -pad, pad, pad);
+}
+
 void OROPrimitive::drawRect(QRectF rc, QPainter* painter, int printResolution)
 {
   if(border().width()==0 && type()!=ORORect::Rect && brush()==Qt::NoBrush)
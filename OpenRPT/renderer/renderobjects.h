@@ -28,6 +28,12 @@
 #include <QImage>
 #include <QPen>
 #include <QBrush>
+#include <QCache>
+#include <QMap>
+#include <QMutex>
+#include <QPicture>
+#include <QRectF>
+#include <QVector>
 
 #include "../../common/reportpageoptions.h"
 #include "reportprinter.h"
@@ -67,12 +73,19 @@ class ORODocument
     void setPrinterParams(QList<QPair<QString,QString> > params) { _printerParams = params; }
     QList<QPair<QString,QString> > getPrinterParams() const { return _printerParams; }
 
+    // the recordings of the pages together take at most this many bytes,
+    // the least recently replayed are dropped first
+    enum { DisplayListBytes = 64 * 1024 * 1024 };
+
   private:
     QString _title;
     ReportPrinter::type _type;
     QList<OROPage*> _pages;
     ReportPageOptions _pageOptions;
     QList<QPair<QString,QString> >  _printerParams;
+
+    QCache<QString, QPicture> _displayLists; // cost in KB
+    QMutex _displayListLock;
 };
 
 //
@@ -121,10 +134,39 @@ class OROPage
     int backgroundAlign() const { return _bgAlign; };
     unsigned char backgroundOpacity() const { return _bgOpacity; };
 
+    // Recorded drawing of this page, as produced by ORPrintRender, so the
+    // page can be replayed instead of rendered again. The key identifies
+    // the output resolution. The recordings are kept by the document, within
+    // ORODocument::DisplayListBytes; changing the page discards them.
+    QPicture displayList(const QString & key) const;
+    void setDisplayList(const QString & key, const QPicture &);
+    void removeDisplayList(const QString & key);
+    void clearDisplayLists();
+
+    // Optional grid over the primitives so that a region or a point can be
+    // looked up without visiting every primitive of the page. Rectangles
+    // and points are in inches, like the primitive positions. Adding or
+    // removing a primitive drops the index; without one the lookups below
+    // fall back to a full scan. Results are in page (painting) order.
+    void buildIndex(qreal cellSize = 0.5);
+    void clearIndex();
+    bool hasIndex() const { return !_indexCells.isEmpty(); };
+    QList<OROPrimitive*> primitivesIn(const QRectF &) const;
+    QList<OROPrimitive*> primitivesAt(const QPointF &) const;
+
   protected:
     ORODocument * _document;
     QList<OROPrimitive*> _primitives;
 
+    QVector<QRectF> _indexBounds; // bounding rect of each primitive
+    QVector<QVector<int> > _indexCells; // primitive indexes, row by row
+    QRectF _indexArea;
+    int _indexColumns;
+    int _indexRows;
+
+    QString displayListKey(const QString & key) const;
+    int _displayListVersion; // unique to this state of the page
+
     QString _wmText;
     QFont _wmFont;
     unsigned char _wmOpacity;
@@ -177,6 +219,9 @@ class OROPrimitive
 
     void drawRect(QRectF rc, QPainter* painter, int printResolution);
 
+    // area covered on the page in inches, rotation and pen included
+    QRectF boundingRect() const;
+
   private:
     OROPage * _page;
     int     _type;
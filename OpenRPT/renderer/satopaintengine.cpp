@@ -24,6 +24,7 @@
 #include <QtDebug>
 #include <QHostInfo>
 #include <QTextCodec>
+#include <string.h>
 
 #include "satopaintengine.h"
 #include "barcodes.h"
@@ -86,6 +87,14 @@ SatoPaintEngine::SatoPaintEngine(ReportPrinter *parentPrinter) : LabelPaintEngin
 }
 
 
+bool SatoPaintEngine::end ()
+{
+  bool ok = LabelPaintEngine::end();
+  m_storedImages.clear();
+  return ok;
+}
+
+
 bool 	SatoPaintEngine::begin ( QPaintDevice * pdev )
 {
   Q_UNUSED(pdev);
@@ -118,12 +127,35 @@ bool 	SatoPaintEngine::begin ( QPaintDevice * pdev )
     }
   }
 
-  m_printBuffer.append(init);
+  startLabel(init.toUtf8());
 
   return true;
 }
 
 
+// the autoformat param is a memory and slot, like the store mask
+QByteArray SatoPaintEngine::storeFormatCmds(const QByteArray &header, const QByteArray &fields) const
+{
+  QString mask = autoFormat();
+  if(mask.length()!=3 || (mask.at(0)!='1' && mask.at(0)!='2')) {
+    return QByteArray();
+  }
+
+  QByteArray cmds = header;
+  cmds += fields;
+  cmds += QString(m_CmdPrefix + "CC" + mask.at(0) + m_CmdPrefix + "&S" + "," + mask.right(2) + "\n");
+  cmds += QString(m_CmdPrefix + "Z");
+  return cmds;
+}
+
+
+QByteArray SatoPaintEngine::recallFormatCmds() const
+{
+  QString mask = autoFormat();
+  return QString(m_CmdPrefix + "CC" + mask.at(0) + m_CmdPrefix + "&R" + "," + mask.right(2) + "\n").toUtf8();
+}
+
+
 void 	SatoPaintEngine::addEndMessage ()
 {
   // white on black areas
@@ -256,43 +288,86 @@ void SatoPaintEngine::drawImage ( const QRectF & rectangle, const QImage & image
   int yInDots = (int)(rectangle.top() + transform.dy());
 
   QImage monoImage = image.convertToFormat(QImage::Format_Mono);
-  int missingLines = (8 - (monoImage.height() % 8)) % 8;
   int width = monoImage.width();
-  int nbOfLines = monoImage.height() + missingLines;
+  int height = monoImage.height();
+  int bytesPerLine = (width+7)/8;
+  uchar lastByteMask = (uchar)(0xFF << ((8 - width % 8) % 8));
+
+  // one bit per dot, out-of-bounds pixels set to zero
+  QByteArray bits(bytesPerLine * height, Qt::Uninitialized);
+  for(int line=0; line < height && bytesPerLine > 0; line++) {
+    char *row = bits.data() + line * bytesPerLine;
+    memcpy(row, monoImage.constScanLine(line), bytesPerLine);
+    row[bytesPerLine-1] &= lastByteMask;
+  }
+
+  static const char hexDigits[] = "0123456789ABCDEF";
+  const QByteArray prefix = m_CmdPrefix.toUtf8();
+  int missingLines = (8 - (height % 8)) % 8;
+  int nbOfLines = height + missingLines;
+
+  // a repeated image, typically a logo on every label, is stored in the
+  // printer with the first label that draws it and recalled afterwards
+  QByteArray key = QByteArray::number(width) + ':' + bits;
+  int storageNumber = m_storedImages.value(key);
+  if(storageNumber == 0 && bytesPerLine > 0 && m_storedImages.size() < maxStoredImages
+     && bytesPerLine <= 999 && nbOfLines / 8 <= 999) {
+    storageNumber = m_storedImages.size() + 1;
+
+    QByteArray store;
+    store.reserve(bytesPerLine * nbOfLines * 2 + 64);
+    store += prefix + "A\n";
+    store += prefix + "GIH" + QByteArray::number(bytesPerLine).rightJustified(3, '0')
+                            + QByteArray::number(nbOfLines / 8).rightJustified(3, '0')
+                            + QByteArray::number(storageNumber).rightJustified(3, '0');
+    for(int line=0; line < nbOfLines; line++) {
+      for(int i=0; i < bytesPerLine; i++) {
+        uchar imageByte = line < height ? (uchar)bits.at(line * bytesPerLine + i) : 0;
+        store.append(hexDigits[imageByte >> 4]);
+        store.append(hexDigits[imageByte & 0x0F]);
+      }
+    }
+    store += '\n' + prefix + "Z\n";
+
+    insertBeforeLabel(store);
+    m_storedImages.insert(key, storageNumber);
+  }
+
+  if(storageNumber > 0) {
+    m_printBuffer.append(prefix + 'V' + QByteArray::number(yInDots) + prefix + 'H' + QByteArray::number(xInDots)
+                         + prefix + "GR" + QByteArray::number(storageNumber).rightJustified(3, '0') + '\n');
+    return;
+  }
+
+  // too big or too many to store: printed in place
   int blockSize = 32; // vertical block of lines, output on a single command line
 
+  QByteArray output;
+  output.reserve(bytesPerLine * nbOfLines * 2 + bytesPerLine * (nbOfLines / blockSize + 1) * 32);
   for (int x=0; x<width; x+=8) {
 
     for(int line=0; line < nbOfLines; line++) {
 
-      QString output;
       if(line % blockSize == 0) {
         if(line > 0) {
           output.append('\n');
         }
-        output += QString(m_CmdPrefix + "V%1" + m_CmdPrefix + "H%2").arg(QString::number(yInDots+line), QString::number(xInDots+x));
         int nbOfBlocks = qMin(nbOfLines-line, blockSize)/8;
-        output += m_CmdPrefix + QString().sprintf("GH%03d%03d", 1, nbOfBlocks);
+        output += prefix + 'V' + QByteArray::number(yInDots+line) + prefix + 'H' + QByteArray::number(xInDots+x);
+        output += prefix + "GH001" + QByteArray::number(nbOfBlocks).rightJustified(3, '0');
       }
 
-      if(line<monoImage.height()) {
-        uchar imageByte = monoImage.scanLine(line)[x/8];
-        int validPix = width-x;
-        if(validPix<8) { // set out-of-bounds pixels to zero
-          imageByte >>= 8-validPix;
-          imageByte <<= 8-validPix;
-        }
-        output.append(QString().sprintf("%02X",imageByte).toUpper());
-      }
-      else {
-        output.append("00");
+      uchar imageByte = 0;
+      if(line<height) {
+        imageByte = (uchar)bits.at(line * bytesPerLine + x/8);
       }
-
-      m_printBuffer.append(output);
-
+      output.append(hexDigits[imageByte >> 4]);
+      output.append(hexDigits[imageByte & 0x0F]);
     }
-    m_printBuffer.append('\n');
+    output.append('\n');
   }
+
+  m_printBuffer.append(output);
 }
 
 
@@ -21,6 +21,7 @@
 #ifndef SATOPAINTENGINE_H
 #define SATOPAINTENGINE_H
 
+#include <QHash>
 #include "labelpaintengine.h"
 #include "reportprinter.h"
 
@@ -30,6 +31,7 @@ public:
   SatoPaintEngine(ReportPrinter *parentPrinter);
 
   virtual bool 	begin ( QPaintDevice * pdev );
+  virtual bool 	end ();
 
   virtual void 	drawImage ( const QRectF & rectangle, const QImage & image, const QRectF & sr, Qt::ImageConversionFlags flags = Qt::AutoColor );
   virtual void 	drawLines ( const QLineF * lines, int lineCount );
@@ -41,6 +43,8 @@ public:
 protected:
   virtual void  drawBarcode ( const QPointF & p, const QString &format, int height, int width, int narrowBar, QString barcodeData );
   virtual void  drawText ( const QPointF &p, const QString & text, const QFont &font = QFont());
+  virtual QByteArray storeFormatCmds(const QByteArray &header, const QByteArray &fields) const;
+  virtual QByteArray recallFormatCmds() const;
   virtual QString rotation0Cmd() const { return "%0"; }
   virtual QString rotation90Cmd() const { return "%3"; }
   virtual QString rotation180Cmd() const { return "%2"; }
@@ -50,6 +54,8 @@ protected:
 private:
 
   QList<QRect> m_ReverseZones;
+  enum { maxStoredImages = 999 };
+  QHash<QByteArray, int> m_storedImages; // image -> graphic storage number, for this job
 
 };
 
@@ -0,0 +1,113 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "zebraencoding.h"
+
+#include <QImage>
+#include <string.h>
+
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+
+// GRF data: one bit per dot, each row padded to a whole byte with zeros
+QByteArray zebraGrfData(const QImage &monoImage)
+{
+  int width = monoImage.width();
+  int bytesPerLine = (width+7)/8;
+  uchar lastByteMask = (uchar)(0xFF << ((8 - width % 8) % 8));
+
+  QByteArray grf(bytesPerLine * monoImage.height(), Qt::Uninitialized);
+  char *out = grf.data();
+  for(int line=0; line < monoImage.height() && bytesPerLine > 0; line++) {
+    memcpy(out, monoImage.constScanLine(line), bytesPerLine);
+    out[bytesPerLine-1] &= lastByteMask; // set out-of-bounds pixels to zero
+    out += bytesPerLine;
+  }
+  return grf;
+}
+
+
+QByteArray zebraHexa(const QByteArray &in)
+{
+  QByteArray out(in.length()*2, Qt::Uninitialized);
+  const uchar *src = (const uchar *)in.constData();
+  char *dst = out.data();
+  for(int i=0; i<in.length(); i++) {
+    *dst++ = hexDigits[src[i] >> 4];
+    *dst++ = hexDigits[src[i] & 0x0F];
+  }
+  return out;
+}
+
+
+QByteArray zebraCompressedHexa(const QByteArray &in)
+{
+  const int maxOccurrences = 400;
+  const char *data = in.constData();
+  int length = in.length();
+
+  QByteArray out;
+  out.reserve(length);
+  for (int pos=0; pos<length; pos++) {
+    int occurrences = 1;
+    while(pos+occurrences < length && data[pos+occurrences] == data[pos]) {
+      occurrences++;
+      if(occurrences >= maxOccurrences) {
+        break;
+      }
+    }
+    if(occurrences>1) {
+      if(occurrences / 20 > 0) {
+        out.append((char)('f' + (occurrences / 20)));
+      }
+      if(occurrences % 20 > 0) {
+        out.append((char)('F' + (occurrences % 20)));
+      }
+      pos += (occurrences-1);
+    }
+    out.append(data[pos]);
+  }
+  return out;
+}
+
+
+// CRC-16/XMODEM, the check value of the :Z64: encoding
+static quint16 crc16(const QByteArray &in)
+{
+  quint16 crc = 0;
+  for(int i=0; i<in.length(); i++) {
+    crc ^= (quint16)((uchar)in.at(i)) << 8;
+    for(int bit=0; bit<8; bit++) {
+      crc = (crc & 0x8000) ? (quint16)((crc << 1) ^ 0x1021) : (quint16)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+
+// :Z64: encoding, zlib compressed then base64 encoded, with its CRC
+QByteArray zebraZ64(const QByteArray &in)
+{
+  QByteArray compressed = qCompress(in);
+  compressed.remove(0, 4); // qCompress() prepends the uncompressed size
+  QByteArray encoded = compressed.toBase64();
+  return ":Z64:" + encoded + ":" + QByteArray::number(crc16(encoded), 16).toUpper().rightJustified(4, '0');
+}
@@ -27,40 +27,22 @@
 #include <QTextCodec>
 
 #include "zebrapaintengine.h"
+#include "zebraencoding.h"
 #include "barcodes.h"
 
 
-static QByteArray compressedHexa(const QByteArray &in)
+ZebraPaintEngine::ZebraPaintEngine(ReportPrinter *parentPrinter) : LabelPaintEngine(parentPrinter, "^")
 {
-  const int maxOccurrences = 400;
-  QByteArray out;
-  for (int pos=0; pos<in.length(); pos++) {
-    int occurrences = 1;
-    while(pos+occurrences < in.length() && in.at(pos+occurrences) == in.at(pos)) {
-      occurrences++;
-      if(occurrences >= maxOccurrences) {
-        break;
-      }
-    }
-    if(occurrences>1) {
-      if(occurrences / 20 > 0) {
-        char c = 'f' + (occurrences / 20);
-        out.append(c);
-      }
-      if(occurrences % 20 > 0) {
-        char c = 'F' + (occurrences % 20);
-        out.append(c);
-      }
-      pos += (occurrences-1);
-    }
-    out.append(in.at(pos));
-  }
-  return out;
+  // Z64 needs a recent firmware, compressed hexadecimal is understood by all
+  m_z64Images = (m_parentPrinter->getParam("imageencoding").toLower() == "z64");
 }
 
 
-ZebraPaintEngine::ZebraPaintEngine(ReportPrinter *parentPrinter) : LabelPaintEngine(parentPrinter, "^")
+bool ZebraPaintEngine::end ()
 {
+  bool ok = LabelPaintEngine::end();
+  m_imageNames.clear();
+  return ok;
 }
 
 
@@ -80,11 +62,46 @@ bool 	ZebraPaintEngine::begin ( QPaintDevice * pdev )
 
   init += "\n";
 
-  m_printBuffer.append(init);
+  startLabel(init.toUtf8());
   return true;
 }
 
 
+QString ZebraPaintEngine::storedFormatName() const
+{
+  // the param may name the format, R:OPENRPT.ZPL by default
+  QString name = autoFormat();
+  if(!name.contains(':')) {
+    name = "R:OPENRPT.ZPL";
+  }
+  return name;
+}
+
+
+QByteArray ZebraPaintEngine::storeFormatCmds(const QByteArray &header, const QByteArray &fields) const
+{
+  Q_UNUSED(header);
+  QByteArray cmds;
+  cmds += QString(m_CmdPrefix + "XA" + m_CmdPrefix + "DF%1" + m_CmdPrefix + "FS\n").arg(storedFormatName());
+  cmds += fields;
+  cmds += QString(m_CmdPrefix + "XZ\n");
+  return cmds;
+}
+
+
+QByteArray ZebraPaintEngine::recallFormatCmds() const
+{
+  return QString(m_CmdPrefix + "XF%1" + m_CmdPrefix + "FS\n").arg(storedFormatName()).toUtf8();
+}
+
+
+bool ZebraPaintEngine::isStorableField(const QByteArray &field) const
+{
+  // downloads are sent once per job, only the recall can be stored
+  return !field.startsWith('~');
+}
+
+
 void 	ZebraPaintEngine::addEndMessage ()
 {
   QString printMode = m_parentPrinter->getParam("printmode");
@@ -188,57 +205,28 @@ void ZebraPaintEngine::drawImage ( const QRectF & rectangle, const QImage & imag
   Q_UNUSED(sr);
   Q_UNUSED(flags);
   QImage monoImage = image.convertToFormat(QImage::Format_Mono);
-/*
-  //PNG encoding (untested)
-  QByteArray encodedImage;
-  QBuffer buffer(&encodedImage);
-  buffer.open(QIODevice::Append);
-  monoImage.save(&buffer, "PNG");
-
-  // Hexa-encoded PNG
-  m_printBuffer += QString("~DYR:IMG,P,G,%1,0,").arg(encodedImage.size());
-  for(int i=0; i<encodedImage.size(); i++) {
-    m_printBuffer.append(QString().sprintf("%02X",(unsigned char)encodedImage.at(i)).toUpper());
-  }
-  // OR: B64-encoded PNG
-  m_printBuffer += QString("~DYR:IMG,P,G,%1,0,:B64:").arg(encodedImage.size());
-  encodedImage = encodedImage.toBase64();
-  m_printBuffer.append(encodedImage);
-
-  quint16 icrc = qChecksum(encodedImage.data(), encodedImage.length());
-  m_printBuffer += ":";
-  m_printBuffer.append(QString().sprintf("%02X",icrc));
-  // end of B64 encoding
-*/
-  int width = monoImage.width();
-  int nbOfLines = monoImage.height();
-
-  QByteArray grfImage;
-
-  for(int line=0; line < nbOfLines; line++) {
-    for (int x=0; x<width; x+=8) {
-      uchar imageByte = monoImage.scanLine(line)[x/8];
-      int validPix = width-x;
-      if(validPix<8) { // set out-of-bounds pixels to zero
-        imageByte >>= 8-validPix;
-        imageByte <<= 8-validPix;
-      }
-      grfImage.append(QString().sprintf("%02X",imageByte));
-    }
-  }
 
-  int bytesPerLine = (width+7)/8;
-  m_printBuffer += QString("~DGR:IMG.GRF,%1,%2,").arg(bytesPerLine*nbOfLines).arg(bytesPerLine);
-  m_printBuffer += compressedHexa(grfImage);
+  int bytesPerLine = (monoImage.width()+7)/8;
+  QByteArray grfImage = zebraGrfData(monoImage);
+
+  // every distinct image is downloaded once per job and recalled by name
+  QByteArray key = QByteArray::number(bytesPerLine) + ':' + grfImage;
+  QString name = m_imageNames.value(key);
+  if(name.isEmpty()) {
+    name = QString("R:ORI%1.GRF").arg(m_imageNames.size() + 1, 4, 10, QLatin1Char('0'));
+    m_imageNames.insert(key, name);
 
-  m_printBuffer += "\n";
+    m_printBuffer += QString("~DG%1,%2,%3,").arg(name).arg(grfImage.size()).arg(bytesPerLine);
+    m_printBuffer += (m_z64Images ? zebraZ64(grfImage) : zebraCompressedHexa(zebraHexa(grfImage)));
+    m_printBuffer += "\n";
+  }
 
   QTransform transform = painter()->worldTransform();
 
   int xInDots = (int)(rectangle.top() + transform.dx());
   int yInDots = (int)(rectangle.left() + transform.dy());
 
-  m_printBuffer += QString(m_CmdPrefix + "FO%1,%2" + m_CmdPrefix + "XGR:IMG.GRF,1,1" + m_CmdPrefix + "FS\n").arg(xInDots).arg(yInDots);
+  m_printBuffer += QString(m_CmdPrefix + "FO%1,%2" + m_CmdPrefix + "XG%3,1,1" + m_CmdPrefix + "FS\n").arg(xInDots).arg(yInDots).arg(name);
 }
 
 
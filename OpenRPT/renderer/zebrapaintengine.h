@@ -21,6 +21,7 @@
 #ifndef ZEBRAPAINTENGINE_H
 #define ZEBRAPAINTENGINE_H
 
+#include <QHash>
 #include "labelpaintengine.h"
 #include "reportprinter.h"
 
@@ -30,6 +31,7 @@ public:
   ZebraPaintEngine(ReportPrinter *parentPrinter);
 
   virtual bool 	begin ( QPaintDevice * pdev );
+  virtual bool 	end ();
 
   virtual void 	drawImage ( const QRectF & rectangle, const QImage & image, const QRectF & sr, Qt::ImageConversionFlags flags = Qt::AutoColor );
   virtual void 	drawLines ( const QLineF * lines, int lineCount );
@@ -41,10 +43,19 @@ public:
 protected:
   virtual void  drawBarcode ( const QPointF & p, const QString &format, int height, int width, int narrowBar, QString barcodeData );
   virtual void  drawText ( const QPointF &p, const QString & text, const QFont &font = QFont());
+  virtual QByteArray storeFormatCmds(const QByteArray &header, const QByteArray &fields) const;
+  virtual QByteArray recallFormatCmds() const;
+  virtual bool isStorableField(const QByteArray &field) const;
   virtual QString rotation0Cmd() const { return "N"; }
   virtual QString rotation90Cmd() const { return "R"; }
   virtual QString rotation180Cmd() const { return "I"; }
   virtual QString rotation270Cmd() const { return "B"; }
+
+private:
+  QString storedFormatName() const;
+
+  bool    m_z64Images;
+  QHash<QByteArray, QString> m_imageNames; // images downloaded in this job
 };
 
 #endif // ZEBRAPAINTENGINE_H
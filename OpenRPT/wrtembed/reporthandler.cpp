@@ -1624,6 +1624,7 @@ void ReportHandler::print(bool showPreview)
       return;
 
   pre.setParamList(paramEdit.getParameterList());
+  pre.setSpatialIndex(showPreview); // the preview paints pages by tiles
   ORODocument * doc = pre.generate();
 
   if(doc)
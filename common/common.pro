@@ -47,7 +47,10 @@ SOURCES = data.cpp \
           paramlistedit.cpp \
           parameteredit.cpp \
           parsexmlutils.cpp \
+          parsexmlstream.cpp \
           querysource.cpp \
+          mqlcache.cpp \
+          xsqlquerycache.cpp \
           reportpageoptions.cpp \
           memdbloader.cpp
 
@@ -66,6 +69,8 @@ HEADERS = data.h \
           parameteredit.h \
           parsexmlutils.h \
           querysource.h \
+          mqlcache.h \
+          xsqlquerycache.h \
           reportpageoptions.h \
           memdbloader.h
 
@@ -0,0 +1,141 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "mqlcache.h"
+#include "xsqlquery.h"
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QVariant>
+
+class MQLCacheEntry
+{
+  public:
+    int grade;
+    QString checksum;
+    QString text;
+};
+
+typedef QCache<QString, MQLCacheEntry> MQLEntryCache;
+
+Q_GLOBAL_STATIC_WITH_ARGS(MQLEntryCache, mqlCache, (500))
+Q_GLOBAL_STATIC(QMutex, mqlCacheLock)
+static QAtomicInt mqlCacheEnabled(1);
+
+// the same group and name may hold another statement on another database
+static QString mqlCacheKey(const QSqlDatabase & db, const QString & group, const QString & name)
+{
+  return QString("%1://%2@%3:%4/%5").arg(db.driverName()).arg(db.userName())
+           .arg(db.hostName()).arg(db.port()).arg(db.databaseName())
+         + QChar(0) + group + QChar(0) + name;
+}
+
+QString MQLCache::query(const QString & group, const QString & name, QSqlDatabase db, bool * found)
+{
+  if(found)
+    *found = false;
+  if(!db.isValid())
+    db = QSqlDatabase::database();
+
+  bool enabled = (mqlCacheEnabled.load() != 0) && (db.driverName() == "QPSQL");
+  QString key = mqlCacheKey(db, group, name);
+
+  if(enabled)
+  {
+    XSqlQuery check(db);
+    check.prepare("SELECT metasql_grade, md5(metasql_query) AS metasql_checksum"
+                  "  FROM metasql"
+                  " WHERE ((metasql_group=:group)"
+                  "    AND (metasql_name=:name))"
+                  " ORDER BY metasql_grade DESC"
+                  " LIMIT 1;");
+    check.bindValue(":group", group);
+    check.bindValue(":name", name);
+    if(check.exec())
+    {
+      if(!check.first())
+        return QString::null;
+      int grade = check.value("metasql_grade").toInt();
+      QString checksum = check.value("metasql_checksum").toString();
+
+      QMutexLocker locker(mqlCacheLock());
+      MQLCacheEntry * entry = mqlCache()->object(key);
+      if(entry != 0 && entry->grade == grade && entry->checksum == checksum)
+      {
+        if(found)
+          *found = true;
+        return entry->text;
+      }
+    }
+    else
+      enabled = false;
+  }
+
+  // md5() is PostgreSQL's, elsewhere only the text is read
+  XSqlQuery xqry(db);
+  xqry.prepare(QString("SELECT metasql_query%1"
+                       "  FROM metasql"
+                       " WHERE ((metasql_group=:group)"
+                       "    AND (metasql_name=:name))"
+                       " ORDER BY metasql_grade DESC"
+                       " LIMIT 1;")
+               .arg(enabled ? ", metasql_grade, md5(metasql_query) AS metasql_checksum" : ""));
+  xqry.bindValue(":group", group);
+  xqry.bindValue(":name", name);
+  xqry.exec();
+  if(!xqry.first())
+    return QString::null;
+  if(found)
+    *found = true;
+
+  QString text = xqry.value("metasql_query").toString();
+  if(enabled)
+  {
+    // the grade and checksum of what was actually read
+    MQLCacheEntry * entry = new MQLCacheEntry();
+    entry->grade = xqry.value("metasql_grade").toInt();
+    entry->checksum = xqry.value("metasql_checksum").toString();
+    entry->text = text;
+
+    QMutexLocker locker(mqlCacheLock());
+    mqlCache()->insert(key, entry);
+  }
+  return text;
+}
+
+void MQLCache::clear()
+{
+  QMutexLocker locker(mqlCacheLock());
+  mqlCache()->clear();
+}
+
+bool MQLCache::isEnabled()
+{
+  return mqlCacheEnabled.load() != 0;
+}
+
+void MQLCache::setEnabled(bool enabled)
+{
+  mqlCacheEnabled.store(enabled ? 1 : 0);
+  if(!enabled)
+    clear();
+}
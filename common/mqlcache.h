@@ -0,0 +1,47 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#ifndef __MQLCACHE_H__
+#define __MQLCACHE_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+//
+// MQLCache
+// The named MetaSQL statements of the metasql table, kept per database for
+// the group, name and grade they were read for. On PostgreSQL a use only asks
+// for the newest grade and a checksum of its text, the text itself is sent
+// again when either changed. All the functions are thread safe.
+//
+class MQLCache
+{
+  public:
+    // the text of the newest grade of group/name, null when there is none
+    static QString query(const QString & group, const QString & name,
+                         QSqlDatabase db = QSqlDatabase(), bool * found = 0);
+
+    static void clear();
+
+    static bool isEnabled();
+    static void setEnabled(bool); // default true; false reads on every call
+};
+
+#endif // __MQLCACHE_H__
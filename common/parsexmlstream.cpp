@@ -0,0 +1,1476 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     This file reads report definitions with a QXmlStreamReader, in a
+ * single pass and without building a QDomDocument first. It fills the same
+ * structures as the QDomElement parsers in parsexmlutils.cpp and follows
+ * them function for function; a change to one set belongs in the other.
+ *
+ *     Every function below is called with the reader on the start of its
+ * element and returns with the reader on the end of it.
+ */
+
+#include "parsexmlutils.h"
+#include "reportpageoptions.h"
+#include "memdbloader.h"
+
+#include <QDomDocument>
+#include <QXmlStreamReader>
+
+// the text of the element and all its children, as QDomElement::text()
+static QString elementText(QXmlStreamReader & xml)
+{
+  return xml.readElementText(QXmlStreamReader::IncludeChildElements);
+}
+
+static void notParsed(const char * where, QXmlStreamReader & xml)
+{
+  qDebug("Tag not Parsed at <%s>:%s\n", where, xml.name().toString().toLatin1().data());
+  xml.skipCurrentElement();
+}
+
+static void unknownElement(const char * where, QXmlStreamReader & xml)
+{
+  qDebug("While parsing %s encountered an unknown element: %s", where, xml.name().toString().toLatin1().data());
+  xml.skipCurrentElement();
+}
+
+static QColor parseColor(QXmlStreamReader & xml)
+{
+  QColor res = Qt::black;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "red")
+      res.setRed(elementText(xml).toInt());
+    else if(xml.name() == "green")
+      res.setGreen(elementText(xml).toInt());
+    else if(xml.name() == "blue")
+      res.setBlue(elementText(xml).toInt());
+    else
+      xml.skipCurrentElement();
+  }
+
+  return res;
+}
+
+static bool parseReportRect(QXmlStreamReader & xml, ORRectData & rectTarget)
+{
+  int coorCounter = 0;
+
+  QPen border = rectTarget.border();
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "x")
+    {
+      rectTarget.x = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "y")
+    {
+      rectTarget.y = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "width")
+    {
+      rectTarget.width = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "height")
+    {
+      rectTarget.height = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "weight")
+      border.setWidth(elementText(xml).toInt());
+    else if(xml.name() == "color")
+    {
+      QPen pen = rectTarget.pen();
+      pen.setColor(parseColor(xml));
+      rectTarget.setPen(pen);
+    }
+    else if(xml.name() == "bgcolor")
+    {
+      QBrush brush = rectTarget.brush();
+      brush.setColor(parseColor(xml));
+      brush.setStyle(Qt::SolidPattern);
+      rectTarget.setBrush(brush);
+    }
+    else if(xml.name() == "bordercolor")
+      border.setColor(parseColor(xml));
+    else if(xml.name() == "borderwidth")
+      border.setWidth(elementText(xml).toInt());
+    else if(xml.name() == "borderstyle")
+      border.setStyle(static_cast<Qt::PenStyle>(elementText(xml).toInt()));
+    else if(xml.name() == "rotation")
+      rectTarget.setRotation(elementText(xml).toFloat());
+    else
+      notParsed("line", xml);
+  }
+
+  rectTarget.setBorder(border);
+
+  return (coorCounter == 4);
+}
+
+static bool parseReportRect(QXmlStreamReader & xml, QRect & rectTarget, ORObject & o)
+{
+  ORRectData rData;
+  bool res = parseReportRect(xml, rData);
+  if(res)
+  {
+    rectTarget = QRect(rData.x, rData.y, rData.width, rData.height);
+    o.setPen(rData.pen());
+    o.setBrush(rData.brush());
+    o.setRotation(rData.rotation());
+    o.setBorder(rData.border());
+  }
+  return res;
+}
+
+static bool parseReportRect(QXmlStreamReader & xml, QRect & rectTarget)
+{
+  ORObject o;
+  return parseReportRect(xml, rectTarget, o);
+}
+
+static bool parseReportFont(QXmlStreamReader & xml, QFont & fontTarget)
+{
+  if(xml.name() != "font")
+  {
+    xml.skipCurrentElement();
+    return false;
+  }
+
+  while(xml.readNextStartElement())
+  {
+    int intTemp;
+    bool valid;
+
+    if(xml.name() == "face")
+      fontTarget.setFamily(elementText(xml));
+    else if(xml.name() == "size")
+    {
+      QString text = elementText(xml);
+      intTemp = text.toInt(&valid);
+      if(valid)
+        fontTarget.setPointSize(intTemp);
+      else
+        qDebug("Text not Parsed at <font>:%s\n", text.toLatin1().data());
+    }
+    else if(xml.name() == "weight")
+    {
+      QString text = elementText(xml);
+      if(text == "normal")
+        fontTarget.setWeight(50);
+      else if(text == "bold")
+        fontTarget.setWeight(75);
+      else
+      {
+        // a value between 1 and 100
+        intTemp = text.toInt(&valid);
+        if(valid && intTemp >= 1 && intTemp <= 100)
+          fontTarget.setWeight(intTemp);
+        else
+          qDebug("Text not Parsed at <font>:%s\n", text.toLatin1().data());
+      }
+    }
+    else if(xml.name() == "italic")
+    {
+      fontTarget.setItalic(true);
+      xml.skipCurrentElement();
+    }
+    else
+      notParsed("font", xml);
+  }
+  return true;
+}
+
+static bool parseReportData(QXmlStreamReader & xml, ORDataData & dataTarget)
+{
+  bool valid_query = false;
+  bool valid_column = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "query")
+    {
+      dataTarget.query = elementText(xml);
+      valid_query = true;
+    }
+    else if(xml.name() == "column")
+    {
+      dataTarget.column = elementText(xml);
+      valid_column = true;
+    }
+    else
+      notParsed("data", xml);
+  }
+
+  return (valid_query && valid_column);
+}
+
+static bool parseReportKey(QXmlStreamReader & xml, ORKeyData & dataTarget)
+{
+  bool valid_query = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "query")
+    {
+      dataTarget.query = elementText(xml);
+      valid_query = true;
+    }
+    else if(xml.name() == "column")
+      dataTarget.column = elementText(xml);
+    else
+      notParsed("key", xml);
+  }
+
+  return valid_query;
+}
+
+static bool parseReportLine(QXmlStreamReader & xml, ORLineData & lineTarget)
+{
+  int coorCounter = 0;
+  QPen pen(Qt::black, 0);
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "xstart")
+    {
+      lineTarget.xStart = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "ystart")
+    {
+      lineTarget.yStart = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "xend")
+    {
+      lineTarget.xEnd = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "yend")
+    {
+      lineTarget.yEnd = (int)elementText(xml).toDouble();
+      coorCounter++;
+    }
+    else if(xml.name() == "weight")
+      pen.setWidth(elementText(xml).toInt());
+    else if(xml.name() == "style")
+      pen.setStyle(static_cast<Qt::PenStyle>(elementText(xml).toInt()));
+    else if(xml.name() == "color")
+      pen.setColor(parseColor(xml));
+    else
+      notParsed("line", xml);
+  }
+
+  lineTarget.setPen(pen);
+
+  return (coorCounter == 4);
+}
+
+// the alignment flags shared by labels, fields and text; false if the
+// element is not one of them
+static bool parseAlignment(QXmlStreamReader & xml, int & align)
+{
+  int flag = 0;
+  if(xml.name() == "left")
+    flag = Qt::AlignLeft;
+  else if(xml.name() == "right")
+    flag = Qt::AlignRight;
+  else if(xml.name() == "vcenter")
+    flag = Qt::AlignVCenter;
+  else if(xml.name() == "hcenter")
+    flag = Qt::AlignHCenter;
+  else if(xml.name() == "top")
+    flag = Qt::AlignTop;
+  else if(xml.name() == "bottom")
+    flag = Qt::AlignBottom;
+  else
+    return false;
+
+  align |= flag;
+  xml.skipCurrentElement();
+  return true;
+}
+
+static bool parseReportLabel(QXmlStreamReader & xml, ORLabelData & labelTarget)
+{
+  bool valid_rect = false;
+  bool valid_string = false;
+
+  labelTarget.align = 0;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "rect")
+      valid_rect = parseReportRect(xml, labelTarget.rect, labelTarget);
+    else if(xml.name() == "font")
+      parseReportFont(xml, labelTarget.font);
+    else if(xml.name() == "string")
+    {
+      labelTarget.string = elementText(xml);
+      valid_string = true;
+    }
+    else if(!parseAlignment(xml, labelTarget.align))
+      notParsed("label", xml);
+  }
+
+  return (valid_rect && valid_string);
+}
+
+static bool parseReportField(QXmlStreamReader & xml, ORFieldData & fieldTarget)
+{
+  bool valid_rect = false;
+  bool valid_data = false;
+
+  fieldTarget.align = 0;
+  fieldTarget.trackTotal = false;
+  fieldTarget.sub_total = false;
+  fieldTarget.builtinFormat = false;
+  fieldTarget.format = QString::null;
+  fieldTarget.lines = 1;
+  fieldTarget.columns = 1;
+  fieldTarget.xSpacing = 0;
+  fieldTarget.ySpacing = 0;
+  fieldTarget.triggerPageBreak = false;
+  fieldTarget.leftToRight = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "rect")
+      valid_rect = parseReportRect(xml, fieldTarget.rect, fieldTarget);
+    else if(xml.name() == "font")
+      parseReportFont(xml, fieldTarget.font);
+    else if(parseAlignment(xml, fieldTarget.align))
+      ;
+    else if(xml.name() == "wordwrap")
+    {
+      fieldTarget.align |= Qt::TextWordWrap;
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "lines")
+      fieldTarget.lines = elementText(xml).toInt();
+    else if(xml.name() == "columns")
+      fieldTarget.columns = elementText(xml).toInt();
+    else if(xml.name() == "xSpacing")
+      fieldTarget.xSpacing = elementText(xml).toDouble();
+    else if(xml.name() == "ySpacing")
+      fieldTarget.ySpacing = elementText(xml).toDouble();
+    else if(xml.name() == "triggerPageBreak")
+    {
+      fieldTarget.triggerPageBreak = true;
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "leftToRight")
+    {
+      fieldTarget.leftToRight = true;
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "data")
+      valid_data = parseReportData(xml, fieldTarget.data);
+    else if(xml.name() == "format")
+    {
+      fieldTarget.builtinFormat = (xml.attributes().value("builtin") == "true");
+      fieldTarget.format = elementText(xml);
+    }
+    else if(xml.name() == "tracktotal")
+    {
+      // NB for compatibility with reports V <= 3.0 format info is also read from the total tag
+      if(!fieldTarget.builtinFormat)
+        fieldTarget.builtinFormat = (xml.attributes().value("builtin") == "true");
+      fieldTarget.sub_total = (xml.attributes().value("subtotal") == "true");
+      QString text = elementText(xml);
+      if(!text.isEmpty())
+        fieldTarget.format = text;
+      if(!fieldTarget.format.isEmpty())
+        fieldTarget.trackTotal = true;
+    }
+    else
+      notParsed("field", xml);
+  }
+
+  return (valid_rect && valid_data);
+}
+
+static bool parseReportText(QXmlStreamReader & xml, ORTextData & textTarget)
+{
+  bool valid_rect = false;
+  bool valid_data = false;
+
+  textTarget.align = 0;
+  textTarget.bottompad = 0;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "rect")
+      valid_rect = parseReportRect(xml, textTarget.rect, textTarget);
+    else if(xml.name() == "font")
+      parseReportFont(xml, textTarget.font);
+    else if(parseAlignment(xml, textTarget.align))
+      ;
+    else if(xml.name() == "data")
+      valid_data = parseReportData(xml, textTarget.data);
+    else if(xml.name() == "bottompad")
+      textTarget.bottompad = elementText(xml).toInt();
+    else
+      notParsed("text", xml);
+  }
+
+  return (valid_rect && valid_data);
+}
+
+static bool parseReportBarcode(QXmlStreamReader & xml, ORBarcodeData & barcodeTarget)
+{
+  bool valid_rect = false;
+  bool valid_data = false;
+
+  barcodeTarget.format = "3of9";
+  barcodeTarget.align = 0; // left alignment [default]
+  barcodeTarget.narrowBarWidth = ORBarcodeData::defaultNarrowBarWidth();
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "rect")
+      valid_rect = parseReportRect(xml, barcodeTarget.rect, barcodeTarget);
+    else if(xml.name() == "data")
+      valid_data = parseReportData(xml, barcodeTarget.data);
+    else if(xml.name() == "maxlength")
+      barcodeTarget.maxlength = elementText(xml).toInt();
+    else if(xml.name() == "format")
+      barcodeTarget.format = elementText(xml);
+    else if(xml.name() == "left" || xml.name() == "center" || xml.name() == "right")
+    {
+      barcodeTarget.align = (xml.name() == "left" ? 0 : (xml.name() == "center" ? 1 : 2));
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "narrowBarWidth")
+      barcodeTarget.narrowBarWidth = elementText(xml).toDouble();
+    else
+      notParsed("barcode", xml);
+  }
+
+  return (valid_rect && valid_data);
+}
+
+static bool parseReportImage(QXmlStreamReader & xml, ORImageData & imageTarget)
+{
+  bool valid_rect = false;
+  bool valid_data = false;
+  bool valid_inline = false;
+
+  imageTarget.mode = "clip";
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "rect")
+      valid_rect = parseReportRect(xml, imageTarget.rect, imageTarget);
+    else if(xml.name() == "data")
+      valid_data = parseReportData(xml, imageTarget.data);
+    else if(xml.name() == "mode")
+      imageTarget.mode = elementText(xml);
+    else if(xml.name() == "map")
+    {
+      // ok we have an inline image here
+      imageTarget.format = xml.attributes().value("format").toString();
+      imageTarget.inline_data = elementText(xml);
+      valid_inline = true;
+    }
+    else
+      notParsed("image", xml);
+  }
+
+  return (valid_rect && (valid_data || valid_inline));
+}
+
+static bool parseReportColorDefData(QXmlStreamReader & xml, ORColorDefData & coldefTarget)
+{
+  coldefTarget.name = QString::null;
+  coldefTarget.red = coldefTarget.green = coldefTarget.blue = 0;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "name")
+      coldefTarget.name = elementText(xml);
+    else if(xml.name() == "red")
+      coldefTarget.red = elementText(xml).toInt();
+    else if(xml.name() == "green")
+      coldefTarget.green = elementText(xml).toInt();
+    else if(xml.name() == "blue")
+      coldefTarget.blue = elementText(xml).toInt();
+    else
+      unknownElement("colordef", xml);
+  }
+
+  return (coldefTarget.name.length() > 0);
+}
+
+static bool parseReportTitleData(QXmlStreamReader & xml, ORTitleData & titleTarget)
+{
+  titleTarget.string = QString::null;
+  titleTarget.font_defined = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "string")
+      titleTarget.string = elementText(xml);
+    else if(xml.name() == "font")
+      titleTarget.font_defined = parseReportFont(xml, titleTarget.font);
+    else
+      unknownElement("title", xml);
+  }
+
+  return true;
+}
+
+static bool parseReportStyleData(QXmlStreamReader & xml, ORStyleData & styleTarget)
+{
+  styleTarget.bar = styleTarget.line = styleTarget.point = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "bar")
+      styleTarget.bar = true;
+    else if(xml.name() == "line")
+      styleTarget.line = true;
+    else if(xml.name() == "point")
+      styleTarget.point = true;
+    else
+    {
+      unknownElement("title", xml);
+      continue;
+    }
+    xml.skipCurrentElement();
+  }
+
+  return (styleTarget.bar || styleTarget.line || styleTarget.point);
+}
+
+static bool parseReportDataAxisData(QXmlStreamReader & xml, ORDataAxisData & axisTarget)
+{
+  axisTarget.title.string = QString::null;
+  axisTarget.title.font_defined = false;
+  axisTarget.column = QString::null;
+  axisTarget.font_defined = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "title")
+      parseReportTitleData(xml, axisTarget.title);
+    else if(xml.name() == "column")
+      axisTarget.column = elementText(xml);
+    else if(xml.name() == "font")
+      axisTarget.font_defined = parseReportFont(xml, axisTarget.font);
+    else
+      unknownElement("dataaxis", xml);
+  }
+
+  return true;
+}
+
+static bool parseReportValueAxisData(QXmlStreamReader & xml, ORValueAxisData & axisTarget)
+{
+  double ival = 0.0;
+  bool valid = false;
+
+  axisTarget.title.string = QString::null;
+  axisTarget.title.font_defined = false;
+  axisTarget.min = 0.0;
+  axisTarget.max = 100.0;
+  axisTarget.autominmax = true;
+  axisTarget.font_defined = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "title")
+      parseReportTitleData(xml, axisTarget.title);
+    else if(xml.name() == "min")
+    {
+      ival = elementText(xml).toDouble(&valid);
+      if(valid)
+        axisTarget.min = ival;
+    }
+    else if(xml.name() == "max")
+    {
+      ival = elementText(xml).toDouble(&valid);
+      if(valid)
+        axisTarget.max = ival;
+    }
+    else if(xml.name() == "autominmax")
+    {
+      QString amn = elementText(xml).toLower();
+      axisTarget.autominmax = (amn == "t" || amn == "true" || amn == "");
+    }
+    else if(xml.name() == "font")
+      axisTarget.font_defined = parseReportFont(xml, axisTarget.font);
+    else
+      unknownElement("valueaxis", xml);
+  }
+
+  return true;
+}
+
+static bool parseReportSeriesData(QXmlStreamReader & xml, ORSeriesData & seriesTarget)
+{
+  seriesTarget.name = QString::null;
+  seriesTarget.color = QString::null;
+  seriesTarget.column = QString::null;
+  seriesTarget.style.bar = true;
+  seriesTarget.style.line = false;
+  seriesTarget.style.point = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "name")
+      seriesTarget.name = elementText(xml);
+    else if(xml.name() == "color")
+      seriesTarget.color = elementText(xml);
+    else if(xml.name() == "column")
+      seriesTarget.column = elementText(xml);
+    else if(xml.name() == "style")
+    {
+      if(!parseReportStyleData(xml, seriesTarget.style))
+      {
+        seriesTarget.style.bar = true;
+        seriesTarget.style.line = false;
+        seriesTarget.style.point = false;
+      }
+    }
+    else
+      unknownElement("series", xml);
+  }
+
+  return (seriesTarget.name.length() > 0 &&
+          seriesTarget.color.length() > 0 &&
+          seriesTarget.column.length() > 0);
+}
+
+static bool parseReportGraphData(QXmlStreamReader & xml, ORGraphData & graphTarget)
+{
+  bool have_data = false;
+  bool have_rect = false;
+  bool have_series = false;
+
+  graphTarget.title.string = QString::null;
+  graphTarget.dataaxis.title.string = QString::null;
+  graphTarget.dataaxis.title.font_defined = false;
+  graphTarget.dataaxis.column = QString::null;
+  graphTarget.dataaxis.font_defined = false;
+  graphTarget.valueaxis.title.string = QString::null;
+  graphTarget.valueaxis.min = 0;
+  graphTarget.valueaxis.max = 100;
+  graphTarget.valueaxis.autominmax = true;
+  graphTarget.valueaxis.font_defined = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "data")
+      have_data = parseReportData(xml, graphTarget.data);
+    else if(xml.name() == "font")
+      parseReportFont(xml, graphTarget.font);
+    else if(xml.name() == "rect")
+      have_rect = parseReportRect(xml, graphTarget.rect);
+    else if(xml.name() == "title")
+      parseReportTitleData(xml, graphTarget.title);
+    else if(xml.name() == "dataaxis")
+    {
+      if(!parseReportDataAxisData(xml, graphTarget.dataaxis))
+      {
+        graphTarget.dataaxis.title.string = QString::null;
+        graphTarget.dataaxis.title.font_defined = false;
+        graphTarget.dataaxis.column = QString::null;
+        graphTarget.dataaxis.font_defined = false;
+      }
+    }
+    else if(xml.name() == "valueaxis")
+    {
+      if(!parseReportValueAxisData(xml, graphTarget.valueaxis))
+      {
+        graphTarget.valueaxis.title.string = QString::null;
+        graphTarget.valueaxis.min = 0;
+        graphTarget.valueaxis.max = 100;
+        graphTarget.valueaxis.autominmax = true;
+        graphTarget.valueaxis.font_defined = false;
+      }
+    }
+    else if(xml.name() == "series")
+    {
+      ORSeriesData * orsd = new ORSeriesData();
+      if(parseReportSeriesData(xml, *orsd))
+      {
+        graphTarget.series.append(orsd);
+        have_series = true;
+      }
+      else
+        delete orsd;
+    }
+    else
+      unknownElement("graph", xml);
+  }
+
+  return (have_data && have_rect && have_series);
+}
+
+static bool parseReportCrossTabElementData(QXmlStreamReader & xml, ORCrossTabQueryData & queryData)
+{
+  queryData.m_query  = QString::null;
+  queryData.m_hAlign = QString::null;
+  queryData.m_vAlign = QString::null;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "queryColumn")
+      queryData.m_query = elementText(xml);
+    else if(xml.name() == "HAlign")
+      queryData.m_hAlign = elementText(xml);
+    else if(xml.name() == "VAlign")
+      queryData.m_vAlign = elementText(xml);
+    else
+      unknownElement("CrossTab Element data", xml);
+  }
+
+  return true;
+}
+
+static bool parseReportTable(QXmlStreamReader & xml, ORCrossTabTablePropertiesData & queryData)
+{
+  queryData.m_cellLeftMargin = 0.00;
+  queryData.m_cellRightMargin = 0.00;
+  queryData.m_cellTopMargin = 0.00;
+  queryData.m_cellBottomMargin = 0.00;
+  queryData.m_showColumnHeaderOnEachPart = true;
+  queryData.m_showRowHeaderOnEachPart    = true;
+  queryData.m_wrapPolicyColumnsFirst     = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "wrappolicy")
+      queryData.m_wrapPolicyColumnsFirst = ("columns" == elementText(xml));
+    else if(xml.name() == "showcolumnheaderagain")
+      queryData.m_showColumnHeaderOnEachPart = ("yes" == elementText(xml));
+    else if(xml.name() == "showrowheaderagain")
+      queryData.m_showRowHeaderOnEachPart = ("yes" == elementText(xml));
+    else if(xml.name() == "CellMargins")
+    {
+      double l = 0.0;
+      double r = 0.0;
+      double t = 0.0;
+      double b = 0.0;
+      while(xml.readNextStartElement())
+      {
+        if(xml.name() == "Left")
+          l = elementText(xml).toDouble();
+        else if(xml.name() == "Right")
+          r = elementText(xml).toDouble();
+        else if(xml.name() == "Top")
+          t = elementText(xml).toDouble();
+        else if(xml.name() == "Bottom")
+          b = elementText(xml).toDouble();
+        else
+          unknownElement("cell margins", xml);
+      }
+      queryData.m_cellLeftMargin = l;
+      queryData.m_cellRightMargin = r;
+      queryData.m_cellTopMargin = t;
+      queryData.m_cellBottomMargin = b;
+    }
+    else
+      unknownElement("CrossTab table", xml);
+  }
+
+  return true;
+}
+
+static bool parseReportCrossTabData(QXmlStreamReader & xml, ORCrossTabData & crossTabTarget)
+{
+  bool have_rect  = false;
+  bool have_font  = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "data")
+    {
+      // the column of the data is not used, this always returns false
+      (void)parseReportData(xml, crossTabTarget.data);
+    }
+    else if(xml.name() == "font")
+      have_font = parseReportFont(xml, crossTabTarget.font);
+    else if(xml.name() == "rect")
+      have_rect = parseReportRect(xml, crossTabTarget.rect, crossTabTarget);
+    else if(xml.name() == "table")
+      parseReportTable(xml, crossTabTarget.m_tableProperties);
+    else if(xml.name() == "column")
+      parseReportCrossTabElementData(xml, crossTabTarget.m_column);
+    else if(xml.name() == "row")
+      parseReportCrossTabElementData(xml, crossTabTarget.m_row);
+    else if(xml.name() == "value")
+      parseReportCrossTabElementData(xml, crossTabTarget.m_value);
+    else
+      unknownElement("graph", xml);
+  }
+
+  return (have_rect && have_font);
+}
+
+static bool parseReportBackground(QXmlStreamReader & xml, ORBackgroundData & bgTarget)
+{
+  bgTarget.enabled = false;
+  bgTarget.staticImage = true;
+  bgTarget.image = QString::null;
+  bgTarget.data.query = QString::null;
+  bgTarget.data.column = QString::null;
+  bgTarget.opacity = 25;
+  bgTarget.mode = "clip";
+  bgTarget.rect = QRect();
+
+  int halign = Qt::AlignLeft;
+  int valign = Qt::AlignTop;
+  bool valid_rect = true;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "image")
+      bgTarget.image = elementText(xml);
+    else if(xml.name() == "mode")
+      bgTarget.mode = elementText(xml);
+    else if(xml.name() == "data")
+      bgTarget.staticImage = !parseReportData(xml, bgTarget.data);
+    else if(xml.name() == "rect")
+      valid_rect = parseReportRect(xml, bgTarget.rect);
+    else if(xml.name() == "opacity")
+    {
+      bool valid = false;
+      int i = elementText(xml).toInt(&valid);
+      if(valid)
+        bgTarget.opacity = qBound(0, i, 255);
+    }
+    else
+    {
+      if(xml.name() == "left")
+        halign = Qt::AlignLeft;
+      else if(xml.name() == "hcenter")
+        halign = Qt::AlignHCenter;
+      else if(xml.name() == "right")
+        halign = Qt::AlignRight;
+      else if(xml.name() == "top")
+        valign = Qt::AlignTop;
+      else if(xml.name() == "vcenter")
+        valign = Qt::AlignVCenter;
+      else if(xml.name() == "bottom")
+        valign = Qt::AlignBottom;
+      else
+      {
+        unknownElement("background", xml);
+        continue;
+      }
+      xml.skipCurrentElement();
+    }
+  }
+
+  bgTarget.align = halign | valign;
+  bgTarget.enabled = (valid_rect && ((bgTarget.staticImage && !bgTarget.image.isEmpty())
+                       || (!bgTarget.staticImage && !bgTarget.data.query.isEmpty()
+                                                 && !bgTarget.data.column.isEmpty())));
+  return bgTarget.enabled;
+}
+
+static bool parseReportWatermark(QXmlStreamReader & xml, ORWatermarkData & wmTarget)
+{
+  wmTarget.text = QString::null;
+  wmTarget.opacity = 25;
+  wmTarget.staticText = true;
+  wmTarget.useDefaultFont = true;
+  wmTarget.valid = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "text")
+      wmTarget.text = elementText(xml);
+    else if(xml.name() == "data")
+      wmTarget.staticText = !parseReportData(xml, wmTarget.data);
+    else if(xml.name() == "font")
+      wmTarget.useDefaultFont = !parseReportFont(xml, wmTarget.font);
+    else if(xml.name() == "opacity")
+    {
+      bool valid = false;
+      int i = elementText(xml).toInt(&valid);
+      if(valid)
+        wmTarget.opacity = qBound(0, i, 255);
+    }
+    else
+      unknownElement("watermark", xml);
+  }
+
+  wmTarget.valid = ((wmTarget.staticText && !wmTarget.text.isEmpty())
+                     || (!wmTarget.staticText && !wmTarget.data.query.isEmpty()
+                                              && !wmTarget.data.column.isEmpty()));
+
+  return wmTarget.valid;
+}
+
+// the key of a detail section is read here if asked for, the DOM parser
+// looks it up on its own
+static bool parseReportSection(QXmlStreamReader & xml, ORSectionData & sectionTarget,
+                               ORKeyData * key = 0, bool * have_key = 0)
+{
+  sectionTarget.name = xml.name().toString();
+
+  if(sectionTarget.name != "rpthead" && sectionTarget.name != "rptfoot" &&
+     sectionTarget.name != "pghead" && sectionTarget.name != "pgfoot" &&
+     sectionTarget.name != "grouphead" && sectionTarget.name != "groupfoot" &&
+     sectionTarget.name != "head" && sectionTarget.name != "foot" &&
+     sectionTarget.name != "detail" )
+  {
+    xml.skipCurrentElement();
+    return false;
+  }
+
+  sectionTarget.extra = QString::null;
+  sectionTarget.height = 0.0;
+
+  bool pageSection = (sectionTarget.name == "pghead" || sectionTarget.name == "pgfoot");
+  bool key_read = false;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "height")
+    {
+      bool valid;
+      qreal height = elementText(xml).toDouble(&valid);
+      if(valid)
+        sectionTarget.height = height;
+    }
+    else if(xml.name() == "firstpage" || xml.name() == "odd" ||
+            xml.name() == "even" || xml.name() == "lastpage")
+    {
+      if(pageSection)
+        sectionTarget.extra = xml.name().toString();
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "label")
+    {
+      ORLabelData * label = new ORLabelData();
+      if(parseReportLabel(xml, *label))
+        sectionTarget.objects.append(label);
+      else
+        delete label;
+    }
+    else if(xml.name() == "field")
+    {
+      ORFieldData * field = new ORFieldData();
+      if(parseReportField(xml, *field))
+      {
+        sectionTarget.objects.append(field);
+        if(field->trackTotal)
+          sectionTarget.trackTotal.append(field->data);
+      }
+      else
+        delete field;
+    }
+    else if(xml.name() == "text")
+    {
+      ORTextData * text = new ORTextData();
+      if(parseReportText(xml, *text))
+        sectionTarget.objects.append(text);
+      else
+        delete text;
+    }
+    else if(xml.name() == "line")
+    {
+      ORLineData * line = new ORLineData();
+      if(parseReportLine(xml, *line))
+        sectionTarget.objects.append(line);
+      else
+        delete line;
+    }
+    else if(xml.name() == "rect")
+    {
+      ORRectData * rect = new ORRectData();
+      if(parseReportRect(xml, *rect))
+      {
+        // to maintain compatibility with older version that don't support borders,
+        // for which rect border color is recorded in the "pen" element
+        QPen borderPen = rect->border();
+        borderPen.setColor(rect->pen().color());
+        rect->setBorder(borderPen);
+
+        sectionTarget.objects.prepend(rect);
+      }
+      else
+        delete rect;
+    }
+    else if(xml.name() == "barcode")
+    {
+      ORBarcodeData * bc = new ORBarcodeData();
+      if(parseReportBarcode(xml, *bc))
+        sectionTarget.objects.append(bc);
+      else
+        delete bc;
+    }
+    else if(xml.name() == "image")
+    {
+      ORImageData * img = new ORImageData();
+      if(parseReportImage(xml, *img))
+        sectionTarget.objects.prepend(img);
+      else
+        delete img;
+    }
+    else if(xml.name() == "graph")
+    {
+      ORGraphData * graph = new ORGraphData();
+      if(parseReportGraphData(xml, *graph))
+        sectionTarget.objects.append(graph);
+      else
+        delete graph;
+    }
+    else if(xml.name() == "crosstab")
+    {
+      ORCrossTabData * crossTab = new ORCrossTabData();
+      if(parseReportCrossTabData(xml, *crossTab))
+        sectionTarget.objects.append(crossTab);
+      else
+        delete crossTab;
+    }
+    else if(xml.name() == "key")
+    {
+      // like QDomNode::namedItem() only the first key counts
+      if(key != 0 && have_key != 0 && !key_read)
+      {
+        *have_key = parseReportKey(xml, *key);
+        key_read = true;
+      }
+      else
+        xml.skipCurrentElement();
+    }
+    else
+      unknownElement("section", xml);
+  }
+  return true;
+}
+
+static ORSectionData * parseGroupSection(QXmlStreamReader & xml, QList<ORDataData> & trackTotal,
+                                         ORDetailGroupSectionData * dgsd = 0)
+{
+  ORSectionData * sd = new ORSectionData();
+  if(!parseReportSection(xml, *sd))
+  {
+    delete sd;
+    return 0;
+  }
+
+  trackTotal += sd->trackTotal;
+  if(dgsd != 0)
+  {
+    for(int it = 0; it < sd->trackTotal.count(); ++it)
+      dgsd->_subtotCheckPoints[sd->trackTotal.at(it)] = 0.0;
+  }
+  return sd;
+}
+
+static bool parseReportDetailSection(QXmlStreamReader & xml, ORDetailSectionData & sectionTarget)
+{
+  bool have_name = false;
+  bool have_detail = false;
+  bool have_key = false;
+
+  ORSectionData * old_head = 0;
+  ORSectionData * old_foot = 0;
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "name")
+    {
+      sectionTarget.name = elementText(xml);
+      have_name = true;
+    }
+    else if(xml.name() == "pagebreak")
+    {
+      if(xml.attributes().value("when") == "at end")
+        sectionTarget.pagebreak = ORDetailSectionData::BreakAtEnd;
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "grouphead")
+    {
+      if(ORSectionData * sd = parseGroupSection(xml, sectionTarget.trackTotal))
+        old_head = sd;
+    }
+    else if(xml.name() == "groupfoot")
+    {
+      if(ORSectionData * sd = parseGroupSection(xml, sectionTarget.trackTotal))
+        old_foot = sd;
+    }
+    else if(xml.name() == "group")
+    {
+      ORDetailGroupSectionData * dgsd = new ORDetailGroupSectionData();
+      while(xml.readNextStartElement())
+      {
+        if(xml.name() == "name")
+          dgsd->name = elementText(xml);
+        else if(xml.name() == "column")
+          dgsd->column = elementText(xml);
+        else if(xml.name() == "pagebreak")
+        {
+          if(xml.attributes().value("when") == "after foot")
+            dgsd->pagebreak = ORDetailGroupSectionData::BreakAfterGroupFoot;
+          xml.skipCurrentElement();
+        }
+        else if(xml.name() == "head")
+        {
+          if(ORSectionData * sd = parseGroupSection(xml, sectionTarget.trackTotal, dgsd))
+            dgsd->head = sd;
+        }
+        else if(xml.name() == "foot")
+        {
+          if(ORSectionData * sd = parseGroupSection(xml, sectionTarget.trackTotal, dgsd))
+            dgsd->foot = sd;
+        }
+        else
+          unknownElement("group section", xml);
+      }
+      sectionTarget.groupList.append(dgsd);
+    }
+    else if(xml.name() == "detail")
+    {
+      ORSectionData * sd = new ORSectionData();
+      if(parseReportSection(xml, *sd, &sectionTarget.key, &have_key))
+      {
+        sectionTarget.detail = sd;
+        sectionTarget.trackTotal += sd->trackTotal;
+        have_detail = true;
+      }
+      else
+        delete sd;
+    }
+    else
+      unknownElement("detail section", xml);
+  }
+  if(old_head || old_foot)
+  {
+    ORDetailGroupSectionData * gsec = new ORDetailGroupSectionData();
+    gsec->name = sectionTarget.name;
+    gsec->column = sectionTarget.key.column;
+    gsec->head = old_head;
+    gsec->foot = old_foot;
+    sectionTarget.groupList.append(gsec);
+  }
+  return (have_name && have_detail && have_key);
+}
+
+static bool parseReportParameter(QXmlStreamReader & xml, ORReportData & reportTarget)
+{
+  ORParameter param;
+
+  QXmlStreamAttributes attributes = xml.attributes();
+  param.name = attributes.value("name").toString();
+  if(param.name.isEmpty())
+  {
+    xml.skipCurrentElement();
+    return false;
+  }
+
+  param.type = attributes.value("type").toString();
+  param.defaultValue  = attributes.value("default").toString();
+  param.listtype = attributes.value("listtype").toString();
+  param.active = (attributes.value("active") == "true");
+  if(param.listtype.isEmpty())
+    param.description = elementText(xml);
+  else
+  {
+    while(xml.readNextStartElement())
+    {
+      if(xml.name() == "description")
+        param.description = elementText(xml);
+      else if(xml.name() == "query")
+        param.query = elementText(xml);
+      else if(xml.name() == "item")
+      {
+        QString value = xml.attributes().value("value").toString();
+        param.values.append(qMakePair(value, elementText(xml)));
+      }
+      else
+        unknownElement("parameter", xml);
+    }
+  }
+
+  reportTarget.definedParams.insert(param.name, param);
+
+  return true;
+}
+
+// <size> holds either the name of a page size or a custom width and height
+static void parseReportSize(QXmlStreamReader & xml, ReportPageOptions & page)
+{
+  QString text;
+  QStringList names;
+  QList<double> values;
+
+  while(!xml.atEnd())
+  {
+    xml.readNext();
+    if(xml.isEndElement())
+      break;
+    if(xml.isCharacters() && !xml.isWhitespace())
+    {
+      if(names.isEmpty())
+        text += xml.text();
+    }
+    else if(xml.isStartElement())
+    {
+      names.append(xml.name().toString());
+      values.append(elementText(xml).toDouble());
+    }
+  }
+
+  if(!text.isEmpty() && names.isEmpty())
+    page.setPageSize(text);
+  else
+  {
+    // as the DOM parser: the first child is taken for the width if it says
+    // so and for the height otherwise
+    double first = values.value(0);
+    double second = values.value(1);
+    if(names.value(0) == "width")
+    {
+      page.setCustomWidth(first / 100.0);
+      page.setCustomHeight(second / 100.0);
+    }
+    else
+    {
+      page.setCustomWidth(second / 100.0);
+      page.setCustomHeight(first / 100.0);
+    }
+    page.setPageSize("Custom");
+  }
+}
+
+// MemDbLoader reads a QDomElement; a <database> element is rare enough to
+// build one for it
+static void readDomChildren(QXmlStreamReader & xml, QDomDocument & doc, QDomNode parent)
+{
+  while(!xml.atEnd())
+  {
+    xml.readNext();
+    if(xml.isEndElement())
+      return;
+    if(xml.isStartElement())
+    {
+      QDomElement elem = doc.createElement(xml.name().toString());
+      QXmlStreamAttributes attributes = xml.attributes();
+      for(int i = 0; i < attributes.size(); i++)
+        elem.setAttribute(attributes.at(i).name().toString(), attributes.at(i).value().toString());
+      parent.appendChild(elem);
+      readDomChildren(xml, doc, elem);
+    }
+    else if(xml.isCDATA())
+      parent.appendChild(doc.createCDATASection(xml.text().toString()));
+    else if(xml.isCharacters() && !xml.isWhitespace())
+      parent.appendChild(doc.createTextNode(xml.text().toString()));
+  }
+}
+
+static double parseMargin(QXmlStreamReader & xml)
+{
+  bool valid = false;
+  QString text = elementText(xml);
+  double d = text.toDouble(&valid);
+  if(!valid || d < 0.0)
+  {
+    qDebug("Error converting %s value: %s", xml.name().toString().toLatin1().data(), text.toLatin1().data());
+    d = 50.0;
+  }
+  return d / 100.0;
+}
+
+static void addPageSection(ORSectionData * sd, ORSectionData *& first, ORSectionData *& odd,
+                           ORSectionData *& even, ORSectionData *& last, ORSectionData *& any)
+{
+  if(sd->extra == "firstpage")
+    first = sd;
+  else if(sd->extra == "odd")
+    odd = sd;
+  else if(sd->extra == "even")
+    even = sd;
+  else if(sd->extra == "lastpage")
+    last = sd;
+  else if(sd->extra.isNull())
+    any = sd;
+  else
+  {
+    qDebug("don't know which page this page section is for: %s", sd->extra.toLatin1().data());
+    delete sd;
+  }
+}
+
+bool parseReport(QXmlStreamReader & xml, ORReportData & reportTarget, QSqlDatabase db, bool * loadedData)
+{
+  if(loadedData)
+    *loadedData = false;
+
+  if(!xml.isStartElement() && !xml.readNextStartElement())
+  {
+    qDebug("No element to parse in parseReport()");
+    return false;
+  }
+  if(xml.name() != "report")
+  {
+    qDebug("Element passed to parseReport() was not <report> tag");
+    return false;
+  }
+
+  while(xml.readNextStartElement())
+  {
+    if(xml.name() == "title")
+      reportTarget.title = elementText(xml);
+    else if(xml.name() == "name")
+      reportTarget.name = elementText(xml);
+    else if(xml.name() == "description")
+      reportTarget.description = elementText(xml);
+    else if(xml.name() == "parameter")
+      parseReportParameter(xml, reportTarget);
+    else if(xml.name() == "watermark")
+      parseReportWatermark(xml, reportTarget.wmData);
+    else if(xml.name() == "background")
+      parseReportBackground(xml, reportTarget.bgData);
+    else if(xml.name() == "size")
+      parseReportSize(xml, reportTarget.page);
+    else if(xml.name() == "labeltype")
+      reportTarget.page.setLabelType(elementText(xml));
+    else if(xml.name() == "portrait" || xml.name() == "landscape")
+    {
+      reportTarget.page.setPortrait(xml.name() == "portrait");
+      xml.skipCurrentElement();
+    }
+    else if(xml.name() == "topmargin")
+      reportTarget.page.setMarginTop(parseMargin(xml));
+    else if(xml.name() == "bottommargin")
+      reportTarget.page.setMarginBottom(parseMargin(xml));
+    else if(xml.name() == "leftmargin")
+      reportTarget.page.setMarginLeft(parseMargin(xml));
+    else if(xml.name() == "rightmargin")
+      reportTarget.page.setMarginRight(parseMargin(xml));
+    else if(xml.name() == "querysource")
+    {
+      bool qsloadfromdb = (xml.attributes().value("loadFromDb") == "true");
+      QString qsname;
+      QString qsquery;
+      QString qsmgroup;
+      QString qsmname;
+      // only the first of each counts, as with QDomNode::namedItem()
+      while(xml.readNextStartElement())
+      {
+        QString * target = 0;
+        if(xml.name() == "name")
+          target = &qsname;
+        else if(xml.name() == "sql")
+          target = &qsquery;
+        else if(xml.name() == "mqlgroup")
+          target = &qsmgroup;
+        else if(xml.name() == "mqlname")
+          target = &qsmname;
+
+        if(target != 0 && target->isNull())
+          *target = elementText(xml);
+        else
+          xml.skipCurrentElement();
+      }
+      reportTarget.queries.add(new QuerySource(qsname, qsquery, qsloadfromdb, qsmgroup, qsmname));
+    }
+    else if(xml.name() == "rpthead" || xml.name() == "rptfoot")
+    {
+      ORSectionData * sd = new ORSectionData();
+      if(parseReportSection(xml, *sd))
+      {
+        if(sd->name == "rpthead")
+          reportTarget.rpthead = sd;
+        else
+          reportTarget.rptfoot = sd;
+        reportTarget.trackTotal += sd->trackTotal;
+      }
+      else
+        delete sd;
+    }
+    else if(xml.name() == "pghead" || xml.name() == "pgfoot")
+    {
+      ORSectionData * sd = new ORSectionData();
+      if(parseReportSection(xml, *sd))
+      {
+        reportTarget.trackTotal += sd->trackTotal;
+        if(sd->name == "pghead")
+          addPageSection(sd, reportTarget.pghead_first, reportTarget.pghead_odd, reportTarget.pghead_even,
+                         reportTarget.pghead_last, reportTarget.pghead_any);
+        else
+          addPageSection(sd, reportTarget.pgfoot_first, reportTarget.pgfoot_odd, reportTarget.pgfoot_even,
+                         reportTarget.pgfoot_last, reportTarget.pgfoot_any);
+      }
+      else
+        delete sd;
+    }
+    else if(xml.name() == "section")
+    {
+      ORDetailSectionData * dsd = new ORDetailSectionData();
+      if(parseReportDetailSection(xml, *dsd))
+      {
+        reportTarget.sections.append(dsd);
+        reportTarget.trackTotal += dsd->trackTotal;
+      }
+      else
+        delete dsd;
+    }
+    else if(xml.name() == "colordef")
+    {
+      ORColorDefData coldef;
+      if(parseReportColorDefData(xml, coldef))
+        reportTarget.color_map[coldef.name] = QColor(coldef.red, coldef.green, coldef.blue);
+    }
+    else if(xml.name() == "database")
+    {
+      QDomDocument doc;
+      QDomElement elem = doc.createElement("database");
+      doc.appendChild(elem);
+      readDomChildren(xml, doc, elem);
+
+      MemDbLoader mdb;
+      if(!mdb.load(elem, db))
+        qDebug("%s", mdb.lastError().toLatin1().data());
+      if(loadedData)
+        *loadedData = true;
+    }
+    else if(xml.name() == "grid")
+    {
+      // Do nothing. This is used by the OpenRPT designer itself and we can ignore it here.
+      xml.skipCurrentElement();
+    }
+    else
+      unknownElement("report", xml);
+  }
+
+  if(xml.hasError())
+  {
+    qDebug("Error parsing the report at line %d column %d: %s", (int)xml.lineNumber(),
+           (int)xml.columnNumber(), xml.errorString().toLatin1().data());
+    return false;
+  }
+  return true;
+}
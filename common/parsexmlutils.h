@@ -31,6 +31,7 @@
 // forward declarations
 class QDomElement;
 class QDomNode;
+class QXmlStreamReader;
 
 #include "querysource.h"
 #include "reportpageoptions.h"
@@ -584,4 +585,9 @@ bool parseReport(const QDomElement &, ORReportData &, QSqlDatabase db);
 
 bool parseReportParameter(const QDomElement &, ORReportData &);
 
+// the same in one pass over the source, without a QDomDocument, see
+// parsexmlstream.cpp; loadedData is set when a <database> element was
+// loaded into db
+bool parseReport(QXmlStreamReader &, ORReportData &, QSqlDatabase db, bool * loadedData = 0);
+
 #endif
@@ -19,7 +19,7 @@
  */
 
 #include "querysource.h"
-#include "xsqlquery.h"
+#include "mqlcache.h"
 
 #include <QVariant>
 
@@ -116,20 +116,7 @@ void QuerySource::updated()
 QString QuerySource::query(const QSqlDatabase & db) const
 {
   if(_loadFromDb)
-  {
-    XSqlQuery xqry(db);
-    xqry.prepare("SELECT metasql_query"
-                 "  FROM metasql"
-                 " WHERE ((metasql_group=:group)"
-                 "    AND (metasql_name=:name))"
-                 " ORDER BY metasql_grade DESC"
-                 " LIMIT 1;");
-    xqry.bindValue(":group", _mqlGroup);
-    xqry.bindValue(":name", _mqlName);
-    xqry.exec();
-    xqry.first();
-    return xqry.value(0).toString();
-  }
+    return MQLCache::query(_mqlGroup, _mqlName, db);
 
   return query();
 }
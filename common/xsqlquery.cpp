@@ -25,8 +25,11 @@
 #include <QSqlDriver>
 #include <QSqlResult>
 #include <QCursor>
-#include <QApplication>
+#include <QGuiApplication>
 #include <QMap>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QThread>
 
 #include "xsqlquery.h"
 
@@ -70,6 +73,7 @@ public:
     _fieldSubTotals = p._fieldSubTotals;
     _currRecord = p._currRecord;
     _keepTotals = p._keepTotals;
+    _lease = p._lease;
     return *this;
   }
 
@@ -80,19 +84,56 @@ public:
 
   QSqlRecord    _currRecord;
   bool          _keepTotals;
+
+  QSharedPointer<int> _lease;
 };
 
+//
+// XSqlWaitCursor
+// Shows the wait cursor while a query runs. The cursor belongs to the GUI
+// thread, so queries run by other threads or in a process without a GUI
+// leave it alone.
+//
+class XSqlWaitCursor
+{
+  public:
+    XSqlWaitCursor() : _set(false)
+    {
+      QCoreApplication * app = QCoreApplication::instance();
+      if(qobject_cast<QGuiApplication*>(app) && QThread::currentThread() == app->thread())
+      {
+        QGuiApplication::setOverrideCursor(QCursor(Qt::WaitCursor));
+        _set = true;
+      }
+    }
+    ~XSqlWaitCursor()
+    {
+      if(_set)
+        QGuiApplication::restoreOverrideCursor();
+    }
+
+  private:
+    bool _set;
+};
+
+// queries may run on several threads at once, the statics below are only
+// touched with their lock held. The listeners are called on a copy of the
+// list taken under the lock, so that they can add or remove listeners
+// without deadlocking or making the loop skip one
 static QList<XSqlQueryErrorListener*> _errorListeners;
+static QMutex _errorListenersLock;
 
 static void notifyErrorListeners(XSqlQuery * source)
 {
   if(!source)
     return;
 
-  XSqlQueryErrorListener * listener = 0;
-  for(int i = 0; i < _errorListeners.size(); i++)
+  _errorListenersLock.lock();
+  QList<XSqlQueryErrorListener*> listeners = _errorListeners;
+  _errorListenersLock.unlock();
+
+  foreach(XSqlQueryErrorListener * listener, listeners)
   {
-    listener = _errorListeners.at(i);
     if(listener)
       listener->error(source->executedQuery(), source->lastError());
   }
@@ -107,9 +148,11 @@ XSqlQueryErrorListener::~XSqlQueryErrorListener()
 
 
 static QString _nameErrorValue;
+static QMutex _nameErrorValueLock;
 
 void XSqlQuery::setNameErrorValue(QString v)
 {
+    QMutexLocker locker(&_nameErrorValueLock);
     _nameErrorValue = v;
 }
 
@@ -136,9 +179,8 @@ XSqlQuery::XSqlQuery(const QString &pSql, QSqlDatabase db) :
   QSqlQuery(QString::null, db)
 {
   _data = new XSqlQueryPrivate(this);
-  qApp->setOverrideCursor(Qt::WaitCursor);
+  XSqlWaitCursor wait;
   exec(pSql.toLatin1().data());
-  qApp->restoreOverrideCursor();
 }
 
 XSqlQuery::XSqlQuery(const QSqlQuery & other) :
@@ -200,6 +242,7 @@ QVariant XSqlQuery::value(const QString & name) const
         {
             QString err = "Column " + name + " not found in record";
             qWarning("%s", err.toLocal8Bit().constData());
+            QMutexLocker locker(&_nameErrorValueLock);
             return QVariant(_nameErrorValue);
         }
         return value(_data->_currRecord.indexOf(name));
@@ -220,23 +263,23 @@ int XSqlQuery::count()
 
 bool XSqlQuery::exec()
 {
-  qApp->setOverrideCursor(Qt::WaitCursor);
   bool returnValue = false;
-
-  if(_data && _data->_emulatePrepare)
   {
+    XSqlWaitCursor wait;
+    if(_data && _data->_emulatePrepare)
+    {
 // In 4.4.1 Qt started supporting true prepared queries on the PostgreSQL driver and this
 // caused several problems with all our code and the way it worked so this is a modified copy
 // of their code to use the implemented prepare if we have that option set so we can use the method
 // that works best in the case we are using it for.
-    if (lastError().isValid())
-      ((XSqlResultHelper*)result())->setLastError(QSqlError());
+      if (lastError().isValid())
+        ((XSqlResultHelper*)result())->setLastError(QSqlError());
 
-    returnValue = ((XSqlResultHelper*)result())->XSqlResultHelper::exec();
+      returnValue = ((XSqlResultHelper*)result())->XSqlResultHelper::exec();
+    }
+    else
+      returnValue = QSqlQuery::exec();
   }
-  else
-    returnValue = QSqlQuery::exec();
-  qApp->restoreOverrideCursor();
 
   if (_data)
     _data->_currRecord = record();
@@ -249,9 +292,11 @@ bool XSqlQuery::exec()
 
 bool XSqlQuery::exec(const QString &pSql)
 {
-  qApp->setOverrideCursor(Qt::WaitCursor);
-  bool returnValue = QSqlQuery::exec(pSql);
-  qApp->restoreOverrideCursor();
+  bool returnValue;
+  {
+    XSqlWaitCursor wait;
+    returnValue = QSqlQuery::exec(pSql);
+  }
 
   if (_data)
     _data->_currRecord = record();
@@ -265,6 +310,13 @@ bool XSqlQuery::exec(const QString &pSql)
 bool XSqlQuery::prepare(const QString &pSql)
 {
   bool ret;
+  if(_data && !_data->_lease.isNull() && driver())
+  {
+    // the statement stays as XSqlQueryCache prepared it, this query gets
+    // one of its own
+    XSqlQuery own(driver()->createResult());
+    *this = own;
+  }
   if(_data && _data->_emulatePrepare)
   {
 // In 4.4.1 Qt started supporting true prepared queries on the PostgreSQL driver and this
@@ -420,6 +472,12 @@ double XSqlQuery::getFieldSubTotal(QString & fld)
   return 0.0;
 }
 
+void XSqlQuery::setLease(const QSharedPointer<int> & lease)
+{
+  if (_data)
+    _data->_lease = lease;
+}
+
 void XSqlQuery::resetSubTotals()
 {
   if (_data)
@@ -495,12 +553,14 @@ int XSqlQuery::findFirst(const QString &pField, const QString &pTarget)
 
 void XSqlQuery::addErrorListener(XSqlQueryErrorListener* listener)
 {
+  QMutexLocker locker(&_errorListenersLock);
   if(!_errorListeners.contains(listener))
     _errorListeners.append(listener);
 }
 
 void XSqlQuery::removeErrorListener(XSqlQueryErrorListener* listener)
 {
+  QMutexLocker locker(&_errorListenersLock);
   int i = _errorListeners.indexOf(listener);
   while(-1 != i)
   {
@@ -21,12 +21,20 @@
 #ifndef __XSQLQUERY_H__
 #define __XSQLQUERY_H__
 
+#include <QSharedPointer>
 #include <QSqlQuery>
 
 class XSqlQueryPrivate;
 class QSqlError;
 
 
+//
+// XSqlQueryErrorListener
+// error() is called on the thread of the query that failed, which may be
+// any thread, without any lock held. A listener may add or remove
+// listeners from error(), but it has to stay alive until no query can
+// still fail on another thread.
+//
 class XSqlQueryErrorListener {
   public:
     XSqlQueryErrorListener();
@@ -34,6 +42,12 @@ class XSqlQueryErrorListener {
     virtual void error(const QString &, const QSqlError&) = 0;
 };
 
+//
+// XSqlQuery is reentrant like QSqlQuery: queries on the connections of
+// different threads may run at the same time. The error listeners and the
+// name error value are shared by all threads and may be changed from any
+// of them. The wait cursor is only shown for queries run by the GUI thread.
+//
 class XSqlQuery : public QSqlQuery
 {
   public:
@@ -79,6 +93,10 @@ class XSqlQuery : public QSqlQuery
     static void setNameErrorValue(QString v);
 
   private:
+    friend class XSqlQueryCache;
+    // marks a statement of XSqlQueryCache as in use by this query and its copies
+    void setLease(const QSharedPointer<int> &);
+
     XSqlQueryPrivate * _data;
 };
 
@@ -0,0 +1,272 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#include "xsqlquerycache.h"
+
+#include <QAtomicInt>
+#include <QCache>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSqlDriver>
+#include <QSqlError>
+#include <QVariant>
+
+// ends the use of a statement; its rows are let go once the last query that
+// could read them is gone, the statement itself stays prepared
+class XSqlQueryLeaseEnd
+{
+  public:
+    XSqlQueryLeaseEnd(const QSqlQuery & query) : _query(query) {}
+
+    void operator()(int * lease)
+    {
+      delete lease;
+      _query.finish();
+    }
+
+  private:
+    QSqlQuery _query;
+};
+
+class XSqlQueryCacheEntry
+{
+  public:
+    XSqlQueryCacheEntry() : emulated(false), retryAfter(-1) {}
+
+    XSqlQuery query;
+    QWeakPointer<int> lease;
+    bool emulated;  // the server did not take it
+    int  retryAfter; // uses until the server is asked again, -1 for never
+};
+
+class XSqlQueryConnection
+{
+  public:
+    XSqlQueryConnection(int g, int maxCount) : generation(g), statements(maxCount) {}
+
+    int generation;
+    QCache<QString, XSqlQueryCacheEntry> statements;
+};
+
+typedef QHash<QString, XSqlQueryConnection*> XSqlQueryConnectionMap;
+
+Q_GLOBAL_STATIC(XSqlQueryConnectionMap, xsqlQueryCache)
+Q_GLOBAL_STATIC(QMutex, xsqlQueryCacheLock)
+static QAtomicInt xsqlQueryCacheEnabled(0);
+static QAtomicInt xsqlQueryCacheMaxCount(100);
+static QAtomicInt xsqlQueryCacheHits(0);
+static QAtomicInt xsqlQueryCacheMisses(0);
+static QAtomicInt xsqlQueryCacheGenerations(0);
+
+// an emulated text is prepared by the server again after this many uses,
+// in case what it tripped on was the state of the connection
+static const int xsqlQueryEmulatedUses = 100;
+
+static const char * const xsqlQueryGenerationProperty = "_xsqlQueryCacheGeneration";
+
+// the session the statements of a connection belong to: a number the
+// driver of the connection is given the first time it is seen, which
+// clear() takes back. A driver made by addDatabase() after the connection
+// of that name was removed starts without one.
+static int connectionGeneration(const QSqlDatabase & db)
+{
+  QSqlDriver * driver = db.driver();
+  int generation = driver->property(xsqlQueryGenerationProperty).toInt();
+  if(generation == 0)
+  {
+    generation = xsqlQueryCacheGenerations.fetchAndAddOrdered(1) + 1;
+    driver->setProperty(xsqlQueryGenerationProperty, generation);
+  }
+  return generation;
+}
+
+// the server refuses the text itself, it will every time: more than one
+// statement or a syntax it does not take, or parameters it can not type
+static bool isStatementError(const QSqlError & error)
+{
+  QString code = error.nativeErrorCode();
+  return code == "42601" || code == "42P18";
+}
+
+XSqlQuery XSqlQueryCache::prepare(const QString & sql, QSqlDatabase db, bool * prepared)
+{
+  if(!db.isValid())
+    db = QSqlDatabase::database();
+
+  bool enabled = (xsqlQueryCacheEnabled.load() != 0) && db.isOpen()
+              && db.driver()->hasFeature(QSqlDriver::PreparedQueries);
+  if(!enabled)
+  {
+    XSqlQuery query(db);
+    bool ok = query.prepare(sql);
+    if(prepared)
+      *prepared = ok;
+    return query;
+  }
+
+  QString name = db.connectionName();
+  int generation = connectionGeneration(db);
+  {
+    QMutexLocker locker(xsqlQueryCacheLock());
+    XSqlQueryConnection * connection = xsqlQueryCache()->value(name);
+    if(connection != 0 && connection->generation != generation)
+    {
+      // another connection of the same name, the statements went with the old one
+      xsqlQueryCache()->remove(name);
+      delete connection;
+      connection = 0;
+    }
+
+    XSqlQueryCacheEntry * entry = (connection ? connection->statements.object(sql) : 0);
+    if(entry != 0 && entry->emulated && entry->retryAfter == 0)
+    {
+      connection->statements.remove(sql);
+      entry = 0;
+    }
+    if(entry != 0 && entry->emulated)
+    {
+      if(entry->retryAfter > 0)
+        entry->retryAfter--;
+      xsqlQueryCacheMisses.ref();
+      locker.unlock();
+      XSqlQuery query(db);
+      bool ok = query.prepare(sql);
+      if(prepared)
+        *prepared = ok;
+      return query;
+    }
+    else if(entry != 0 && entry->lease.isNull())
+    {
+      XSqlQuery query(entry->query);
+      QSharedPointer<int> lease(new int(0), XSqlQueryLeaseEnd(entry->query));
+      entry->lease = lease;
+      query.setLease(lease);
+
+      xsqlQueryCacheHits.ref();
+      if(prepared)
+        *prepared = true;
+      return query;
+    }
+    xsqlQueryCacheMisses.ref();
+  }
+
+  // prepared by the server, where XSqlQuery would only emulate it
+  XSqlQuery query(db);
+  query.setEmulatePrepare(false);
+  bool emulated = !query.prepare(sql);
+  bool ok = true;
+  bool permanent = false;
+  if(emulated)
+  {
+    permanent = isStatementError(query.lastError());
+    query = XSqlQuery(db);
+    ok = query.prepare(sql);
+  }
+  if(prepared)
+    *prepared = ok;
+
+  // a text still in use by another query is not kept twice
+  QMutexLocker locker(xsqlQueryCacheLock());
+  XSqlQueryConnection *& connection = (*xsqlQueryCache())[name];
+  if(connection == 0)
+    connection = new XSqlQueryConnection(generation, xsqlQueryCacheMaxCount.load());
+  if(ok && connection->generation == generation && !connection->statements.contains(sql))
+  {
+    XSqlQueryCacheEntry * entry = new XSqlQueryCacheEntry();
+    entry->emulated = emulated;
+    if(emulated && !permanent)
+      entry->retryAfter = xsqlQueryEmulatedUses;
+    if(!emulated)
+    {
+      entry->query = query;
+      QSharedPointer<int> lease(new int(0), XSqlQueryLeaseEnd(query));
+      entry->lease = lease;
+      query.setLease(lease);
+    }
+    connection->statements.insert(sql, entry);
+  }
+  return query;
+}
+
+void XSqlQueryCache::clear()
+{
+  QMutexLocker locker(xsqlQueryCacheLock());
+  qDeleteAll(*xsqlQueryCache());
+  xsqlQueryCache()->clear();
+}
+
+void XSqlQueryCache::clear(const QSqlDatabase & db)
+{
+  // the next statements belong to another session
+  if(db.driver())
+    db.driver()->setProperty(xsqlQueryGenerationProperty, QVariant());
+
+  QMutexLocker locker(xsqlQueryCacheLock());
+  delete xsqlQueryCache()->take(db.connectionName());
+}
+
+void XSqlQueryCache::close(QSqlDatabase & db)
+{
+  clear(db);
+  db.close();
+}
+
+int XSqlQueryCache::hits()
+{
+  return xsqlQueryCacheHits.load();
+}
+
+int XSqlQueryCache::misses()
+{
+  return xsqlQueryCacheMisses.load();
+}
+
+void XSqlQueryCache::resetCounters()
+{
+  xsqlQueryCacheHits.store(0);
+  xsqlQueryCacheMisses.store(0);
+}
+
+int XSqlQueryCache::maxCount()
+{
+  return xsqlQueryCacheMaxCount.load();
+}
+
+void XSqlQueryCache::setMaxCount(int maxCount)
+{
+  xsqlQueryCacheMaxCount.store(maxCount);
+
+  QMutexLocker locker(xsqlQueryCacheLock());
+  foreach(XSqlQueryConnection * connection, *xsqlQueryCache())
+    connection->statements.setMaxCost(maxCount);
+}
+
+bool XSqlQueryCache::isEnabled()
+{
+  return xsqlQueryCacheEnabled.load() != 0;
+}
+
+void XSqlQueryCache::setEnabled(bool enabled)
+{
+  xsqlQueryCacheEnabled.store(enabled ? 1 : 0);
+  if(!enabled)
+    clear();
+}
@@ -0,0 +1,68 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#ifndef __XSQLQUERYCACHE_H__
+#define __XSQLQUERYCACHE_H__
+
+#include <QSqlDatabase>
+#include <QString>
+
+#include "xsqlquery.h"
+
+//
+// XSqlQueryCache
+// Statements prepared by the server, kept per connection for their SQL text
+// so running the same text again only binds the new values and executes
+// the plan the server already has. Each connection keeps at most maxCount()
+// of them, the least recently used go first.
+// A statement is handed to one query at a time: while a query made from it,
+// or a copy of that query, is still around the same text gets a statement
+// of its own. Text the server can not prepare is prepared the way XSqlQuery
+// does it instead: from then on when the text is at fault, more than one
+// statement for example, otherwise for the next 100 uses. On PostgreSQL
+// such a failure aborts a transaction the connection is in, so the cache
+// is for connections that do not run reports in one.
+// The statements belong to the session of the connection. Close it with
+// close(), or clear() it before closing or removing it, from the thread that
+// uses it. The cache is disabled until setEnabled(true).
+//
+class XSqlQueryCache
+{
+  public:
+    // a query with sql prepared on db, for its values to be bound and exec()'d
+    static XSqlQuery prepare(const QString & sql, QSqlDatabase db = QSqlDatabase(), bool * prepared = 0);
+
+    static void clear();
+    static void clear(const QSqlDatabase &);
+    static void close(QSqlDatabase &); // clear() then close the connection
+
+    // the statements reused and the ones prepared anew since the last reset
+    static int hits();
+    static int misses();
+    static void resetCounters();
+
+    static int maxCount();
+    static void setMaxCount(int); // per connection, default 100
+
+    static bool isEnabled();
+    static void setEnabled(bool); // default false
+};
+
+#endif // __XSQLQUERYCACHE_H__
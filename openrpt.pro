@@ -35,9 +35,15 @@ SUBDIRS = common \
           OpenRPT/wrtembed \
           OpenRPT/writer \
           OpenRPT/renderapp \
+          OpenRPT/renderbatch \
           OpenRPT/import \
           OpenRPT/import_gui \
           OpenRPT/export
 
 CONFIG += ordered
 
+
+# the checks and benchmarks under tests, built with qmake CONFIG+=openrpt_tests
+openrpt_tests {
+  SUBDIRS += tests
+}
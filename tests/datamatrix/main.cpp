@@ -0,0 +1,188 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     datamatrix draws DataMatrix symbols with renderCodeDatamatrix(), the
+ * first time encoded and the second time from the cache, and decodes both
+ * images again with libdmtx. They are also compared pixel by pixel with the
+ * same symbol drawn one drawRect() per dark module, the way it was drawn
+ * before the modules were cached.
+ *     datamatrix [iterations]
+ */
+
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStringList>
+#include <string.h>
+
+#include <parsexmlutils.h>
+#include <renderobjects.h>
+#include <barcodes.h>
+#include <dmtx.h>
+#include <testutils.h>
+
+static const int moduleSize = 4;
+static const int margin = 5 * moduleSize;
+
+static QImage blankImage(const DmtxInfos & infos)
+{
+  // the symbol is drawn from the bottom of the rectangle down one module
+  QImage image(infos.xSize * moduleSize + 2 * margin, infos.ySize * moduleSize + 2 * margin + moduleSize, QImage::Format_RGB888);
+  image.fill(Qt::white);
+  return image;
+}
+
+static QRectF symbolRect(const DmtxInfos & infos)
+{
+  return QRectF(margin, margin, infos.xSize * moduleSize, infos.ySize * moduleSize);
+}
+
+static QImage renderSymbol(const QString & format, const QString & data)
+{
+  DmtxInfos infos = extractInfosDtmx(format);
+  QImage image = blankImage(infos);
+
+  ORObject object;
+  OROBarcode bc(&object);
+  bc.setFormat(format);
+  bc.setData(data);
+
+  QPainter painter(&image);
+  renderCodeDatamatrix(&painter, symbolRect(infos), data, &bc);
+  painter.end();
+  return image;
+}
+
+// one square per dark module, read from the encoder image
+static QImage referenceSymbol(const QString & format, const QString & data)
+{
+  DmtxInfos infos = extractInfosDtmx(format);
+  QImage image = blankImage(infos);
+
+  DmtxEncode *enc = dmtxEncodeCreate();
+  enc->sizeIdxRequest = infos.type;
+  enc->marginSize = 0;
+  enc->moduleSize = 1;
+  QByteArray bytes = data.toLatin1();
+  if(dmtxEncodeDataMatrix(enc, bytes.size(), (unsigned char*)bytes.data()) == DmtxPass)
+  {
+    QRectF r = symbolRect(infos);
+    int width = dmtxImageGetProp(enc->image, DmtxPropWidth);
+    int height = dmtxImageGetProp(enc->image, DmtxPropHeight);
+    qreal pas = qMin(r.width() / width, r.height() / height);
+
+    QPainter painter(&image);
+    painter.setPen(Qt::NoPen);
+    painter.setBrush(Qt::black);
+    int valeur = 0;
+    for(int y = 0; y < height; y++)
+      for(int x = 0; x < width; x++)
+      {
+        dmtxImageGetPixelValue(enc->image, x, y, 0, &valeur);
+        if(valeur == 0)
+          painter.drawRect(QRectF(r.left() + x * pas, r.bottom() - y * pas, pas, pas));
+      }
+    painter.end();
+  }
+  dmtxEncodeDestroy(&enc);
+  return image;
+}
+
+// libdmtx wants the rows packed, QImage pads them to 32 bits
+static QByteArray decodeSymbol(const QImage & image)
+{
+  int rowBytes = image.width() * 3;
+  QByteArray pixels(rowBytes * image.height(), Qt::Uninitialized);
+  for(int y = 0; y < image.height(); y++)
+    memcpy(pixels.data() + y * rowBytes, image.constScanLine(y), rowBytes);
+
+  QByteArray result;
+  DmtxImage *img = dmtxImageCreate((unsigned char*)pixels.data(), image.width(), image.height(), DmtxPack24bppRGB);
+  DmtxDecode *dec = dmtxDecodeCreate(img, 1);
+  DmtxRegion *reg = dmtxRegionFindNext(dec, NULL);
+  if(reg != NULL)
+  {
+    DmtxMessage *msg = dmtxDecodeMatrixRegion(dec, reg, DmtxUndefined);
+    if(msg != NULL)
+    {
+      result = QByteArray((const char*)msg->output, msg->outputIdx);
+      dmtxMessageDestroy(&msg);
+    }
+    dmtxRegionDestroy(&reg);
+  }
+  dmtxDecodeDestroy(&dec);
+  dmtxImageDestroy(&img);
+  return result;
+}
+
+int main(int argc, char *argv[])
+{
+  QGuiApplication app(argc, argv);
+
+  int iterations = 200;
+  if(app.arguments().size() > 1)
+    iterations = qMax(1, app.arguments().at(1).toInt());
+
+  QStringList formats;
+  formats << "datamatrix_4_L" << "datamatrix_9_L" << "datamatrix_15_L"
+          << "datamatrix_25_L" << "datamatrix_27_L";
+  QStringList values;
+  values << "30Q324343430794<OQQ" << "SO-10042/3" << "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+  bool ok = true;
+  foreach(QString format, formats)
+  {
+    foreach(QString value, values)
+    {
+      QString name = format + " " + value;
+      DmtxInfos infos = extractInfosDtmx(format);
+      if(value.size() > infos.xSize * infos.ySize / 24)
+        continue; // more than the symbol holds
+
+      QImage encoded = renderSymbol(format, value);
+      QImage cached = renderSymbol(format, value);
+      QImage reference = referenceSymbol(format, value);
+
+      ok &= check(decodeSymbol(encoded) == value.toLatin1(), name + " decoded");
+      ok &= check(cached == encoded, name + " from the cache");
+      ok &= check(encoded == reference, name + " same pixels as one square per module");
+    }
+  }
+
+  QString format = "datamatrix_15_L";
+  QString value = values.at(2);
+  QElapsedTimer timer;
+  timer.start();
+  for(int i = 0; i < iterations; i++)
+    referenceSymbol(format, value);
+  qint64 before = timer.nsecsElapsed();
+
+  timer.restart();
+  for(int i = 0; i < iterations; i++)
+    renderSymbol(format, value);
+  qint64 after = timer.nsecsElapsed();
+
+  out << format << ": one square per module " << before / iterations / 1000 << " us, "
+      << "cached runs " << after / iterations / 1000 << " us" << endl;
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,144 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     metasqllist times MetaSQLQuery::toQuery() on a foreach over a list
+ * parameter of 1,000 to 10,000 ids, with and without other parameters
+ * ahead of it in the ParameterList, and runs the statements on an SQLite
+ * table of the same ids to check that each one selects the whole list.
+ * The same list is also expanded with MetaSQLInfoDefault. The time per
+ * element should stay about the same as the list grows; the times of
+ * toQuery() include SQLite preparing the statement.
+ *     metasqllist [iterations]
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+
+#include <metasql.h>
+#include <metasqlqueryparser.h>
+#include <parameter.h>
+#include <testutils.h>
+
+// literal() writes the ids into the text, a bound value each would go past
+// the number of variables SQLite takes
+static const char * listQuery =
+  "SELECT COUNT(*) FROM item\n"
+  " WHERE item_id IN (\n"
+  "<? foreach(\"item_ids\") ?>\n"
+  "  <? if not isfirst(\"item_ids\") ?>,<? endif ?>\n"
+  "  <? literal(\"item_ids\") ?>\n"
+  "<? endforeach ?>\n"
+  " )\n"
+  "<? if exists(\"item_active\") ?>\n"
+  "   AND item_active = <? value(\"item_active\") ?>\n"
+  "<? endif ?>;";
+
+static int rowCount(MetaSQLQuery & mql, const ParameterList & params, QSqlDatabase db)
+{
+  XSqlQuery qry = mql.toQuery(params, db);
+  if(!qry.first())
+    return -1;
+  return qry.value(0).toInt();
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  int iterations = 20;
+  if(app.arguments().size() > 1)
+    iterations = qMax(1, app.arguments().at(1).toInt());
+
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(":memory:");
+  bool ok = check(db.open(), "SQLite database");
+  QSqlQuery q(db);
+  ok = ok && check(q.exec("CREATE TABLE item (item_id INTEGER, item_active INTEGER)"), "item table");
+  ok = ok && db.transaction();
+  q.prepare("INSERT INTO item VALUES (?, 1)");
+  for(int i = 0; ok && i < 10000; i++)
+  {
+    q.addBindValue(i);
+    ok = q.exec();
+  }
+  if(!check(ok && db.commit(), "item rows"))
+    return 1;
+
+  MetaSQLQuery mql(listQuery);
+  if(!check(mql.isValid(), "the statement parses: " + mql.parseLog()))
+    return 1;
+
+  int sizes[] = { 1000, 2500, 5000, 10000 };
+  for(unsigned s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+  {
+    int size = sizes[s];
+    QVariantList ids;
+    std::vector<std::string> idStrings;
+    for(int i = 0; i < size; i++)
+    {
+      ids.append(i);
+      idStrings.push_back(QByteArray::number(i).constData());
+    }
+
+    // the list last, behind parameters the lookups have to get past
+    ParameterList params;
+    for(int p = 0; p < 50; p++)
+      params.append(QString("other_%1").arg(p), p);
+    params.append("item_active", 1);
+    params.append("item_ids", ids);
+
+    ok &= check(rowCount(mql, params, db) == size, QString("%1 ids all selected").arg(size));
+
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < iterations; i++)
+      mql.toQuery(params, db, false);
+    qint64 qtTime = timer.nsecsElapsed() / iterations;
+
+    MetaSQLQueryParser parser;
+    parser.parse_query(listQuery);
+    MetaSQLInfoDefault mif;
+    mif.setList("item_ids", idStrings);
+    std::string expanded = parser.populate(&mif);
+    ok &= check(expanded.find(QByteArray::number(size - 1).constData()) != std::string::npos &&
+                expanded.find("item_active") == std::string::npos,
+                QString("%1 ids expanded with MetaSQLInfoDefault").arg(size));
+
+    timer.restart();
+    for(int i = 0; i < iterations; i++)
+    {
+      MetaSQLInfoDefault info;
+      info.setList("item_ids", idStrings);
+      parser.populate(&info);
+    }
+    qint64 defaultTime = timer.nsecsElapsed() / iterations;
+
+    out << size << " ids: toQuery " << qtTime / 1000 << " us ("
+        << qtTime / size << " ns per id), MetaSQLInfoDefault "
+        << defaultTime / 1000 << " us (" << defaultTime / size << " ns per id)" << endl;
+  }
+
+  return ok ? 0 : 1;
+}
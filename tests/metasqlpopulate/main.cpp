@@ -0,0 +1,189 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     metasqlpopulate times MetaSQLQueryParser::populate() on a generated
+ * statement of about 2,000 lines, the size of the larger MRP queries: a
+ * chunk per planned item with if/elseif/else blocks, a foreach over a
+ * list, bound values and comments. The statement is parsed once and
+ * populated repeatedly with MetaSQLInfoDefault, whose output is compared
+ * against the text the chunks should expand to. MetaSQLQuery::toQuery()
+ * is timed on the same statement and run on an SQLite table to check the
+ * number of rows it selects.
+ *     metasqlpopulate [iterations]
+ */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QRegExp>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QVariant>
+
+#include <metasql.h>
+#include <metasqlqueryparser.h>
+#include <parameter.h>
+#include <testutils.h>
+
+static const int chunks = 125;
+static const int listSize = 10;
+static const int otherValue = 5000;
+
+// even chunks have their flag set and select row i, odd ones fall through
+// to the elseif on a value no row has
+static QString generatedQuery()
+{
+  QString chunk =
+    "-- chunk %1: planned orders for item %1\n"
+    "<? if exists(\"flag_%1\") ?>\n"
+    "    OR (t.a = <? value(\"a_%1\") ?>\n"
+    "        AND t.b IN (\n"
+    "  <? foreach(\"list\") ?>\n"
+    "          <? if not isfirst(\"list\") ?>,<? endif ?>\n"
+    "          <? literal(\"list\") ?>\n"
+    "  <? endforeach ?>\n"
+    "        ))\n"
+    "<? elseif exists(\"other\") ?>\n"
+    "    /* nothing planned for %1 */\n"
+    "    OR t.a = <? value(\"other\") ?>\n"
+    "<? else ?>\n"
+    "    OR t.a = -1\n"
+    "<? endif ?>\n"
+    "-- end of chunk %1\n";
+
+  QString query = "SELECT COUNT(*) FROM t\n"
+                  " WHERE 1 = 0\n";
+  for(int i = 0; i < chunks; i++)
+    query += chunk.arg(i);
+  return query + ";";
+}
+
+static QString expectedText()
+{
+  QString list;
+  for(int v = 0; v < listSize; v++)
+    list += (v ? "," : "") + QString::number(v);
+
+  QString text = "SELECTCOUNT(*)FROMtWHERE1=0";
+  for(int i = 0; i < chunks; i++)
+  {
+    if(i % 2 == 0)
+      text += QString("OR(t.a='%1'ANDt.bIN(%2))").arg(i).arg(list);
+    else
+      text += QString("ORt.a='%1'").arg(otherValue);
+  }
+  return text + ";";
+}
+
+static QString withoutSpace(const std::string & str)
+{
+  QString s = QString::fromStdString(str);
+  s.remove(QRegExp("\\s"));
+  return s;
+}
+
+int main(int argc, char *argv[])
+{
+  QCoreApplication app(argc, argv);
+
+  int iterations = 50;
+  if(app.arguments().size() > 1)
+    iterations = qMax(1, app.arguments().at(1).toInt());
+
+  QString query = generatedQuery();
+  std::string source = query.toStdString();
+  out << query.count('\n') + 1 << " lines, " << source.size() << " bytes" << endl;
+
+  QElapsedTimer timer;
+  timer.start();
+  MetaSQLQueryParser parser;
+  bool ok = check(parser.parse_query(source), "the statement parses: " +
+                  QString::fromStdString(parser.errors()));
+  qint64 parseTime = timer.nsecsElapsed();
+  if(!ok)
+    return 1;
+
+  std::vector<std::string> list;
+  for(int v = 0; v < listSize; v++)
+    list.push_back(QByteArray::number(v).constData());
+
+  MetaSQLInfoDefault mif;
+  for(int i = 0; i < chunks; i += 2)
+  {
+    mif.setValue(QString("flag_%1").arg(i).toStdString(), "1");
+    mif.setValue(QString("a_%1").arg(i).toStdString(), QByteArray::number(i).constData());
+  }
+  mif.setValue("other", QByteArray::number(otherValue).constData());
+  mif.setList("list", list);
+
+  std::string expanded = parser.populate(&mif);
+  ok &= check(withoutSpace(expanded) == expectedText(),
+              "MetaSQLInfoDefault expands every chunk");
+
+  timer.restart();
+  for(int i = 0; i < iterations; i++)
+    parser.populate(&mif);
+  qint64 populateTime = timer.nsecsElapsed() / iterations;
+
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(":memory:");
+  ok &= check(db.open(), "SQLite database");
+  QSqlQuery q(db);
+  ok = ok && check(q.exec("CREATE TABLE t (a INTEGER, b INTEGER)"), "t table");
+  q.prepare("INSERT INTO t VALUES (?, ?)");
+  for(int i = 0; ok && i < chunks; i++)
+  {
+    q.addBindValue(i);
+    q.addBindValue(i % listSize);
+    ok = check(q.exec(), "t rows");
+  }
+  if(!ok)
+    return 1;
+
+  ParameterList params;
+  QVariantList values;
+  for(int v = 0; v < listSize; v++)
+    values.append(v);
+  for(int i = 0; i < chunks; i += 2)
+  {
+    params.append(QString("flag_%1").arg(i), true);
+    params.append(QString("a_%1").arg(i), i);
+  }
+  params.append("other", otherValue);
+  params.append("list", values);
+
+  MetaSQLQuery mql(query);
+  ok &= check(mql.isValid(), "MetaSQLQuery parses: " + mql.parseLog());
+  XSqlQuery qry = mql.toQuery(params, db);
+  ok &= check(qry.first() && qry.value(0).toInt() == (chunks + 1) / 2,
+              "toQuery selects one row per flagged chunk");
+
+  timer.restart();
+  for(int i = 0; i < iterations; i++)
+    mql.toQuery(params, db, false);
+  qint64 queryTime = timer.nsecsElapsed() / iterations;
+
+  out << "parse " << parseTime / 1000 << " us, populate "
+      << populateTime / 1000 << " us (" << populateTime / chunks
+      << " ns per chunk), toQuery " << queryTime / 1000 << " us" << endl;
+
+  return ok ? 0 : 1;
+}
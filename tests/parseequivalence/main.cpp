@@ -0,0 +1,144 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     parseequivalence parses report definitions both with the QDomDocument
+ * parser and with the QXmlStreamReader one, writes both results with
+ * ORCompiledReport::write() and checks that the bytes are the same. With no
+ * file given it goes through OpenRPT/data/*.xml. The <database> elements are
+ * taken out first, they load data rather than describe the report.
+ *     It also times both parsers.
+ *     parseequivalence [-iterations=#] [report.xml ...]
+ */
+
+#include <QBuffer>
+#include <QDir>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QGuiApplication>
+#include <QRegExp>
+#include <QStringList>
+
+#include <orcompiledreport.h>
+#include <orreportcache.h>
+#include <testutils.h>
+
+static QByteArray written(ORReportDefinitionPtr definition, const QString & source, QString & error)
+{
+  QBuffer buffer;
+  buffer.open(QIODevice::WriteOnly);
+  if(!ORCompiledReport::write(&buffer, *definition, source, &error))
+    return QByteArray();
+  return buffer.data();
+}
+
+static bool compare(const QString & fileName, int iterations)
+{
+  QString name = QFileInfo(fileName).fileName();
+  QFile file(fileName);
+  if(!file.open(QIODevice::ReadOnly))
+    return check(false, "could not open " + fileName);
+
+  QString source = QString::fromUtf8(file.readAll());
+  QRegExp database("<database>.*</database>");
+  database.setMinimal(true);
+  source.remove(database);
+
+  QDomDocument doc;
+  if(!check(doc.setContent(source), name + " is well formed"))
+    return false;
+
+  ORReportDefinitionPtr fromDom = ORReportDefinition::parse(doc);
+  ORReportDefinitionPtr fromStream = ORReportDefinition::parse(source);
+  if(!check(fromDom->isValid() == fromStream->isValid(), name + " valid with both parsers"))
+    return false;
+  if(!fromDom->isValid())
+  {
+    out << name << ": not a valid report with either parser" << endl;
+    return true;
+  }
+
+  QString domError;
+  QString streamError;
+  QByteArray domBytes = written(fromDom, source, domError);
+  QByteArray streamBytes = written(fromStream, source, streamError);
+  if(!check(!domBytes.isEmpty(), name + " written from the DOM parser: " + domError) ||
+     !check(!streamBytes.isEmpty(), name + " written from the stream parser: " + streamError))
+    return false;
+
+  int diff = 0;
+  while(diff < domBytes.size() && diff < streamBytes.size() && domBytes.at(diff) == streamBytes.at(diff))
+    diff++;
+  bool ok = check(domBytes == streamBytes, QString("%1 differs at byte %2 of %3")
+                                             .arg(name).arg(diff).arg(domBytes.size()));
+
+  QElapsedTimer timer;
+  timer.start();
+  for(int i = 0; i < iterations; i++)
+  {
+    QDomDocument d;
+    d.setContent(source);
+    ORReportDefinition::parse(d);
+  }
+  qint64 domTime = timer.nsecsElapsed();
+
+  timer.restart();
+  for(int i = 0; i < iterations; i++)
+    ORReportDefinition::parse(source);
+  qint64 streamTime = timer.nsecsElapsed();
+
+  out << name << ": DOM " << domTime / iterations / 1000 << " us, "
+      << "stream " << streamTime / iterations / 1000 << " us" << endl;
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  QGuiApplication app(argc, argv);
+
+  int iterations = 20;
+  QStringList files;
+  QStringList arguments = app.arguments();
+  arguments.removeFirst();
+  foreach(QString argument, arguments)
+  {
+    if(argument.startsWith("-iterations="))
+      iterations = qMax(1, argument.mid(12).toInt());
+    else
+      files << argument;
+  }
+
+  if(files.isEmpty())
+  {
+    QDir data(SOURCE_DIR "/../../OpenRPT/data");
+    foreach(QString name, data.entryList(QStringList() << "*.xml", QDir::Files, QDir::Name))
+      files << data.filePath(name);
+    if(!check(!files.isEmpty(), "no report in " + data.path()))
+      return 1;
+  }
+
+  bool ok = true;
+  foreach(QString fileName, files)
+    ok &= compare(fileName, iterations);
+
+  return ok ? 0 : 1;
+}
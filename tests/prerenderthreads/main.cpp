@@ -0,0 +1,298 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     prerenderthreads lays out reports with ORPreRender on several threads
+ * at once, each thread on its own connection to the same SQLite file, and
+ * checks that every document matches the one the same job gave when run
+ * alone. Half of the runs parse the definition again with setDom(), the
+ * other half share one parsed definition with setDefinition().
+ *     The jobs are stress.xml, next to this file, with several parameter
+ * values, and OpenRPT/data/labeltest.xml.
+ *     prerenderthreads [threads] [rounds]
+ */
+
+#include <QCryptographicHash>
+#include <QDomDocument>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QGuiApplication>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QThread>
+
+#include <parameter.h>
+#include <orprerender.h>
+#include <orreportcache.h>
+#include <renderobjects.h>
+#include <testutils.h>
+
+struct Job {
+  QString name;
+  QDomDocument doc;
+  ORReportDefinitionPtr definition;
+  ParameterList params;
+};
+
+// every primitive of every page, as text
+static QString dump(ORODocument * doc)
+{
+  if(doc == 0)
+    return QString("no document");
+
+  QString text;
+  QTextStream s(&text);
+  for(int p = 0; p < doc->pages(); p++)
+  {
+    OROPage * page = doc->page(p);
+    s << "page " << p << "\n";
+    for(int i = 0; i < page->primitives(); i++)
+    {
+      OROPrimitive * prim = page->primitive(i);
+      s << prim->type() << " " << prim->position().x() << "," << prim->position().y();
+      if(prim->type() == OROTextBox::TextBox)
+      {
+        OROTextBox * tb = static_cast<OROTextBox*>(prim);
+        s << " " << tb->size().width() << "x" << tb->size().height()
+          << " " << tb->flags() << " " << tb->font().toString() << " " << tb->text();
+      }
+      else if(prim->type() == OROLine::Line)
+      {
+        OROLine * ln = static_cast<OROLine*>(prim);
+        s << " " << ln->endPoint().x() << "," << ln->endPoint().y();
+      }
+      else if(prim->type() == OROBarcode::Barcode)
+      {
+        OROBarcode * bc = static_cast<OROBarcode*>(prim);
+        s << " " << bc->size().width() << "x" << bc->size().height()
+          << " " << bc->format() << " " << bc->data();
+      }
+      else if(prim->type() == ORORect::Rect)
+      {
+        ORORect * r = static_cast<ORORect*>(prim);
+        s << " " << r->size().width() << "x" << r->size().height();
+      }
+      else if(prim->type() == OROImage::Image)
+      {
+        OROImage * im = static_cast<OROImage*>(prim);
+        s << " " << im->size().width() << "x" << im->size().height()
+          << " " << QCryptographicHash::hash(QByteArray((const char*)im->image().constBits(), im->image().byteCount()),
+                                             QCryptographicHash::Md5).toHex();
+      }
+      s << "\n";
+    }
+  }
+  return text;
+}
+
+static QString runJob(const Job & job, QSqlDatabase db, bool shared)
+{
+  ORPreRender pre(db);
+  if(shared)
+    pre.setDefinition(job.definition);
+  else
+    pre.setDom(job.doc);
+  pre.setParamList(job.params);
+
+  ORODocument * doc = pre.generate();
+  QString text = dump(doc);
+  delete doc;
+  return text;
+}
+
+class StressThread : public QThread
+{
+  public:
+    StressThread(const QString & fileName, const QList<Job> & jobs, const QStringList & expected, int index, int rounds)
+      : runs(0), _fileName(fileName), _jobs(jobs), _expected(expected), _index(index), _rounds(rounds)
+    {
+      // the nodes of a document are not safe to share between threads
+      for(int j = 0; j < _jobs.size(); j++)
+        _jobs[j].doc = jobs.at(j).doc.cloneNode(true).toDocument();
+    }
+
+    virtual void run()
+    {
+      QString name = QString("prerender-%1").arg(_index);
+      {
+        QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", name);
+        db.setDatabaseName(_fileName);
+        if(!db.open())
+          errors << name + " could not open the database";
+        else
+        {
+          for(int round = 0; round < _rounds; round++)
+          {
+            // each thread starts on a different job
+            for(int j = 0; j < _jobs.size(); j++)
+            {
+              int job = (j + _index) % _jobs.size();
+              bool shared = ((round + j) % 2 == 0);
+              if(runJob(_jobs.at(job), db, shared) != _expected.at(job))
+                errors << QString("%1 %2 on thread %3, %4")
+                            .arg(_jobs.at(job).name).arg(round)
+                            .arg(_index).arg(shared ? "shared definition" : "setDom()");
+              runs++;
+            }
+          }
+          db.close();
+        }
+      }
+      QSqlDatabase::removeDatabase(name);
+    }
+
+    QStringList errors;
+    int runs;
+
+  private:
+    QString _fileName;
+    QList<Job> _jobs;
+    QStringList _expected;
+    int _index;
+    int _rounds;
+};
+
+static bool createData(QSqlDatabase db)
+{
+  QSqlQuery q(db);
+  bool ok = q.exec("CREATE TABLE item (item_number TEXT, item_category TEXT,"
+                   " item_descrip TEXT, item_qty INTEGER, item_price REAL)");
+  ok = ok && q.exec("CREATE TABLE cust (cust_number TEXT, cust_name TEXT,"
+                    " cust_address1 TEXT, cust_address2 TEXT, cust_address3 TEXT,"
+                    " cust_city TEXT, cust_state TEXT, cust_zipcode TEXT)");
+  ok = ok && db.transaction();
+
+  q.prepare("INSERT INTO item VALUES (?, ?, ?, ?, ?)");
+  for(int i = 0; ok && i < 1500; i++)
+  {
+    q.addBindValue(QString("IT%1").arg(i, 5, 10, QLatin1Char('0')));
+    q.addBindValue(QString("Category %1").arg(i % 17, 2, 10, QLatin1Char('0')));
+    q.addBindValue(QString("Item %1, a description long enough to wrap on two lines of the detail band").arg(i));
+    q.addBindValue((i * 37) % 100);
+    q.addBindValue(((i * 7919) % 10000) / 100.0);
+    ok = q.exec();
+  }
+
+  q.prepare("INSERT INTO cust VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+  for(int i = 1; ok && i <= 20; i++)
+  {
+    q.addBindValue(QString("C%1").arg(i, 4, 10, QLatin1Char('0')));
+    q.addBindValue(QString("Customer %1").arg(i));
+    q.addBindValue(QString("%1 Main Street").arg(i * 10));
+    q.addBindValue(QString());
+    q.addBindValue(QString());
+    q.addBindValue("Norfolk");
+    q.addBindValue("VA");
+    q.addBindValue(QString("235%1").arg(i, 2, 10, QLatin1Char('0')));
+    ok = q.exec();
+  }
+
+  return db.commit() && ok;
+}
+
+static bool readReport(const QString & fileName, QDomDocument & doc)
+{
+  QFile file(fileName);
+  return check(file.open(QIODevice::ReadOnly) && doc.setContent(&file), "reading " + fileName);
+}
+
+int main(int argc, char *argv[])
+{
+  QGuiApplication app(argc, argv);
+
+  int threads = 2 * QThread::idealThreadCount();
+  int rounds = 4;
+  if(app.arguments().size() > 1)
+    threads = qMax(1, app.arguments().at(1).toInt());
+  if(app.arguments().size() > 2)
+    rounds = qMax(1, app.arguments().at(2).toInt());
+
+  QTemporaryDir dir;
+  QString fileName = dir.path() + "/prerenderthreads.sqlite";
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(fileName);
+  if(!check(dir.isValid() && db.open() && createData(db), "SQLite test data"))
+    return 1;
+
+  QDomDocument stress;
+  QDomDocument labels;
+  if(!readReport(SOURCE_DIR "/stress.xml", stress) ||
+     !readReport(SOURCE_DIR "/../../OpenRPT/data/labeltest.xml", labels))
+    return 1;
+
+  QList<Job> jobs;
+  int minQuantities[] = { 0, 25, 50, 90 };
+  for(unsigned i = 0; i < sizeof(minQuantities) / sizeof(minQuantities[0]); i++)
+  {
+    Job job;
+    job.name = QString("stress.xml minqty=%1").arg(minQuantities[i]);
+    job.doc = stress;
+    job.params.append("minqty", minQuantities[i]);
+    jobs << job;
+  }
+  Job labelJob;
+  labelJob.name = "labeltest.xml";
+  labelJob.doc = labels;
+  jobs << labelJob;
+
+  bool ok = true;
+  QStringList expected;
+  QElapsedTimer timer;
+  timer.start();
+  for(int j = 0; j < jobs.size(); j++)
+  {
+    jobs[j].definition = ORReportDefinition::parse(jobs.at(j).doc, db);
+    ok &= check(jobs.at(j).definition->isValid(), jobs.at(j).name + " parsed");
+    expected << runJob(jobs.at(j), db, false);
+    ok &= check(expected.last().count("page ") > (j < jobs.size() - 1 ? 1 : 0), jobs.at(j).name + " laid out");
+  }
+  qint64 serial = timer.nsecsElapsed();
+  if(!ok)
+    return 1;
+
+  // the documents of one connection have to be the same from another one
+  ok &= check(runJob(jobs.first(), db, true) == expected.first(), "shared definition on the main thread");
+
+  QList<StressThread*> workers;
+  for(int t = 0; t < threads; t++)
+    workers << new StressThread(fileName, jobs, expected, t, rounds);
+
+  timer.restart();
+  foreach(StressThread * worker, workers)
+    worker->start();
+  int runs = 0;
+  foreach(StressThread * worker, workers)
+  {
+    worker->wait();
+    foreach(QString error, worker->errors)
+      ok &= check(false, error);
+    runs += worker->runs;
+    delete worker;
+  }
+  qint64 concurrent = timer.nsecsElapsed();
+
+  out << jobs.size() << " jobs alone in " << serial / 1000000 << " ms, "
+      << runs << " runs on " << threads << " threads in " << concurrent / 1000000 << " ms" << endl;
+
+  return ok ? 0 : 1;
+}
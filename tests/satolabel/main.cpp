@@ -0,0 +1,188 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     satolabel renders OpenRPT/data/labeltest.xml to a SATO printer buffer,
+ * on a SQLite table standing in for cust, and compares the byte stream with
+ * labeltest.sato next to this file. With -update the golden file is written
+ * again, for changes that are meant to alter the output; the text commands
+ * depend on the fonts found for Arial, so keep that in mind when it differs.
+ *     It also checks that an image drawn on every label is stored in the
+ * printer once per job and recalled by the labels.
+ *     satolabel [-update]
+ */
+
+#include <QDomDocument>
+#include <QFile>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QStringList>
+
+#include <orprerender.h>
+#include <orprintrender.h>
+#include <renderobjects.h>
+#include <reportprinter.h>
+#include <testutils.h>
+
+// what labeltest.xml selects from, the same on every run
+static bool createCustomers(QSqlDatabase db)
+{
+  QSqlQuery q(db);
+  if(!q.exec("CREATE TABLE cust (cust_number TEXT, cust_name TEXT,"
+             " cust_address1 TEXT, cust_address2 TEXT, cust_address3 TEXT,"
+             " cust_city TEXT, cust_state TEXT, cust_zipcode TEXT)"))
+    return false;
+
+  q.prepare("INSERT INTO cust VALUES (?, ?, ?, ?, ?, ?, ?, ?)");
+  for(int i = 1; i <= 20; i++)
+  {
+    q.addBindValue(QString("C%1").arg(i, 4, 10, QLatin1Char('0')));
+    q.addBindValue(QString("Customer %1").arg(i));
+    q.addBindValue(QString("%1 Main Street").arg(i * 10));
+    q.addBindValue(i % 2 ? QString("Suite %1").arg(i) : QString());
+    q.addBindValue(QString());
+    q.addBindValue("Norfolk");
+    q.addBindValue("VA");
+    q.addBindValue(QString("235%1").arg(i, 2, 10, QLatin1Char('0')));
+    if(!q.exec())
+      return false;
+  }
+  return true;
+}
+
+static QByteArray renderLabels(QSqlDatabase db, bool *ok)
+{
+  *ok = false;
+
+  QFile file(SOURCE_DIR "/../../OpenRPT/data/labeltest.xml");
+  QDomDocument doc;
+  if(!file.open(QIODevice::ReadOnly) || !doc.setContent(&file))
+  {
+    out << "FAIL could not read " << file.fileName() << endl;
+    return QByteArray();
+  }
+
+  // the $SATO parameter is what sends a report to a SATO printer
+  QDomElement sato = doc.createElement("parameter");
+  sato.setAttribute("name", "$SATO");
+  sato.setAttribute("listtype", "static");
+  doc.documentElement().appendChild(sato);
+
+  ORPreRender pre(doc, db);
+  ORODocument *labels = pre.generate();
+  if(!check(labels != 0 && labels->pages() > 0, "labeltest.xml laid out"))
+  {
+    delete labels;
+    return QByteArray();
+  }
+  check(labels->printerType() == ReportPrinter::Sato, "labeltest.xml for a SATO printer");
+
+  ReportPrinter printer(QPrinter::HighResolution);
+  printer.setPrintToBuffer();
+  ORPrintRender render;
+  *ok = render.render(labels, &printer);
+  check(*ok, "labeltest.xml printed");
+  delete labels;
+
+  return printer.getBuffer();
+}
+
+static bool checkStoredImage()
+{
+  ReportPrinter printer(QPrinter::HighResolution, ReportPrinter::Sato);
+  printer.setPrintToBuffer();
+
+  QImage logo(120, 45, QImage::Format_RGB32);
+  logo.fill(Qt::white);
+  QPainter logoPainter(&logo);
+  logoPainter.drawEllipse(5, 5, 35, 35);
+  logoPainter.drawText(50, 30, "Logo");
+  logoPainter.end();
+
+  QPainter painter;
+  if(!check(painter.begin(&printer), "painting on a SATO printer"))
+    return false;
+  for(int label = 0; label < 3; label++)
+  {
+    if(label > 0)
+      printer.newPage();
+    painter.drawImage(QPoint(20, 20), logo);
+  }
+  painter.end();
+
+  QByteArray buffer = printer.getBuffer();
+  bool ok = check(buffer.count("\x1BGI") == 1, "logo stored once");
+  ok &= check(buffer.count("\x1BGR001") == 3, "logo recalled by every label");
+  ok &= check(buffer.indexOf("\x1BGI") < buffer.indexOf("\x1BGR001"), "logo stored before it is recalled");
+  ok &= check(!buffer.contains("\x1BGH"), "logo not printed in place");
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  QGuiApplication app(argc, argv);
+  bool update = app.arguments().contains("-update");
+
+  {
+    ReportPrinter printer(QPrinter::HighResolution, ReportPrinter::Sato);
+    if(!printer.isLabelPrinter())
+    {
+      out << "SKIP no native print support, label printers are not available" << endl;
+      return 0;
+    }
+  }
+
+  QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE");
+  db.setDatabaseName(":memory:");
+  if(!check(db.open() && createCustomers(db), "SQLite cust table"))
+    return 1;
+
+  bool ok = false;
+  QByteArray labels = renderLabels(db, &ok);
+
+  QFile golden(SOURCE_DIR "/labeltest.sato");
+  if(ok && update)
+  {
+    if(!golden.open(QIODevice::WriteOnly) || golden.write(labels) != labels.size())
+      ok = check(false, "writing " + golden.fileName());
+    else
+      out << "wrote " << golden.fileName() << " (" << labels.size() << " bytes)" << endl;
+  }
+  else if(ok)
+  {
+    if(!golden.open(QIODevice::ReadOnly))
+      ok = check(false, golden.fileName() + " is missing, run satolabel -update");
+    else
+    {
+      QByteArray expected = golden.readAll();
+      int diff = 0;
+      while(diff < labels.size() && diff < expected.size() && labels.at(diff) == expected.at(diff))
+        diff++;
+      ok = check(labels == expected, QString("labeltest.xml differs from the golden file at byte %1").arg(diff));
+    }
+  }
+
+  ok &= checkStoredImage();
+
+  return ok ? 0 : 1;
+}
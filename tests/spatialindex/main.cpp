@@ -0,0 +1,191 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     spatialindex fills a letter page with text boxes, rectangles and
+ * lines, some of them rotated, and checks that OROPage::primitivesIn() and
+ * primitivesAt() give the same primitives, in the same order, as a scan
+ * of every bounding rectangle, with and without the index and for several
+ * cell sizes. It times both ways of looking up.
+ *     spatialindex [primitives] [queries]
+ */
+
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QStringList>
+
+#include <parsexmlutils.h>
+#include <renderobjects.h>
+#include <testutils.h>
+
+static quint32 seed = 12345;
+
+// a number in [0, max) from the same sequence on every run
+static qreal nextRandom(qreal max)
+{
+  seed = seed * 1103515245 + 12345;
+  return max * ((seed >> 8) & 0xFFFF) / 65536.0;
+}
+
+static void fillPage(OROPage * page, int count)
+{
+  ORObject object;
+  for(int i = 0; i < count; i++)
+  {
+    object.setPen(QPen(Qt::black, (int)nextRandom(4)));
+    object.setBorder(QPen(Qt::black, i % 5 == 0 ? 2 : 0));
+    object.setRotation(i % 7 == 0 ? nextRandom(360) : 0);
+
+    QPointF pos(nextRandom(8.5), nextRandom(11));
+    OROPrimitive * prim = 0;
+    if(i % 3 == 0)
+    {
+      OROTextBox * text = new OROTextBox(&object);
+      text->setSize(QSizeF(0.2 + nextRandom(2), 0.15 + nextRandom(0.1)));
+      text->setText(QString("Text %1").arg(i));
+      prim = text;
+    }
+    else if(i % 3 == 1)
+    {
+      ORORect * rect = new ORORect(&object);
+      rect->setSize(QSizeF(nextRandom(1), nextRandom(1)));
+      prim = rect;
+    }
+    else
+    {
+      // horizontal and vertical rules, some of them across the page
+      OROLine * line = new OROLine(&object);
+      qreal length = (i % 11 == 0 ? nextRandom(8) : nextRandom(1));
+      line->setEndPoint(i % 2 ? pos + QPointF(length, 0) : pos + QPointF(0, length));
+      prim = line;
+    }
+    prim->setPosition(pos);
+    if(i % 13 == 0)
+      prim->setRotationAxis(pos + QPointF(nextRandom(1), nextRandom(1)));
+    page->addPrimitive(prim);
+  }
+}
+
+static QList<OROPrimitive*> scan(OROPage * page, const QRectF & area)
+{
+  QRectF rect = area.normalized();
+  QList<OROPrimitive*> found;
+  for(int i = 0; i < page->primitives(); i++)
+  {
+    QRectF b = page->primitive(i)->boundingRect();
+    if(b.left() <= rect.right() && rect.left() <= b.right() &&
+       b.top() <= rect.bottom() && rect.top() <= b.bottom())
+      found.append(page->primitive(i));
+  }
+  return found;
+}
+
+// regions of every kind: small and large, empty, reversed, off the page
+static QList<QRectF> queries(int count)
+{
+  QList<QRectF> list;
+  for(int i = 0; i < count; i++)
+  {
+    QPointF pos(nextRandom(10) - 0.75, nextRandom(12.5) - 0.75);
+    if(i % 10 == 0)
+      list << QRectF(pos, QSizeF(0, 0));
+    else if(i % 10 == 1)
+      list << QRectF(pos, QSizeF(-nextRandom(3), -nextRandom(3)));
+    else if(i % 10 == 2)
+      list << QRectF(pos, QSizeF(nextRandom(8), nextRandom(10)));
+    else
+      list << QRectF(pos, QSizeF(nextRandom(1), nextRandom(1)));
+  }
+  list << QRectF(0, 0, 8.5, 11) << QRectF(-5, -5, 1, 1) << QRectF(20, 20, 1, 1);
+  return list;
+}
+
+static bool compare(OROPage * page, const QList<QRectF> & rects, const QString & what)
+{
+  int mismatches = 0;
+  for(int i = 0; i < rects.count(); i++)
+  {
+    const QRectF & r = rects.at(i);
+    bool same = (page->primitivesIn(r) == scan(page, r));
+    if(r.size().isNull())
+      same = same && (page->primitivesAt(r.topLeft()) == scan(page, r));
+    if(!same)
+      mismatches++;
+  }
+  return check(mismatches == 0, QString("%1: %2 of %3 lookups differ from a scan")
+                                .arg(what).arg(mismatches).arg(rects.count()));
+}
+
+int main(int argc, char *argv[])
+{
+  QGuiApplication app(argc, argv);
+
+  int primitives = 5000;
+  int lookups = 2000;
+  if(app.arguments().size() > 1)
+    primitives = qMax(1, app.arguments().at(1).toInt());
+  if(app.arguments().size() > 2)
+    lookups = qMax(1, app.arguments().at(2).toInt());
+
+  ORODocument doc;
+  OROPage * page = new OROPage(0);
+  doc.addPage(page);
+  fillPage(page, primitives);
+  QList<QRectF> rects = queries(lookups);
+
+  bool ok = check(!page->hasIndex(), "no index before buildIndex()");
+  ok &= compare(page, rects, "without index");
+
+  QList<qreal> cellSizes;
+  cellSizes << 0.5 << 0.1 << 0.01 << 4;
+  foreach(qreal cellSize, cellSizes)
+  {
+    page->buildIndex(cellSize);
+    ok &= check(page->hasIndex(), QString("index built with %1 inch cells").arg(cellSize));
+    ok &= compare(page, rects, QString("%1 inch cells").arg(cellSize));
+  }
+
+  page->buildIndex();
+  QElapsedTimer timer;
+  timer.start();
+  int found = 0;
+  foreach(const QRectF & r, rects)
+    found += page->primitivesIn(r).count();
+  qint64 indexed = timer.nsecsElapsed();
+
+  timer.restart();
+  int scanned = 0;
+  foreach(const QRectF & r, rects)
+    scanned += scan(page, r).count();
+  qint64 linear = timer.nsecsElapsed();
+  ok &= check(found == scanned, "same number of primitives found");
+
+  // a new primitive drops the index and is found without one
+  fillPage(page, 1);
+  ok &= check(!page->hasIndex(), "index dropped by addPrimitive()");
+  ok &= compare(page, rects, "after addPrimitive()");
+
+  out << primitives << " primitives, " << rects.count() << " lookups: index "
+      << indexed / rects.count() / 1000.0 << " us, scan "
+      << linear / rects.count() / 1000.0 << " us per lookup, "
+      << found / rects.count() << " primitives found on average" << endl;
+
+  return ok ? 0 : 1;
+}
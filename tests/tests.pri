@@ -0,0 +1,39 @@
+#
+# OpenRPT report writer and rendering engine
+# Copyright (C) 2001-2014 by OpenMFG, LLC
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+# Please contact info@openmfg.com with any questions on this license.
+#
+
+include( $$PWD/../global.pri )
+
+TEMPLATE = app
+CONFIG += qt warn_on console
+CONFIG -= app_bundle
+INCLUDEPATH += ../../common ../../OpenRPT/renderer ../../MetaSQL
+INCLUDEPATH += $$PWD
+HEADERS += $$PWD/testutils.h
+
+OBJECTS_DIR = tmp
+MOC_DIR     = tmp
+
+QMAKE_LIBDIR = ../../lib $$QMAKE_LIBDIR
+LIBS += -lrenderer -lopenrptcommon -ldmtx -lMetaSQL
+
+DESTDIR = ../../bin/tests
+
+QT += xml sql printsupport
+win32|macx:QT += widgets
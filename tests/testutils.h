@@ -0,0 +1,41 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+#ifndef __TESTUTILS_H__
+#define __TESTUTILS_H__
+
+#include <QString>
+#include <QTextStream>
+
+//
+// What the programs under tests/ share, each of them being a single
+// main.cpp: out prints to stdout, and check() prints a failed check there
+// and returns whether it passed, so that the results can be and-ed.
+//
+static QTextStream out(stdout);
+
+static bool check(bool ok, const QString & what)
+{
+  if(!ok)
+    out << "FAIL " << what << endl;
+  return ok;
+}
+
+#endif // __TESTUTILS_H__
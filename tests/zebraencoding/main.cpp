@@ -0,0 +1,247 @@
+/*
+ * OpenRPT report writer and rendering engine
+ * Copyright (C) 2001-2014 by OpenMFG, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ * Please contact info@openmfg.com with any questions on this license.
+ */
+
+/*
+ *     zebraencoding checks the graphic encodings of ZebraPaintEngine against
+ * the sprintf() per byte encoding they replaced, on label sized images, and
+ * times both. The :Z64: form is decoded again and its CRC checked.
+ *     A job of several labels is then printed to a buffer through
+ * ZebraPaintEngine, in both encodings, to check that every image is
+ * downloaded once and recalled by the labels drawing it.
+ *     zebraencoding [iterations]
+ */
+
+#include <QElapsedTimer>
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+#include <QStringList>
+
+#include <reportprinter.h>
+#include <zebraencoding.h>
+#include <testutils.h>
+
+// the GRF data in hexadecimal as drawImage() wrote it before
+static QByteArray referenceHexa(QImage monoImage)
+{
+  int width = monoImage.width();
+  QByteArray grfImage;
+  for(int line=0; line < monoImage.height(); line++) {
+    for (int x=0; x<width; x+=8) {
+      uchar imageByte = monoImage.scanLine(line)[x/8];
+      int validPix = width-x;
+      if(validPix<8) { // set out-of-bounds pixels to zero
+        imageByte >>= 8-validPix;
+        imageByte <<= 8-validPix;
+      }
+      grfImage.append(QString().sprintf("%02X",imageByte));
+    }
+  }
+  return grfImage;
+}
+
+static QByteArray referenceCompressedHexa(const QByteArray &in)
+{
+  const int maxOccurrences = 400;
+  QByteArray out;
+  for (int pos=0; pos<in.length(); pos++) {
+    int occurrences = 1;
+    while(pos+occurrences < in.length() && in.at(pos+occurrences) == in.at(pos)) {
+      occurrences++;
+      if(occurrences >= maxOccurrences) {
+        break;
+      }
+    }
+    if(occurrences>1) {
+      if(occurrences / 20 > 0) {
+        char c = 'f' + (occurrences / 20);
+        out.append(c);
+      }
+      if(occurrences % 20 > 0) {
+        char c = 'F' + (occurrences % 20);
+        out.append(c);
+      }
+      pos += (occurrences-1);
+    }
+    out.append(in.at(pos));
+  }
+  return out;
+}
+
+// CRC-16/XMODEM, written out again to check the one of :Z64:
+static quint16 crc16(const QByteArray &in)
+{
+  quint16 crc = 0;
+  for(int i = 0; i < in.length(); i++)
+  {
+    crc ^= (quint16)((uchar)in.at(i)) << 8;
+    for(int bit = 0; bit < 8; bit++)
+      crc = (crc & 0x8000) ? (quint16)((crc << 1) ^ 0x1021) : (quint16)(crc << 1);
+  }
+  return crc;
+}
+
+// something like a shipping label: bars, boxes, a logo and some noise
+static QImage labelImage(int width, int height)
+{
+  QImage image(width, height, QImage::Format_RGB32);
+  image.fill(Qt::white);
+
+  QPainter painter(&image);
+  painter.setPen(QPen(Qt::black, 3));
+  painter.drawRect(10, 10, width - 21, height - 21);
+  painter.drawLine(10, height / 3, width - 11, height / 3);
+  painter.setBrush(Qt::black);
+  painter.drawEllipse(QPoint(width / 5, height / 6), width / 8, width / 8);
+  for(int x = 40, bar = 0; x < width - 40; x += 2 + bar % 4, bar++)
+    painter.fillRect(x, height / 2, 1 + (bar * 7) % 3, height / 5, Qt::black);
+  painter.end();
+
+  quint32 seed = 12345;
+  for(int y = height - height / 5; y < height - 20; y++)
+    for(int x = 20; x < width - 20; x++)
+    {
+      seed = seed * 1103515245 + 12345;
+      if((seed >> 16) % 7 == 0)
+        image.setPixel(x, y, qRgb(0, 0, 0));
+    }
+
+  return image.convertToFormat(QImage::Format_Mono);
+}
+
+// a logo on every label and a stamp on every other one
+static bool checkLabelJob(const QString & encoding)
+{
+  const int labels = 10;
+  QList<QPair<QString,QString> > params;
+  if(!encoding.isEmpty())
+    params << qMakePair(QString("imageencoding"), encoding);
+
+  ReportPrinter printer(QPrinter::HighResolution);
+  printer.setPrintToBuffer();
+  printer.setParams(params);
+  printer.setPrinterType(ReportPrinter::Zebra);
+
+  QImage logo = labelImage(203, 100);
+  QImage stamp = labelImage(120, 120);
+
+  QPainter painter;
+  if(!check(painter.begin(&printer), "painting on a Zebra printer"))
+    return false;
+  for(int label = 0; label < labels; label++)
+  {
+    if(label > 0)
+      printer.newPage();
+    painter.drawImage(QPoint(20, 20), logo);
+    if(label % 2)
+      painter.drawImage(QPoint(20, 300), stamp);
+  }
+  painter.end();
+
+  QString name = (encoding.isEmpty() ? QString("hexadecimal") : encoding) + " job";
+  QByteArray buffer = printer.getBuffer();
+  bool ok = check(buffer.count("^XA") == labels, name + " one format per label");
+  ok &= check(buffer.count("~DGR:ORI0001.GRF,") == 1, name + " logo downloaded once");
+  ok &= check(buffer.count("^XGR:ORI0001.GRF,") == labels, name + " logo recalled by every label");
+  ok &= check(buffer.indexOf("~DGR:ORI0001.GRF,") < buffer.indexOf("^XGR:ORI0001.GRF,"), name + " logo downloaded before it is recalled");
+  ok &= check(buffer.count("~DGR:ORI0002.GRF,") == 1, name + " stamp downloaded once");
+  ok &= check(buffer.count("^XGR:ORI0002.GRF,") == labels / 2, name + " stamp recalled by every other label");
+  ok &= check(buffer.indexOf("~DGR:ORI0002.GRF,") < buffer.indexOf("^XGR:ORI0002.GRF,"), name + " stamp downloaded before it is recalled");
+  ok &= check(buffer.count("~DG") == 2, name + " no other image downloaded");
+
+  out << name << ": " << buffer.size() << " bytes for " << labels << " labels, "
+      << buffer.size() / labels << " bytes per label" << endl;
+  return ok;
+}
+
+int main(int argc, char *argv[])
+{
+  QGuiApplication app(argc, argv);
+
+  int iterations = 20;
+  if(app.arguments().size() > 1)
+    iterations = qMax(1, app.arguments().at(1).toInt());
+
+  bool ok = check(crc16("123456789") == 0x31C3, "CRC-16/XMODEM check value");
+
+  // 4x6 inches at 203 and 300 dpi, the first one not a whole number of bytes wide
+  QList<QSize> sizes;
+  sizes << QSize(813, 1218) << QSize(1200, 1800);
+  foreach(QSize size, sizes)
+  {
+    QImage image = labelImage(size.width(), size.height());
+    QString name = QString("%1x%2").arg(size.width()).arg(size.height());
+
+    QByteArray grf = zebraGrfData(image);
+    QByteArray hexa = zebraHexa(grf);
+    QByteArray expected = referenceHexa(image);
+    ok &= check(hexa == expected, name + " hexadecimal");
+    ok &= check(zebraCompressedHexa(hexa) == referenceCompressedHexa(expected), name + " compressed hexadecimal");
+
+    QByteArray z64 = zebraZ64(grf);
+    QList<QByteArray> parts = z64.split(':');
+    bool z64Ok = (parts.size() == 4 && parts.at(1) == "Z64");
+    if(z64Ok)
+    {
+      z64Ok = (parts.at(3) == QByteArray::number(crc16(parts.at(2)), 16).toUpper().rightJustified(4, '0'));
+      // qUncompress() wants the size first, as qCompress() writes it
+      QByteArray zlib = QByteArray::fromBase64(parts.at(2));
+      int n = grf.size();
+      zlib.prepend((char)(n & 0xff)).prepend((char)((n >> 8) & 0xff))
+          .prepend((char)((n >> 16) & 0xff)).prepend((char)((n >> 24) & 0xff));
+      z64Ok = z64Ok && (qUncompress(zlib) == grf);
+    }
+    ok &= check(z64Ok, name + " :Z64:");
+
+    QElapsedTimer timer;
+    timer.start();
+    for(int i = 0; i < iterations; i++)
+      referenceCompressedHexa(referenceHexa(image));
+    qint64 before = timer.nsecsElapsed();
+
+    timer.restart();
+    for(int i = 0; i < iterations; i++)
+      zebraCompressedHexa(zebraHexa(zebraGrfData(image)));
+    qint64 hexaTime = timer.nsecsElapsed();
+
+    timer.restart();
+    for(int i = 0; i < iterations; i++)
+      zebraZ64(zebraGrfData(image));
+    qint64 z64Time = timer.nsecsElapsed();
+
+    out << name << ": sprintf " << before / iterations / 1000 << " us, "
+        << "hexadecimal " << hexaTime / iterations / 1000 << " us ("
+        << expected.size() << " -> " << zebraCompressedHexa(hexa).size() << " bytes), "
+        << ":Z64: " << z64Time / iterations / 1000 << " us (" << z64.size() << " bytes)" << endl;
+  }
+
+  {
+    ReportPrinter printer(QPrinter::HighResolution, ReportPrinter::Zebra);
+    if(!printer.isLabelPrinter())
+      out << "SKIP no native print support, label printers are not available" << endl;
+    else
+    {
+      ok &= checkLabelJob(QString());
+      ok &= checkLabelJob("z64");
+    }
+  }
+
+  return ok ? 0 : 1;
+}